@@ -1,66 +1,72 @@
 
-#include <windows.h>
+#include<chrono>
+#include<cstdlib>
+#include<algorithm>
 
 #include"BaseSystem.h"
-#include"..\Window\Window.h"
-#include"..\..\Core\CoreManager.h"
-#include"..\..\Utilities\Settings.h"
-#include"..\..\Utilities\Utils.h"
-#include"..\..\Utilities\Log.h"
-#include"..\..\Utilities\Input.h"
+#include"../Platform/Platform.h"
+#include"../Benchmark/Benchmark.h"
+#include"../../Core/CoreManager.h"
+#include"../../Utilities/Settings.h"
+#include"../../Utilities/Utils.h"
+#include"../../Utilities/Log.h"
+#include"../../Utilities/Input.h"
+#include"../../Utilities/CommandLine.h"
+#include"../../Utilities/CpuProfiler.h"
+#include"../../Utilities/FrameStats.h"
 
 std::string BaseSystem::workspace_directory_ = "";
 
 class BaseSystem::Impl
 {
 public:
+	using Clock = std::chrono::steady_clock;
+
 	bool app_exit_;
-	std::unique_ptr<Window> window_;
+	bool initialized_;
+	bool first_frame_done_;
+	Clock::time_point startup_;		// Init called
+	std::unique_ptr<Platform> platform_;
 	std::unique_ptr<CoreManager> core_manager_;
+	std::unique_ptr<Benchmark> benchmark_;	// --benchmark only
 
 	Impl()
 		: app_exit_(false)
-		, window_(std::make_unique<Window>())
-		, core_manager_(std::make_unique<CoreManager>(window_)){}
+		, initialized_(false)
+		, first_frame_done_(false)
+		, platform_(Platform::Create(CommandLine::HasOption("headless")))
+		, core_manager_(std::make_unique<CoreManager>(*platform_)){}
 
-	void MessageLoop(void)
+	static double ElapsedMs(Clock::time_point since)
 	{
-		MSG msg = {};
+		return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+	}
 
+	void MessageLoop(void)
+	{
 		while (!app_exit_)
 		{
-			if (PeekMessageA(&msg, nullptr, 0, 0, PM_REMOVE))
-			{
-				TranslateMessage(&msg);
-				DispatchMessageA(&msg);
-			}
+			CpuProfiler::FrameMark();
+			FrameStats::FrameMark();
+			PROFILE_ZONE("BaseSystem::MessageLoop");
 
-			if (Input::IsKeyTriggered("escape"))
-			{
-				if (Input::IsMouseCaptured())
-				{
-					Input::CaptureMouse(window_->GetWindowHandle(), false);
-				}
-				else
-				{
-					if (MessageBoxA(window_->GetWindowHandle(), "Quit ?", "User Notification", MB_YESNO | MB_DEFBUTTON2) == IDYES)
-					{
-						Log::Info("[EXIT] KEY DOWN ESC");
-						app_exit_ = true;
-					}
-				}
-			}
-
-			if (msg.message == WM_QUIT)
+			if (!platform_->PumpEvents() || (benchmark_ && !benchmark_->BeginFrame()))
 			{
 				app_exit_ = true;
+				break;
 			}
-			else
+
+			app_exit_ |= core_manager_->Run();
+
+			if (!first_frame_done_)
 			{
-				app_exit_ |= core_manager_->Run();
+				first_frame_done_ = true;
+				Log::Info("[STARTUP] first frame after %.1f ms", ElapsedMs(startup_));
 			}
 
-			Input::PostStateUpdate();
+			if (benchmark_) benchmark_->EndFrame();
+
+			platform_->EndFrame();
 		}
 	}
 };
@@ -71,17 +77,43 @@ BaseSystem::~BaseSystem() { Log::Info("~BaseSystem()"); }// = default;
 
 bool BaseSystem::Init(void)
 {
-	workspace_directory_ = DirectoryUtils::GetSpecialFolderPath(DirectoryUtils::FolderType::APPDATA) + "\\Vulkan Startup";
+	impl_->startup_ = Impl::Clock::now();
+
+	workspace_directory_ = DirectoryUtils::GetSpecialFolderPath(DirectoryUtils::FolderType::APPDATA) + "/Vulkan Startup";
 
 #ifdef _DEBUG
 	Log::Initialize(Log::LogMode::CONSOLE);
+#else
+	// a headless run is a job, its timings go to the console in every build
+	if (impl_->platform_->IsHeadless()) Log::Initialize(Log::LogMode::CONSOLE);
 #endif
 	Input::Initialize();
+	CpuProfiler::SetThreadName("main");
+
+	const auto frame_budget = CommandLine::GetValue("frame-budget");
+	FrameStats::Initialize(frame_budget.empty() ? Settings::frame_budget_ms<double> : std::atof(frame_budget.c_str()));
 
-	if (!impl_->window_->Init()) return false;
+	if (!impl_->platform_->Init()) return false;
+
+	const auto core_start = Impl::Clock::now();
+	Log::Info("[STARTUP] platform ready after %.1f ms", Impl::ElapsedMs(impl_->startup_));
 
 	if (!impl_->core_manager_->Initialize()) return false;
 
+	Log::Info("[STARTUP] core initialize %.1f ms", Impl::ElapsedMs(core_start));
+
+	if (Benchmark::IsRequested())
+	{
+		impl_->benchmark_ = std::make_unique<Benchmark>(*impl_->core_manager_);
+		if (!impl_->benchmark_->Initialize())
+		{
+			impl_->benchmark_.reset();
+			return false;
+		}
+	}
+
+	impl_->initialized_ = true;
+
 	return true;
 }
 
@@ -90,12 +122,34 @@ void BaseSystem::Run(void)
 	impl_->MessageLoop();
 }
 
-void BaseSystem::Exit(void)
+int BaseSystem::Exit(void)
 {
-	Log::Finalize();
+	// the report reads the gpu profiler and the allocator, before they go away
+	int exit_code = impl_->benchmark_ ? impl_->benchmark_->Finish() : 0;
+	impl_->benchmark_.reset();
+
+	// a benchmark or headless job that never ran must not pass
+	if (!impl_->initialized_) exit_code = 1;
 
-	impl_->window_->Exit();
-	impl_->window_.reset();
+	// --cpu-trace : the last frames as a chrome trace
+	if (CommandLine::HasOption("cpu-trace"))
+	{
+		const auto frames = CommandLine::GetInt("cpu-trace", Settings::cpu_profiler_dump_frames<int>);
+		CpuProfiler::Dump(workspace_directory_ + "/cpu_trace.json", static_cast<uint32_t>(std::max(frames, 1)));
+	}
+
+	// gpu resources and the pipeline cache file before the window goes away
+	impl_->core_manager_->Exit();
+
+	// headless timings are logged here
+	impl_->platform_->Exit();
+	impl_->platform_.reset();
+
+	FrameStats::LogSummary();
+
+	Log::Finalize();
 
 	impl_.reset();
+
+	return exit_code;
 }
\ No newline at end of file
@@ -18,7 +18,8 @@ public:
 
 	bool Init(void);
 	void Run(void);
-	void Exit(void);
+	// 0, 1 when initialization failed or a benchmark found a regression
+	int Exit(void);
 
 	static std::string workspace_directory_;
 };
\ No newline at end of file
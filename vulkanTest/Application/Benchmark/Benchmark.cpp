@@ -0,0 +1,343 @@
+#include<cmath>
+#include<cstdio>
+#include<cstdarg>
+#include<cstdlib>
+#include<string>
+#include<vector>
+#include<algorithm>
+
+#include"Benchmark.h"
+#include"../BaseSystem/BaseSystem.h"
+#include"../../Core/CoreManager.h"
+#include"../../Core/Graphics.h"
+#include"../../Core/GpuProfiler.h"
+#include"../../Core/MemoryAllocator.h"
+#include"../../Core/CommandRecorder.h"
+#include"../../Utilities/Settings.h"
+#include"../../Utilities/CommandLine.h"
+#include"../../Utilities/FrameStats.h"
+#include"../../Utilities/Input.h"
+#include"../../Utilities/Utils.h"
+#include"../../Utilities/Log.h"
+
+namespace
+{
+	// mouse position of a frame, a camera follows the mouse
+	using Path = void(*)(uint32_t frame, long& x, long& y);
+
+	struct Scenario
+	{
+		const char*	name;
+		const char*	description;
+		Path		path;
+	};
+
+	const double pi = 3.14159265358979;
+
+	const Scenario scenarios[] =
+	{
+		{ "idle", "no input, the steady state cost of a frame",
+			[](uint32_t, long& x, long& y) { x = 0; y = 0; } },
+
+		{ "orbit", "one slow turn every 240 frames",
+			[](uint32_t frame, long& x, long& y)
+			{
+				const double angle = frame * (2.0 * pi / 240.0);
+				x = std::lround(8.0 * std::cos(angle));
+				y = std::lround(8.0 * std::sin(angle));
+			} },
+
+		{ "sweep", "fast pans left and right, 120 frames each way",
+			[](uint32_t frame, long& x, long& y)
+			{
+				const uint32_t phase = frame % 240;
+				x = static_cast<long>(phase < 120 ? phase : 240 - phase) * 4 - 240;
+				y = 0;
+			} },
+
+		{ "jitter", "a new pseudo random position every frame, the same every run",
+			[](uint32_t frame, long& x, long& y)
+			{
+				const uint32_t hash = (frame + 1) * 2654435761u;
+				x = static_cast<long>(hash & 0xff) - 128;
+				y = static_cast<long>((hash >> 8) & 0xff) - 128;
+			} },
+	};
+
+	void Append(std::string& json, const char* format, ...)
+	{
+		char text[512];
+
+		va_list args;
+		va_start(args, format);
+		vsnprintf(text, sizeof(text), format, args);
+		va_end(args);
+
+		json += text;
+	}
+
+	// a number after "key": following the first occurrence of anchor, reports are written by this file
+	bool FindNumber(const std::string& json, const std::string& anchor, const std::string& key, double& value)
+	{
+		auto position = json.find(anchor);
+		if (position == std::string::npos) return false;
+
+		position = json.find("\"" + key + "\":", position);
+		if (position == std::string::npos) return false;
+
+		const char* begin = json.c_str() + position + key.size() + 3;
+		char* end = nullptr;
+		value = std::strtod(begin, &end);
+
+		return end != begin;
+	}
+}
+
+class Benchmark::Impl
+{
+public:
+	struct Metric
+	{
+		std::string	name;
+		std::string	anchor;		// where it is found in the report
+		std::string	key;
+		double		value;
+	};
+
+	CoreManager&		core_manager_;
+	const Scenario*		scenario_;
+	uint32_t			warmup_frames_;
+	uint32_t			measured_frames_;
+	uint32_t			frame_;
+	uint64_t			created_objects_;	// during the measured frames
+	uint32_t			max_draw_items_;
+	uint32_t			max_secondaries_;
+
+	Impl(CoreManager& core_manager)
+		: core_manager_(core_manager)
+		, scenario_(nullptr)
+		, warmup_frames_(static_cast<uint32_t>(std::max(CommandLine::GetInt("warmup", Settings::benchmark_warmup_frames<int>), 0)))
+		, measured_frames_(static_cast<uint32_t>(std::max(CommandLine::GetInt("measure", Settings::benchmark_measured_frames<int>), 1)))
+		, frame_(0)
+		, created_objects_(0)
+		, max_draw_items_(0)
+		, max_secondaries_(0) {}
+
+	bool IsMeasuring(void) const
+	{
+		return frame_ >= warmup_frames_;
+	}
+
+	std::string MakeReport(bool completed, const std::vector<Metric>& regressions) const
+	{
+		auto& graphics = core_manager_.GetGraphics();
+
+		const uint32_t measured = IsMeasuring() ? frame_ - warmup_frames_ : 0;
+
+		// exact when the ring holds every measured frame
+		auto cpu = FrameStats::GetWindow(measured);
+		if (cpu.frame_count < measured) cpu = FrameStats::GetSummary();
+
+		std::string json = "{\n";
+		Append(json, "\t\"scenario\": \"%s\",\n", scenario_->name);
+		Append(json, "\t\"completed\": %s,\n", completed ? "true" : "false");
+		Append(json, "\t\"warmup_frames\": %u,\n", warmup_frames_);
+		Append(json, "\t\"measured_frames\": %u,\n", measured);
+
+		Append(json, "\t\"cpu_frame_ms\": { \"average_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f, \"p50_ms\": %.4f, \"p90_ms\": %.4f, \"p99_ms\": %.4f, \"p999_ms\": %.4f, ",
+			cpu.average_ms, cpu.min_ms, cpu.max_ms, cpu.p50_ms, cpu.p90_ms, cpu.p99_ms, cpu.p999_ms);
+		Append(json, "\"budget_ms\": %.4f, \"stutters\": %llu, \"severe_stutters\": %llu },\n",
+			cpu.budget_ms, static_cast<unsigned long long>(cpu.stutter_count), static_cast<unsigned long long>(cpu.severe_stutter_count));
+
+		json += "\t\"cpu_frame_times_ms\": [";
+		auto times = FrameStats::GetFrameTimes(measured);
+		for (size_t i = 0; i < times.size(); ++i)
+		{
+			Append(json, i == 0 ? "%.4f" : ", %.4f", times[i]);
+		}
+		json += "],\n";
+
+		// every resolved measured frame, the last frames in flight are still on the gpu
+		json += "\t\"gpu_passes\": [";
+		auto timings = graphics.GetGpuProfiler().GetTimings();
+		for (size_t i = 0; i < timings.size(); ++i)
+		{
+			auto& timing = timings[i];
+			Append(json, "%s\n\t\t{ \"name\":\"%s\", \"depth\": %u, \"average_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f, \"p99_ms\": %.4f, \"samples\": %u",
+				i == 0 ? "" : ",", timing.name.c_str(), timing.depth, timing.average_ms, timing.min_ms, timing.max_ms, timing.p99_ms, timing.sample_count);
+
+			for (auto& counter : timing.counters)
+			{
+				Append(json, ", \"%s\": %llu", counter.first.c_str(), static_cast<unsigned long long>(counter.second));
+			}
+			json += " }";
+		}
+		json += timings.empty() ? "],\n" : "\n\t],\n";
+
+		auto memory = graphics.GetMemoryAllocator().GetStatistics();
+		Append(json, "\t\"memory\": { \"allocations\": %u, \"dedicated\": %u, \"blocks\": %u, \"requested_bytes\": %llu, \"used_bytes\": %llu, \"reserved_bytes\": %llu, \"fragmentation\": %.4f },\n",
+			memory.allocation_count, memory.dedicated_count, memory.block_count, static_cast<unsigned long long>(memory.requested_bytes),
+			static_cast<unsigned long long>(memory.used_bytes), static_cast<unsigned long long>(memory.reserved_bytes), memory.fragmentation);
+
+		Append(json, "\t\"vulkan_objects\": { \"created_total\": %llu, \"created_while_measured\": %llu },\n",
+			static_cast<unsigned long long>(graphics.GetCreatedObjectCount()), static_cast<unsigned long long>(created_objects_));
+
+		Append(json, "\t\"draws\": { \"items\": %u, \"secondary_buffers\": %u },\n", max_draw_items_, max_secondaries_);
+
+		json += "\t\"regressions\": [";
+		for (size_t i = 0; i < regressions.size(); ++i)
+		{
+			Append(json, "%s\"%s\"", i == 0 ? "" : ", ", regressions[i].name.c_str());
+		}
+		json += "]\n}\n";
+
+		return json;
+	}
+
+	// lower is better for every metric
+	std::vector<Metric> Compare(const std::string& report, const std::string& baseline, double threshold_percent) const
+	{
+		const Metric metrics[] =
+		{
+			{ "cpu average", "\"cpu_frame_ms\"", "average_ms", 0.0 },
+			{ "cpu p50", "\"cpu_frame_ms\"", "p50_ms", 0.0 },
+			{ "cpu p99", "\"cpu_frame_ms\"", "p99_ms", 0.0 },
+			{ "gpu frame average", "\"name\":\"frame\"", "average_ms", 0.0 },
+			{ "gpu frame p99", "\"name\":\"frame\"", "p99_ms", 0.0 },
+		};
+
+		std::vector<Metric> regressions;
+		for (auto metric : metrics)
+		{
+			double base = 0.0;
+			if (!FindNumber(baseline, metric.anchor, metric.key, base) || !FindNumber(report, metric.anchor, metric.key, metric.value)) continue;
+
+			// too small to compare, timer noise
+			if (base <= 0.001) continue;
+
+			const double change = (metric.value - base) / base * 100.0;
+			if (change > threshold_percent)
+			{
+				Log::Warning("[BENCHMARK] %s %.3f ms, baseline %.3f ms (+%.1f%%)", metric.name.c_str(), metric.value, base, change);
+				regressions.push_back(metric);
+			}
+			else
+			{
+				Log::Info("[BENCHMARK] %s %.3f ms, baseline %.3f ms (%+.1f%%)", metric.name.c_str(), metric.value, base, change);
+			}
+		}
+		return regressions;
+	}
+};
+
+Benchmark::Benchmark(CoreManager& core_manager) : impl_(std::make_unique<Impl>(core_manager)) {}
+
+Benchmark::~Benchmark() = default;
+
+bool Benchmark::IsRequested(void)
+{
+	return CommandLine::HasOption("benchmark");
+}
+
+bool Benchmark::Initialize(void)
+{
+	const auto name = CommandLine::GetValue("benchmark", Settings::benchmark_scenario<const char*>);
+
+	for (auto& scenario : scenarios)
+	{
+		if (name == scenario.name) impl_->scenario_ = &scenario;
+	}
+
+	if (!impl_->scenario_)
+	{
+		Log::Error("Benchmark scenario " + name + " not found.");
+		for (auto& scenario : scenarios)
+		{
+			Log::Info("  %s : %s", scenario.name, scenario.description);
+		}
+		return false;
+	}
+
+	Log::Info("Benchmark create done. (%s, %u warm-up, %u measured frames)", impl_->scenario_->name, impl_->warmup_frames_, impl_->measured_frames_);
+
+	return true;
+}
+
+bool Benchmark::BeginFrame(void)
+{
+	if (impl_->frame_ >= impl_->warmup_frames_ + impl_->measured_frames_) return false;
+
+	// the warm-up is forgotten, the clock starts with the first measured frame
+	if (impl_->frame_ == impl_->warmup_frames_)
+	{
+		FrameStats::Initialize(FrameStats::GetBudget());
+		FrameStats::FrameMark();
+
+		// the gpu numbers and the baseline check cover the same frames
+		impl_->core_manager_.GetGraphics().GetGpuProfiler().ResetHistory(impl_->measured_frames_);
+		Log::Info("[BENCHMARK] MEASURE %u FRAMES", impl_->measured_frames_);
+	}
+
+	long x = 0, y = 0;
+	impl_->scenario_->path(impl_->frame_, x, y);
+	Input::UpdateMousePos(x, y, 0);
+
+	return true;
+}
+
+void Benchmark::EndFrame(void)
+{
+	if (impl_->IsMeasuring())
+	{
+		auto& graphics = impl_->core_manager_.GetGraphics();
+		auto& recorder = graphics.GetCommandRecorder();
+
+		impl_->created_objects_ += graphics.GetFrameCreatedObjectCount();
+		impl_->max_draw_items_ = std::max(impl_->max_draw_items_, recorder.GetDrawItemCount());
+		impl_->max_secondaries_ = std::max(impl_->max_secondaries_, recorder.GetRecordedBufferCount());
+	}
+
+	++impl_->frame_;
+}
+
+int Benchmark::Finish(void)
+{
+	const bool completed = impl_->frame_ >= impl_->warmup_frames_ + impl_->measured_frames_;
+	if (!completed) Log::Warning("Benchmark stopped after %u frames.", impl_->frame_);
+
+	auto report = impl_->MakeReport(completed, {});
+
+	std::vector<Impl::Metric> regressions;
+
+	const auto baseline_path = CommandLine::GetValue("baseline");
+	if (!baseline_path.empty())
+	{
+		std::vector<char> baseline;
+		if (FileUtils::ReadBinary(baseline_path, baseline))
+		{
+			const double threshold = std::atof(CommandLine::GetValue("threshold", std::to_string(Settings::benchmark_regression_percent<double>)).c_str());
+			regressions = impl_->Compare(report, std::string(baseline.begin(), baseline.end()), threshold);
+
+			if (!regressions.empty()) report = impl_->MakeReport(completed, regressions);
+		}
+		else
+		{
+			Log::Error("Benchmark baseline " + baseline_path + " cannot read.");
+		}
+	}
+
+	const auto path = CommandLine::GetValue("benchmark-out", BaseSystem::workspace_directory_ + "/benchmark_" + impl_->scenario_->name + ".json");
+	if (FileUtils::WriteBinaryAtomic(path, report.data(), report.size()))
+	{
+		Log::Info("Benchmark report written. (" + path + ")");
+	}
+	else
+	{
+		Log::Error("Benchmark report cannot written.");
+	}
+
+	if (!regressions.empty()) Log::Warning("[BENCHMARK] %d REGRESSIONS", static_cast<int>(regressions.size()));
+
+	// a run cut short measured nothing worth passing
+	return completed && regressions.empty() ? 0 : 1;
+}
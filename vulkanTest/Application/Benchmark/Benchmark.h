@@ -0,0 +1,34 @@
+#pragma once
+
+#include<memory>
+
+class CoreManager;
+
+// --benchmark[=scenario] : warm-up frames, then measured frames driven by the
+// scenario's scripted input path, then a json report.
+// --warmup, --measure : frame counts
+// --benchmark-out : report path, default in the workspace directory
+// --baseline, --threshold : an earlier report and the allowed slowdown in percent
+class Benchmark
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	Benchmark() = delete;
+	Benchmark(CoreManager&);
+	~Benchmark();
+
+	static bool IsRequested(void);
+
+	// false on an unknown scenario
+	bool Initialize(void);
+
+	// after the platform pumped its events, false once every frame has run
+	bool BeginFrame(void);
+	void EndFrame(void);
+
+	// writes the report, 0 or 1 when the run stopped early or the baseline comparison found a regression
+	int Finish(void);
+};
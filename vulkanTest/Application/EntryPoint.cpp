@@ -1,11 +1,39 @@
-
+#if defined(_WIN32)
 #include<windows.h>
-#include "BaseSystem\BaseSystem.h"
+#endif
+#include<string>
+#include "BaseSystem/BaseSystem.h"
+#include "../Utilities/CommandLine.h"
+
+namespace
+{
+	int RunApplication(void)
+	{
+		BaseSystem application;
+		if(application.Init()) application.Run();
+		return application.Exit();
+	}
+}
 
-int __stdcall WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
+#if defined(_WIN32)
+int __stdcall WinMain(HINSTANCE, HINSTANCE, LPSTR command_line, int)
 {
-	BaseSystem application;
-	if(application.Init()) application.Run();
-	application.Exit();
-	return 0;
-}
\ No newline at end of file
+	CommandLine::Initialize(command_line ? command_line : "");
+
+	return RunApplication();
+}
+#else
+// the arguments joined the way WinMain receives them
+int main(int argc, char** argv)
+{
+	std::string command_line;
+	for (int i = 1; i < argc; ++i)
+	{
+		command_line += (i > 1 ? " " : "") + std::string(argv[i]);
+	}
+
+	CommandLine::Initialize(command_line);
+
+	return RunApplication();
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include<cmath>
+#include<climits>
+#include<chrono>
+#include<algorithm>
+
+#include"HeadlessPlatform.h"
+#include"../../Utilities/Settings.h"
+#include"../../Utilities/CommandLine.h"
+#include"../../Utilities/Input.h"
+#include"../../Utilities/Log.h"
+
+class HeadlessPlatform::Impl
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	int					frame_count_;
+	int					frame_;
+	Clock::time_point	start_;
+	Clock::time_point	frame_start_;
+	double				min_ms_;
+	double				max_ms_;
+
+	Impl()
+		: frame_count_(CommandLine::GetInt("frames", CommandLine::HasOption("benchmark") ? INT_MAX : Settings::headless_frame_count<int>))
+		, frame_(0)
+		, min_ms_(0.0)
+		, max_ms_(0.0) {}
+
+	// the same mouse path every run, one turn every 240 frames
+	void FeedInput(void)
+	{
+		const double angle = frame_ * (2.0 * 3.14159265358979 / 240.0);
+		Input::UpdateMousePos(static_cast<long>(std::lround(8.0 * std::cos(angle))), static_cast<long>(std::lround(8.0 * std::sin(angle))), 0);
+	}
+};
+
+HeadlessPlatform::HeadlessPlatform() : impl_(std::make_unique<Impl>()) {}
+
+HeadlessPlatform::~HeadlessPlatform() = default;
+
+bool HeadlessPlatform::Init(void)
+{
+	impl_->start_ = Impl::Clock::now();
+
+	Log::Info("Headless platform initialize succeeded. (%d frames)", impl_->frame_count_);
+
+	return true;
+}
+
+void HeadlessPlatform::Exit(void)
+{
+	const int frames = impl_->frame_;
+	if (frames == 0) return;
+
+	const double total_ms = std::chrono::duration<double, std::milli>(Impl::Clock::now() - impl_->start_).count();
+	const double average_ms = total_ms / frames;
+
+	Log::Info("[EXIT] HEADLESS %d FRAMES", frames);
+	Log::Info("frame ms avg %.3f min %.3f max %.3f", average_ms, impl_->min_ms_, impl_->max_ms_);
+	Log::Info("total %.1f ms, %.1f fps", total_ms, 1000.0 / average_ms);
+}
+
+bool HeadlessPlatform::PumpEvents(void)
+{
+	if (impl_->frame_ >= impl_->frame_count_) return false;
+
+	impl_->frame_start_ = Impl::Clock::now();
+	impl_->FeedInput();
+
+	return true;
+}
+
+void HeadlessPlatform::EndFrame(void)
+{
+	const double frame_ms = std::chrono::duration<double, std::milli>(Impl::Clock::now() - impl_->frame_start_).count();
+
+	impl_->min_ms_ = impl_->frame_ == 0 ? frame_ms : std::min(impl_->min_ms_, frame_ms);
+	impl_->max_ms_ = std::max(impl_->max_ms_, frame_ms);
+	++impl_->frame_;
+
+	Input::PostStateUpdate();
+}
+
+bool HeadlessPlatform::IsHeadless(void) const
+{
+	return true;
+}
+
+Platform::NativeHandles HeadlessPlatform::GetNativeHandles(void) const
+{
+	return { nullptr, nullptr };
+}
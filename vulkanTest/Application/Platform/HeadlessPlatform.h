@@ -0,0 +1,26 @@
+#pragma once
+
+#include"Platform.h"
+
+// No window, a fixed number of frames (--frames) with scripted mouse input.
+// A benchmark ends the run itself.
+// Frame times are logged on exit.
+class HeadlessPlatform : public Platform
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	HeadlessPlatform();
+	~HeadlessPlatform();
+
+	bool Init(void) override;
+	void Exit(void) override;
+
+	bool PumpEvents(void) override;
+	void EndFrame(void) override;
+
+	bool IsHeadless(void) const override;
+	NativeHandles GetNativeHandles(void) const override;
+};
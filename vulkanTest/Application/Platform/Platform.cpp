@@ -0,0 +1,14 @@
+#include"Platform.h"
+#include"HeadlessPlatform.h"
+#if defined(_WIN32)
+#include"Win32Platform.h"
+#endif
+
+std::unique_ptr<Platform> Platform::Create(bool headless)
+{
+#if defined(_WIN32)
+	if (!headless) return std::make_unique<Win32Platform>();
+#endif
+
+	return std::make_unique<HeadlessPlatform>();
+}
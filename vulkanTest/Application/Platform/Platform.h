@@ -0,0 +1,35 @@
+#pragma once
+
+#include<memory>
+
+// Window and event source the engine runs on.
+// Win32Platform owns the window and pumps its messages, HeadlessPlatform has no
+// window and drives a fixed number of frames with synthetic input.
+class Platform
+{
+public:
+	// what the surface is created from, HINSTANCE and HWND on win32
+	struct NativeHandles
+	{
+		void*	instance;
+		void*	window;
+	};
+
+	virtual ~Platform() = default;
+
+	virtual bool Init(void) = 0;
+	virtual void Exit(void) = 0;
+
+	// before a frame, false once the application should quit
+	virtual bool PumpEvents(void) = 0;
+
+	// after a frame, input state rolls over
+	virtual void EndFrame(void) = 0;
+
+	// no window : no surface, rendering goes to offscreen images
+	virtual bool IsHeadless(void) const = 0;
+	virtual NativeHandles GetNativeHandles(void) const = 0;
+
+	// headless where no windowing is available
+	static std::unique_ptr<Platform> Create(bool headless);
+};
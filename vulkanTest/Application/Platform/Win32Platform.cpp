@@ -0,0 +1,82 @@
+#include<windows.h>
+
+#include"Win32Platform.h"
+#include"../Window/Window.h"
+#include"../../Utilities/Log.h"
+#include"../../Utilities/Input.h"
+#include"../../Utilities/Settings.h"
+#include"../../Utilities/CpuProfiler.h"
+
+class Win32Platform::Impl
+{
+public:
+	std::unique_ptr<Window> window_;
+
+	Impl() : window_(std::make_unique<Window>()) {}
+};
+
+Win32Platform::Win32Platform() : impl_(std::make_unique<Impl>()) {}
+
+Win32Platform::~Win32Platform() = default;
+
+bool Win32Platform::Init(void)
+{
+	return impl_->window_->Init();
+}
+
+void Win32Platform::Exit(void)
+{
+	if (!impl_->window_) return;
+
+	impl_->window_->Exit();
+	impl_->window_.reset();
+}
+
+bool Win32Platform::PumpEvents(void)
+{
+	MSG msg = {};
+
+	// everything queued since the last frame
+	while (PeekMessageA(&msg, nullptr, 0, 0, PM_REMOVE))
+	{
+		if (msg.message == WM_QUIT) return false;
+
+		TranslateMessage(&msg);
+		DispatchMessageA(&msg);
+	}
+
+	// written at the next frame mark
+	if (Input::IsKeyTriggered(VK_F11)) CpuProfiler::RequestDump(Settings::cpu_profiler_dump_frames<uint32_t>);
+
+	if (Input::IsKeyTriggered("escape"))
+	{
+		auto window_handle = impl_->window_->GetWindowHandle();
+
+		if (Input::IsMouseCaptured())
+		{
+			Input::CaptureMouse(window_handle, false);
+		}
+		else if (MessageBoxA(window_handle, "Quit ?", "User Notification", MB_YESNO | MB_DEFBUTTON2) == IDYES)
+		{
+			Log::Info("[EXIT] KEY DOWN ESC");
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Win32Platform::EndFrame(void)
+{
+	Input::PostStateUpdate();
+}
+
+bool Win32Platform::IsHeadless(void) const
+{
+	return false;
+}
+
+Platform::NativeHandles Win32Platform::GetNativeHandles(void) const
+{
+	return { impl_->window_->GetWindowInstance(), impl_->window_->GetWindowHandle() };
+}
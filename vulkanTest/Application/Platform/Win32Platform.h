@@ -0,0 +1,24 @@
+#pragma once
+
+#include"Platform.h"
+
+// Win32 window, message pump and the escape / close prompts.
+class Win32Platform : public Platform
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	Win32Platform();
+	~Win32Platform();
+
+	bool Init(void) override;
+	void Exit(void) override;
+
+	bool PumpEvents(void) override;
+	void EndFrame(void) override;
+
+	bool IsHeadless(void) const override;
+	NativeHandles GetNativeHandles(void) const override;
+};
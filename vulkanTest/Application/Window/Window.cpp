@@ -2,10 +2,10 @@
 #include<vector>
 
 #include "Window.h"
-#include"..\BaseSystem\BaseSystem.h"
-#include"..\..\Utilities\Log.h"
-#include"..\..\Utilities\Settings.h"
-#include"..\..\Utilities\Input.h"
+#include"../BaseSystem/BaseSystem.h"
+#include"../../Utilities/Log.h"
+#include"../../Utilities/Settings.h"
+#include"../../Utilities/Input.h"
 
 //extern LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
 
@@ -0,0 +1,370 @@
+#include<mutex>
+#include<deque>
+#include<vector>
+#include<iterator>
+
+#include"BindlessHeap.h"
+#include"GpuTimeline.h"
+#include"../Utilities/Log.h"
+
+class BindlessHeap::Impl
+{
+public:
+	// indices of one binding
+	struct Slots
+	{
+		uint32_t				capacity;
+		uint32_t				next;			// never used beyond this
+		uint32_t				live;
+		std::vector<uint32_t>	free;
+		std::deque<std::pair<uint64_t, uint32_t>>	retired;	// timeline value, index
+
+		uint32_t Allocate(void)
+		{
+			if (!free.empty())
+			{
+				auto index = free.back();
+				free.pop_back();
+				++live;
+				return index;
+			}
+			if (next == capacity) return invalid_index;
+
+			++live;
+			return next++;
+		}
+	};
+
+	vk::Device								device_;
+	GpuTimeline&							timeline_;
+	bool									update_after_bind_;
+	uint32_t								frame_count_;
+	uint32_t								frame_index_;
+	std::mutex								mutex_;
+
+	vk::DescriptorSetLayout					layout_;
+	vk::DescriptorPool						pool_;
+	std::vector<vk::DescriptorSet>			sets_;			// one, or one per frame in fallback
+
+	Slots									images_;
+	Slots									buffers_;
+
+	// fallback : cpu copy of the table, written to a frame's set when it is stale
+	std::vector<vk::DescriptorImageInfo>	image_infos_;
+	std::vector<vk::DescriptorBufferInfo>	buffer_infos_;
+	vk::DescriptorImageInfo					default_image_;
+	vk::DescriptorBufferInfo				default_buffer_;
+	bool									has_defaults_;
+	uint64_t								version_;
+	std::vector<uint64_t>					set_versions_;
+
+	Impl(vk::Device device, GpuTimeline& timeline, bool update_after_bind, uint32_t image_capacity, uint32_t buffer_capacity, uint32_t frame_count)
+		: device_(device)
+		, timeline_(timeline)
+		, update_after_bind_(update_after_bind)
+		, frame_count_(frame_count)
+		, frame_index_(0)
+		, images_({ image_capacity, 0, 0 })
+		, buffers_({ buffer_capacity, 0, 0 })
+		, has_defaults_(false)
+		, version_(1) {}
+
+	void WriteImage(uint32_t index, const vk::DescriptorImageInfo& info)
+	{
+		if (!update_after_bind_)
+		{
+			image_infos_[index] = info;
+			++version_;
+			return;
+		}
+
+		auto const write = vk::WriteDescriptorSet()
+			.setDstSet(sets_[0])
+			.setDstBinding(image_binding)
+			.setDstArrayElement(index)
+			.setDescriptorCount(1)
+			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+			.setPImageInfo(&info);
+
+		device_.updateDescriptorSets(1, &write, 0, nullptr);
+	}
+
+	void WriteBuffer(uint32_t index, const vk::DescriptorBufferInfo& info)
+	{
+		if (!update_after_bind_)
+		{
+			buffer_infos_[index] = info;
+			++version_;
+			return;
+		}
+
+		auto const write = vk::WriteDescriptorSet()
+			.setDstSet(sets_[0])
+			.setDstBinding(buffer_binding)
+			.setDstArrayElement(index)
+			.setDescriptorCount(1)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setPBufferInfo(&info);
+
+		device_.updateDescriptorSets(1, &write, 0, nullptr);
+	}
+
+	void Recycle(Slots& slots)
+	{
+		while (!slots.retired.empty() && timeline_.IsCompleted(slots.retired.front().first))
+		{
+			slots.free.push_back(slots.retired.front().second);
+			slots.retired.pop_front();
+		}
+	}
+};
+
+BindlessHeap::BindlessHeap(vk::Device device, GpuTimeline& timeline, bool update_after_bind, uint32_t image_capacity, uint32_t buffer_capacity, uint32_t frame_count)
+	: impl_(std::make_unique<Impl>(device, timeline, update_after_bind, image_capacity, buffer_capacity, frame_count)) {}
+
+BindlessHeap::~BindlessHeap() = default;
+
+bool BindlessHeap::Initialize(void)
+{
+	const bool uab = impl_->update_after_bind_;
+
+	vk::DescriptorSetLayoutBinding const bindings[] =
+	{
+		vk::DescriptorSetLayoutBinding()
+			.setBinding(image_binding)
+			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+			.setDescriptorCount(impl_->images_.capacity)
+			.setStageFlags(vk::ShaderStageFlagBits::eAll),
+		vk::DescriptorSetLayoutBinding()
+			.setBinding(buffer_binding)
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setDescriptorCount(impl_->buffers_.capacity)
+			.setStageFlags(vk::ShaderStageFlagBits::eAll),
+	};
+
+	// slots are written while the set is bound, unused ones hold nothing
+	vk::DescriptorBindingFlagsEXT const binding_flags[] =
+	{
+		vk::DescriptorBindingFlagBitsEXT::eUpdateAfterBind | vk::DescriptorBindingFlagBitsEXT::eUpdateUnusedWhilePending | vk::DescriptorBindingFlagBitsEXT::ePartiallyBound,
+		vk::DescriptorBindingFlagBitsEXT::eUpdateAfterBind | vk::DescriptorBindingFlagBitsEXT::eUpdateUnusedWhilePending | vk::DescriptorBindingFlagBitsEXT::ePartiallyBound,
+	};
+
+	auto const flags_info = vk::DescriptorSetLayoutBindingFlagsCreateInfoEXT()
+		.setBindingCount(static_cast<uint32_t>(std::size(binding_flags)))
+		.setPBindingFlags(binding_flags);
+
+	auto const layout_info = vk::DescriptorSetLayoutCreateInfo()
+		.setPNext(uab ? &flags_info : nullptr)
+		.setFlags(uab ? vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPoolEXT : vk::DescriptorSetLayoutCreateFlags())
+		.setBindingCount(static_cast<uint32_t>(std::size(bindings)))
+		.setPBindings(bindings);
+
+	auto result = impl_->device_.createDescriptorSetLayout(&layout_info, nullptr, &impl_->layout_);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Bindless descriptor set layout cannot created.");
+		return false;
+	}
+
+	VulkanStats::CountCreated();
+
+	const uint32_t set_count = uab ? 1 : impl_->frame_count_;
+
+	vk::DescriptorPoolSize const pool_sizes[] =
+	{
+		vk::DescriptorPoolSize(vk::DescriptorType::eCombinedImageSampler, impl_->images_.capacity * set_count),
+		vk::DescriptorPoolSize(vk::DescriptorType::eStorageBuffer, impl_->buffers_.capacity * set_count),
+	};
+
+	auto const pool_info = vk::DescriptorPoolCreateInfo()
+		.setFlags(uab ? vk::DescriptorPoolCreateFlagBits::eUpdateAfterBindEXT : vk::DescriptorPoolCreateFlags())
+		.setMaxSets(set_count)
+		.setPoolSizeCount(static_cast<uint32_t>(std::size(pool_sizes)))
+		.setPPoolSizes(pool_sizes);
+
+	result = impl_->device_.createDescriptorPool(&pool_info, nullptr, &impl_->pool_);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Bindless descriptor pool cannot created.");
+		return false;
+	}
+
+	VulkanStats::CountCreated();
+
+	std::vector<vk::DescriptorSetLayout> layouts(set_count, impl_->layout_);
+	auto const alloc_info = vk::DescriptorSetAllocateInfo()
+		.setDescriptorPool(impl_->pool_)
+		.setDescriptorSetCount(set_count)
+		.setPSetLayouts(layouts.data());
+
+	impl_->sets_.resize(set_count);
+	result = impl_->device_.allocateDescriptorSets(&alloc_info, impl_->sets_.data());
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Bindless descriptor set cannot allocated.");
+		return false;
+	}
+
+	if (!uab)
+	{
+		impl_->image_infos_.resize(impl_->images_.capacity);
+		impl_->buffer_infos_.resize(impl_->buffers_.capacity);
+		impl_->set_versions_.assign(set_count, 0);
+	}
+
+	Log::Info(uab ? "Bindless heap create done." : "Bindless heap create done (per-frame fallback).");
+
+	return true;
+}
+
+void BindlessHeap::Destroy(void)
+{
+	if (impl_->pool_) impl_->device_.destroyDescriptorPool(impl_->pool_);
+	if (impl_->layout_) impl_->device_.destroyDescriptorSetLayout(impl_->layout_);
+
+	impl_->pool_ = vk::DescriptorPool();
+	impl_->layout_ = vk::DescriptorSetLayout();
+	impl_->sets_.clear();
+}
+
+bool BindlessHeap::IsUpdateAfterBind(void) const
+{
+	return impl_->update_after_bind_;
+}
+
+void BindlessHeap::SetDefaults(const vk::DescriptorImageInfo& image, const vk::DescriptorBufferInfo& buffer)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	for (auto& info : impl_->image_infos_)
+	{
+		if (!info.imageView || info.imageView == impl_->default_image_.imageView) info = image;
+	}
+	for (auto& info : impl_->buffer_infos_)
+	{
+		if (!info.buffer || info.buffer == impl_->default_buffer_.buffer) info = buffer;
+	}
+
+	impl_->default_image_ = image;
+	impl_->default_buffer_ = buffer;
+	impl_->has_defaults_ = true;
+	++impl_->version_;
+}
+
+uint32_t BindlessHeap::AddImage(vk::ImageView view, vk::Sampler sampler, vk::ImageLayout layout)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	auto index = impl_->images_.Allocate();
+	if (index == invalid_index)
+	{
+		Log::Warning("Bindless image slots are full.");
+		return invalid_index;
+	}
+
+	impl_->WriteImage(index, vk::DescriptorImageInfo(sampler, view, layout));
+
+	return index;
+}
+
+uint32_t BindlessHeap::AddBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	auto index = impl_->buffers_.Allocate();
+	if (index == invalid_index)
+	{
+		Log::Warning("Bindless buffer slots are full.");
+		return invalid_index;
+	}
+
+	impl_->WriteBuffer(index, vk::DescriptorBufferInfo(buffer, offset, range));
+
+	return index;
+}
+
+void BindlessHeap::ReleaseImage(uint32_t index)
+{
+	if (index == invalid_index) return;
+
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	--impl_->images_.live;
+
+	// the frame being recorded may still read the index, it is the next submit
+	impl_->images_.retired.push_back({ impl_->timeline_.GetSubmittedValue() + 1, index });
+
+	// the resource may be destroyed right after, the fallback table must not keep it
+	if (!impl_->update_after_bind_) impl_->WriteImage(index, impl_->default_image_);
+}
+
+void BindlessHeap::ReleaseBuffer(uint32_t index)
+{
+	if (index == invalid_index) return;
+
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	--impl_->buffers_.live;
+	impl_->buffers_.retired.push_back({ impl_->timeline_.GetSubmittedValue() + 1, index });
+
+	if (!impl_->update_after_bind_) impl_->WriteBuffer(index, impl_->default_buffer_);
+}
+
+void BindlessHeap::BeginFrame(uint32_t frame_index)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	impl_->Recycle(impl_->images_);
+	impl_->Recycle(impl_->buffers_);
+
+	if (impl_->update_after_bind_) return;
+
+	impl_->frame_index_ = frame_index % impl_->frame_count_;
+
+	// the frame's previous use has completed, the whole table is rewritten when it changed
+	auto& set_version = impl_->set_versions_[impl_->frame_index_];
+	if (!impl_->has_defaults_ || set_version == impl_->version_) return;
+
+	vk::WriteDescriptorSet const writes[] =
+	{
+		vk::WriteDescriptorSet()
+			.setDstSet(impl_->sets_[impl_->frame_index_])
+			.setDstBinding(image_binding)
+			.setDescriptorCount(static_cast<uint32_t>(impl_->image_infos_.size()))
+			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+			.setPImageInfo(impl_->image_infos_.data()),
+		vk::WriteDescriptorSet()
+			.setDstSet(impl_->sets_[impl_->frame_index_])
+			.setDstBinding(buffer_binding)
+			.setDescriptorCount(static_cast<uint32_t>(impl_->buffer_infos_.size()))
+			.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+			.setPBufferInfo(impl_->buffer_infos_.data()),
+	};
+
+	impl_->device_.updateDescriptorSets(static_cast<uint32_t>(std::size(writes)), writes, 0, nullptr);
+	set_version = impl_->version_;
+}
+
+vk::DescriptorSetLayout BindlessHeap::GetLayout(void) const
+{
+	return impl_->layout_;
+}
+
+vk::DescriptorSet BindlessHeap::GetSet(void) const
+{
+	if (impl_->sets_.empty()) return vk::DescriptorSet();
+	if (impl_->update_after_bind_) return impl_->sets_[0];
+	if (!impl_->has_defaults_) return vk::DescriptorSet();
+
+	return impl_->sets_[impl_->frame_index_];
+}
+
+uint32_t BindlessHeap::GetImageCount(void) const
+{
+	return impl_->images_.live;
+}
+
+uint32_t BindlessHeap::GetBufferCount(void) const
+{
+	return impl_->buffers_.live;
+}
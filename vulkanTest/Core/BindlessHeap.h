@@ -0,0 +1,55 @@
+#pragma once
+
+#include<memory>
+#include"VulkanCommon.h"
+
+class GpuTimeline;
+
+// One descriptor set holding every sampled image and storage buffer.
+// Draws pass integer indices instead of binding sets. With descriptor indexing the
+// set is update-after-bind and partially bound, otherwise one set per frame in flight
+// is rewritten before use, empty slots pointing at the default resources, and
+// slots added during a frame become visible from the next one.
+class BindlessHeap
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	static constexpr uint32_t invalid_index = 0xffffffff;
+	static constexpr uint32_t image_binding = 0;	// combined image sampler array
+	static constexpr uint32_t buffer_binding = 1;	// storage buffer array
+
+	BindlessHeap() = delete;
+	BindlessHeap(vk::Device, GpuTimeline&, bool update_after_bind, uint32_t image_capacity, uint32_t buffer_capacity, uint32_t frame_count);
+	~BindlessHeap();
+
+	bool Initialize(void);
+	void Destroy(void);
+
+	bool IsUpdateAfterBind(void) const;
+
+	// fallback only, stands in for empty and released slots, no set is usable before
+	// Graphics sets a zeroed 1x1 image and a zeroed buffer during init
+	void SetDefaults(const vk::DescriptorImageInfo&, const vk::DescriptorBufferInfo&);
+
+	// thread safe, invalid_index when full
+	uint32_t AddImage(vk::ImageView, vk::Sampler, vk::ImageLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+	uint32_t AddBuffer(vk::Buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+
+	// slot is reused once the work submitted so far and the frame being recorded have completed
+	void ReleaseImage(uint32_t index);
+	void ReleaseBuffer(uint32_t index);
+
+	// recycles released slots, rewrites the frame's set in fallback mode
+	void BeginFrame(uint32_t frame_index);
+
+	vk::DescriptorSetLayout GetLayout(void) const;
+
+	// null in fallback mode until the defaults are set
+	vk::DescriptorSet GetSet(void) const;
+
+	uint32_t GetImageCount(void) const;
+	uint32_t GetBufferCount(void) const;
+};
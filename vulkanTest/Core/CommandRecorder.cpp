@@ -0,0 +1,193 @@
+#include<algorithm>
+
+#include"CommandRecorder.h"
+#include"../Utilities/ThreadPool.h"
+#include"../Utilities/Log.h"
+
+class CommandRecorder::Impl
+{
+public:
+	// touched only by the thread that owns it during Record()
+	struct ThreadFrameResources
+	{
+		vk::CommandPool					command_pool;
+		std::vector<vk::CommandBuffer>	buffers;		// kept between frames, grows only
+		uint32_t						used;
+	};
+
+	static constexpr uint32_t min_items_per_slice = 64;
+
+	vk::Device											device_;
+	uint32_t											queue_family_index_;
+	uint32_t											frame_count_;
+	uint32_t											frame_index_;
+	ThreadPool&											thread_pool_;
+	uint32_t											recording_thread_count_;	// workers and the calling thread
+	std::vector<std::vector<ThreadFrameResources>>		resources_;					// [frame][thread]
+	std::vector<vk::CommandBuffer>						secondaries_;				// [slice]
+	uint32_t											draw_item_count_;
+	RecordFunction										record_draws_;
+
+	Impl(vk::Device device, uint32_t queue_family_index, uint32_t frame_count, ThreadPool& thread_pool)
+		: device_(device)
+		, queue_family_index_(queue_family_index)
+		, frame_count_(frame_count)
+		, frame_index_(0)
+		, thread_pool_(thread_pool)
+		, recording_thread_count_(thread_pool.GetThreadCount() + 1)
+		, draw_item_count_(0) {}
+
+	vk::CommandBuffer GetBuffer(uint32_t thread_index)
+	{
+		auto& thread = resources_[frame_index_][thread_index];
+
+		if (thread.used == thread.buffers.size())
+		{
+			auto alloc_info = vk::CommandBufferAllocateInfo()
+				.setCommandPool(thread.command_pool)
+				.setLevel(vk::CommandBufferLevel::eSecondary)
+				.setCommandBufferCount(1);
+
+			auto result = device_.allocateCommandBuffers(alloc_info);
+			if (result.result != vk::Result::eSuccess)
+			{
+				Log::Error("Secondary command buffer cannot created.");
+				return vk::CommandBuffer();
+			}
+
+			thread.buffers.push_back(result.value[0]);
+			VulkanStats::CountCreated();
+		}
+
+		return thread.buffers[thread.used++];
+	}
+};
+
+CommandRecorder::CommandRecorder(vk::Device device, uint32_t queue_family_index, uint32_t frame_count, ThreadPool& thread_pool)
+	: impl_(std::make_unique<Impl>(device, queue_family_index, frame_count, thread_pool)) {}
+
+CommandRecorder::~CommandRecorder() = default;
+
+bool CommandRecorder::Initialize(void)
+{
+	auto pool_info = vk::CommandPoolCreateInfo()
+		.setQueueFamilyIndex(impl_->queue_family_index_)
+		.setFlags(vk::CommandPoolCreateFlagBits::eTransient);
+
+	impl_->resources_.resize(impl_->frame_count_);
+
+	for (auto& frame : impl_->resources_)
+	{
+		frame.resize(impl_->recording_thread_count_);
+
+		for (auto& thread : frame)
+		{
+			thread.used = 0;
+
+			impl_->device_.createCommandPool(&pool_info, nullptr, &thread.command_pool);
+			if (!thread.command_pool)
+			{
+				Log::Error("Recording commandpool cannot created.");
+				return false;
+			}
+
+			VulkanStats::CountCreated();
+		}
+	}
+
+	Log::Info("Command recorder create done. (%d recording threads)", impl_->recording_thread_count_);
+
+	return true;
+}
+
+void CommandRecorder::Destroy(void)
+{
+	for (auto& frame : impl_->resources_)
+	{
+		for (auto& thread : frame)
+		{
+			// frees the buffers with it
+			impl_->device_.destroyCommandPool(thread.command_pool);
+		}
+	}
+
+	impl_->resources_.clear();
+	impl_->secondaries_.clear();
+}
+
+void CommandRecorder::SetDrawList(uint32_t item_count, RecordFunction record_draws)
+{
+	impl_->draw_item_count_ = item_count;
+	impl_->record_draws_ = std::move(record_draws);
+}
+
+bool CommandRecorder::HasDrawList(void) const
+{
+	return impl_->draw_item_count_ > 0 && impl_->record_draws_;
+}
+
+uint32_t CommandRecorder::GetDrawItemCount(void) const
+{
+	return HasDrawList() ? impl_->draw_item_count_ : 0;
+}
+
+void CommandRecorder::BeginFrame(uint32_t frame_index)
+{
+	impl_->frame_index_ = frame_index;
+
+	for (auto& thread : impl_->resources_[frame_index])
+	{
+		impl_->device_.resetCommandPool(thread.command_pool, vk::CommandPoolResetFlags());
+		thread.used = 0;
+	}
+
+	impl_->secondaries_.clear();
+}
+
+const std::vector<vk::CommandBuffer>& CommandRecorder::Record(const vk::CommandBufferInheritanceInfo& inheritance)
+{
+	impl_->secondaries_.clear();
+
+	if (!HasDrawList()) return impl_->secondaries_;
+
+	// slices depend only on the item and thread count
+	const uint32_t item_count = impl_->draw_item_count_;
+	const uint32_t slice_count = std::max(1u, std::min(impl_->recording_thread_count_,
+		(item_count + Impl::min_items_per_slice - 1) / Impl::min_items_per_slice));
+	const uint32_t items_per_slice = (item_count + slice_count - 1) / slice_count;
+
+	impl_->secondaries_.resize(slice_count);
+
+	auto begin_info = vk::CommandBufferBeginInfo()
+		.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+		.setPInheritanceInfo(&inheritance);
+
+	impl_->thread_pool_.ParallelFor(slice_count, [&](uint32_t slice, uint32_t thread_index)
+	{
+		const uint32_t first = slice * items_per_slice;
+		if (first >= item_count) return;
+
+		const uint32_t count = std::min(items_per_slice, item_count - first);
+
+		auto cmd_buffer = impl_->GetBuffer(thread_index);
+		if (!cmd_buffer) return;
+
+		cmd_buffer.begin(begin_info);
+		impl_->record_draws_(cmd_buffer, first, count);
+		cmd_buffer.end();
+
+		impl_->secondaries_[slice] = cmd_buffer;
+	});
+
+	// drop empty slices and ones that failed to allocate
+	impl_->secondaries_.erase(
+		std::remove(impl_->secondaries_.begin(), impl_->secondaries_.end(), vk::CommandBuffer()),
+		impl_->secondaries_.end());
+
+	return impl_->secondaries_;
+}
+
+uint32_t CommandRecorder::GetRecordedBufferCount(void) const
+{
+	return static_cast<uint32_t>(impl_->secondaries_.size());
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include<memory>
+#include<vector>
+#include<functional>
+#include"VulkanCommon.h"
+
+class ThreadPool;
+
+// Records the draw list into secondary command buffers on the worker threads.
+// Each thread owns a transient pool per frame in flight, the primary executes
+// the secondaries in slice order so the result does not depend on scheduling.
+class CommandRecorder
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	// records items [first, first + count) into the secondary buffer
+	using RecordFunction = std::function<void(vk::CommandBuffer, uint32_t first, uint32_t count)>;
+
+	CommandRecorder() = delete;
+	CommandRecorder(vk::Device, uint32_t queue_family_index, uint32_t frame_count, ThreadPool&);
+	~CommandRecorder();
+
+	bool Initialize(void);
+	void Destroy(void);
+
+	void SetDrawList(uint32_t item_count, RecordFunction);
+	bool HasDrawList(void) const;
+	uint32_t GetDrawItemCount(void) const;
+
+	// resets the frame's pools, the frame's previous work must have completed
+	void BeginFrame(uint32_t frame_index);
+
+	// secondaries in slice order, valid until the frame slot comes around again
+	const std::vector<vk::CommandBuffer>& Record(const vk::CommandBufferInheritanceInfo&);
+
+	// secondaries recorded during the last Record()
+	uint32_t GetRecordedBufferCount(void) const;
+};
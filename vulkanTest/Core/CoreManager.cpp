@@ -1,6 +1,7 @@
 
 #include"CoreManager.h"
 #include"Graphics.h"
+#include"../Utilities/CpuProfiler.h"
 
 class CoreManager::Impl
 {
@@ -8,15 +9,17 @@ public:
 	std::shared_ptr<Graphics> graphics_;
 	bool wait_exit;
 
-	Impl(std::unique_ptr<Window>& window) : graphics_(std::make_shared<Graphics>(window)), wait_exit(false){}
+	Impl(Platform& platform) : graphics_(std::make_shared<Graphics>(platform)), wait_exit(false){}
 };
 
-CoreManager::CoreManager(std::unique_ptr<Window>& window) : impl_(std::make_unique<Impl>(window)) {}
+CoreManager::CoreManager(Platform& platform) : impl_(std::make_unique<Impl>(platform)) {}
 
 CoreManager::~CoreManager() = default;
 
 bool CoreManager::Initialize(void)
 {
+	PROFILE_FUNCTION();
+
 	if (!impl_->graphics_->Initialize()) return false;
 
 	return true;
@@ -24,6 +27,8 @@ bool CoreManager::Initialize(void)
 
 bool CoreManager::Run(void)
 {
+	PROFILE_FUNCTION();
+
 	impl_->graphics_->BeginFrame();
 
 	// application run anything
@@ -37,4 +42,9 @@ bool CoreManager::Run(void)
 void CoreManager::Exit(void)
 {
 	impl_->graphics_->Exit();
+}
+
+Graphics& CoreManager::GetGraphics(void)
+{
+	return *impl_->graphics_;
 }
\ No newline at end of file
@@ -1,7 +1,9 @@
 #pragma once
 
 #include<memory>
-#include"..\Application\Window\Window.h"
+#include"../Application/Platform/Platform.h"
+
+class Graphics;
 
 class CoreManager
 {
@@ -10,10 +12,12 @@ private:
 	std::unique_ptr<Impl> impl_;
 public:
 	CoreManager() = delete;
-	CoreManager(std::unique_ptr<Window>&);
+	CoreManager(Platform&);
 	~CoreManager();
 
 	bool Initialize(void);
 	bool Run(void);
 	void Exit(void);
+
+	Graphics& GetGraphics(void);
 };
\ No newline at end of file
@@ -0,0 +1,328 @@
+#include<mutex>
+#include<vector>
+#include<cstring>
+#include<algorithm>
+#include<unordered_map>
+
+#include"DescriptorAllocator.h"
+#include"../Utilities/Utils.h"
+#include"../Utilities/Log.h"
+
+namespace
+{
+	// sets per pool, descriptor counts scale with it
+	const uint32_t pool_set_count = 256;
+
+	const std::pair<vk::DescriptorType, float> pool_ratios[] =
+	{
+		{ vk::DescriptorType::eSampler,					0.5f },
+		{ vk::DescriptorType::eCombinedImageSampler,	4.0f },
+		{ vk::DescriptorType::eSampledImage,			2.0f },
+		{ vk::DescriptorType::eStorageImage,			1.0f },
+		{ vk::DescriptorType::eUniformTexelBuffer,		0.5f },
+		{ vk::DescriptorType::eStorageTexelBuffer,		0.5f },
+		{ vk::DescriptorType::eUniformBuffer,			2.0f },
+		{ vk::DescriptorType::eUniformBufferDynamic,	1.0f },
+		{ vk::DescriptorType::eStorageBuffer,			2.0f },
+		{ vk::DescriptorType::eStorageBufferDynamic,	0.5f },
+		{ vk::DescriptorType::eInputAttachment,			0.5f },
+	};
+
+	// the wrappers hold only the raw handle, a pointer or a uint64_t
+	template<class T>
+	uint64_t HandleBits(T handle)
+	{
+		static_assert(sizeof(T) <= sizeof(uint64_t), "handle wider than 64 bits");
+		uint64_t bits = 0;
+		std::memcpy(&bits, &handle, sizeof(T));
+		return bits;
+	}
+
+	bool IsImageType(vk::DescriptorType type)
+	{
+		return type == vk::DescriptorType::eSampler ||
+			type == vk::DescriptorType::eCombinedImageSampler ||
+			type == vk::DescriptorType::eSampledImage ||
+			type == vk::DescriptorType::eStorageImage ||
+			type == vk::DescriptorType::eInputAttachment;
+	}
+
+	bool IsTexelBufferType(vk::DescriptorType type)
+	{
+		return type == vk::DescriptorType::eUniformTexelBuffer ||
+			type == vk::DescriptorType::eStorageTexelBuffer;
+	}
+}
+
+class DescriptorAllocator::Impl
+{
+public:
+	struct CacheEntry
+	{
+		std::vector<uint64_t>	key;		// full contents, the hash alone may collide
+		vk::DescriptorSet		set;
+	};
+
+	struct Frame
+	{
+		std::vector<vk::DescriptorPool>					pools;
+		uint32_t										current;
+		uint32_t										allocated;
+		uint32_t										cache_hits;
+		std::unordered_map<uint64_t, CacheEntry>		cache;
+	};
+
+	vk::Device				device_;
+	uint32_t				frame_count_;
+	uint32_t				frame_index_;
+	std::vector<Frame>		frames_;
+	std::mutex				mutex_;
+
+	Impl(vk::Device device, uint32_t frame_count)
+		: device_(device)
+		, frame_count_(frame_count)
+		, frame_index_(0) {}
+
+	vk::DescriptorPool CreatePool(void)
+	{
+		std::vector<vk::DescriptorPoolSize> sizes;
+		for (auto& ratio : pool_ratios)
+		{
+			sizes.push_back(vk::DescriptorPoolSize(ratio.first, static_cast<uint32_t>(ratio.second * pool_set_count)));
+		}
+
+		// no free descriptor set bit, sets only go away with a reset
+		auto const pool_info = vk::DescriptorPoolCreateInfo()
+			.setMaxSets(pool_set_count)
+			.setPoolSizeCount(static_cast<uint32_t>(sizes.size()))
+			.setPPoolSizes(sizes.data());
+
+		vk::DescriptorPool pool;
+		auto result = device_.createDescriptorPool(&pool_info, nullptr, &pool);
+		if (result != vk::Result::eSuccess)
+		{
+			Log::Error("Descriptor pool cannot created.");
+			return vk::DescriptorPool();
+		}
+
+		VulkanStats::CountCreated();
+
+		return pool;
+	}
+
+	// mutex held
+	vk::DescriptorSet AllocateLocked(vk::DescriptorSetLayout layout)
+	{
+		auto& frame = frames_[frame_index_];
+
+		auto const alloc_info = vk::DescriptorSetAllocateInfo()
+			.setDescriptorSetCount(1)
+			.setPSetLayouts(&layout);
+
+		for (;;)
+		{
+			bool created = false;
+			if (frame.current == frame.pools.size())
+			{
+				auto pool = CreatePool();
+				if (!pool) return vk::DescriptorSet();
+
+				frame.pools.push_back(pool);
+				created = true;
+			}
+
+			auto info = alloc_info;
+			info.setDescriptorPool(frame.pools[frame.current]);
+
+			vk::DescriptorSet set;
+			auto result = device_.allocateDescriptorSets(&info, &set);
+			if (result == vk::Result::eSuccess)
+			{
+				++frame.allocated;
+				return set;
+			}
+
+			// exhausted, move on to the next pool of the frame
+			// a fresh pool that cannot hold it never will : an update after bind layout
+			// or a binding larger than its type's share
+			if (result == vk::Result::eErrorOutOfPoolMemory || result == vk::Result::eErrorFragmentedPool)
+			{
+				if (created)
+				{
+					Log::Error("Descriptor set does not fit in an empty pool.");
+					return vk::DescriptorSet();
+				}
+
+				++frame.current;
+				continue;
+			}
+
+			Log::Error("Descriptor set cannot allocated.");
+			return vk::DescriptorSet();
+		}
+	}
+};
+
+DescriptorAllocator::DescriptorAllocator(vk::Device device, uint32_t frame_count) : impl_(std::make_unique<Impl>(device, frame_count)) {}
+
+DescriptorAllocator::~DescriptorAllocator() = default;
+
+bool DescriptorAllocator::Initialize(void)
+{
+	impl_->frames_.resize(impl_->frame_count_);
+
+	// one pool per frame up front, the rest grow on demand
+	for (auto& frame : impl_->frames_)
+	{
+		auto pool = impl_->CreatePool();
+		if (!pool) return false;
+
+		frame.pools.push_back(pool);
+		frame.current = 0;
+		frame.allocated = 0;
+		frame.cache_hits = 0;
+	}
+
+	Log::Info("Descriptor allocator create done.");
+
+	return true;
+}
+
+void DescriptorAllocator::Destroy(void)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	for (auto& frame : impl_->frames_)
+	{
+		for (auto& pool : frame.pools)
+		{
+			impl_->device_.destroyDescriptorPool(pool);
+		}
+	}
+	impl_->frames_.clear();
+}
+
+void DescriptorAllocator::BeginFrame(uint32_t frame_index)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	impl_->frame_index_ = frame_index % impl_->frame_count_;
+
+	auto& frame = impl_->frames_[impl_->frame_index_];
+
+	// only the pools used last time need a reset
+	const auto used = std::min<size_t>(frame.current + 1, frame.pools.size());
+	for (size_t i = 0; i < used; ++i)
+	{
+		impl_->device_.resetDescriptorPool(frame.pools[i], vk::DescriptorPoolResetFlags());
+	}
+
+	frame.current = 0;
+	frame.allocated = 0;
+	frame.cache_hits = 0;
+	frame.cache.clear();
+}
+
+vk::DescriptorSet DescriptorAllocator::Allocate(vk::DescriptorSetLayout layout)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	return impl_->AllocateLocked(layout);
+}
+
+vk::DescriptorSet DescriptorAllocator::Get(vk::DescriptorSetLayout layout, const std::vector<Write>& writes)
+{
+	std::vector<uint64_t> key;
+	key.reserve(1 + writes.size() * 5);
+
+	key.push_back(HandleBits(layout));
+	for (auto& write : writes)
+	{
+		key.push_back(static_cast<uint64_t>(write.binding) << 32 | write.array_element);
+		key.push_back(static_cast<uint64_t>(write.type));
+		if (IsImageType(write.type))
+		{
+			key.push_back(HandleBits(write.image.imageView));
+			key.push_back(HandleBits(write.image.sampler));
+			key.push_back(static_cast<uint64_t>(write.image.imageLayout));
+		}
+		else if (IsTexelBufferType(write.type))
+		{
+			key.push_back(HandleBits(write.texel_buffer));
+		}
+		else
+		{
+			key.push_back(HandleBits(write.buffer.buffer));
+			key.push_back(write.buffer.offset);
+			key.push_back(write.buffer.range);
+		}
+	}
+
+	auto hash = HashUtils::Hash64(key.data(), key.size() * sizeof(uint64_t));
+
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	auto& frame = impl_->frames_[impl_->frame_index_];
+
+	auto found = frame.cache.find(hash);
+	if (found != frame.cache.end() && found->second.key == key)
+	{
+		++frame.cache_hits;
+		return found->second.set;
+	}
+
+	auto set = impl_->AllocateLocked(layout);
+	if (!set) return set;
+
+	std::vector<vk::WriteDescriptorSet> descriptor_writes;
+	descriptor_writes.reserve(writes.size());
+	for (auto& write : writes)
+	{
+		auto descriptor_write = vk::WriteDescriptorSet()
+			.setDstSet(set)
+			.setDstBinding(write.binding)
+			.setDstArrayElement(write.array_element)
+			.setDescriptorCount(1)
+			.setDescriptorType(write.type);
+
+		if (IsImageType(write.type)) descriptor_write.setPImageInfo(&write.image);
+		else if (IsTexelBufferType(write.type)) descriptor_write.setPTexelBufferView(&write.texel_buffer);
+		else descriptor_write.setPBufferInfo(&write.buffer);
+
+		descriptor_writes.push_back(descriptor_write);
+	}
+
+	impl_->device_.updateDescriptorSets(static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data(), 0, nullptr);
+
+	// a colliding entry stays, the new set is just not cached
+	if (found == frame.cache.end())
+	{
+		frame.cache.emplace(hash, Impl::CacheEntry{ std::move(key), set });
+	}
+
+	return set;
+}
+
+uint32_t DescriptorAllocator::GetPoolCount(void) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	uint32_t count = 0;
+	for (auto& frame : impl_->frames_)
+	{
+		count += static_cast<uint32_t>(frame.pools.size());
+	}
+	return count;
+}
+
+uint32_t DescriptorAllocator::GetAllocatedCount(void) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	return impl_->frames_.empty() ? 0 : impl_->frames_[impl_->frame_index_].allocated;
+}
+
+uint32_t DescriptorAllocator::GetCacheHitCount(void) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	return impl_->frames_.empty() ? 0 : impl_->frames_[impl_->frame_index_].cache_hits;
+}
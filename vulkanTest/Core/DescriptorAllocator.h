@@ -0,0 +1,66 @@
+#pragma once
+
+#include<memory>
+#include<vector>
+#include"VulkanCommon.h"
+
+// Transient descriptor sets for the non-bindless path.
+// Each frame in flight owns a growing list of pools, sets are never freed one by
+// one, the frame's pools are reset together when the slot comes around.
+// Sets with the same layout and contents are shared inside a frame.
+class DescriptorAllocator
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	// one descriptor of a set
+	struct Write
+	{
+		uint32_t					binding;
+		uint32_t					array_element;
+		vk::DescriptorType			type;
+		vk::DescriptorImageInfo		image;
+		vk::DescriptorBufferInfo	buffer;
+		vk::BufferView				texel_buffer;	// uniform and storage texel buffers
+
+		static Write Image(uint32_t binding, vk::DescriptorType type, vk::ImageView view, vk::Sampler sampler, vk::ImageLayout layout, uint32_t array_element = 0)
+		{
+			return { binding, array_element, type, vk::DescriptorImageInfo(sampler, view, layout), vk::DescriptorBufferInfo(), vk::BufferView() };
+		}
+
+		static Write Buffer(uint32_t binding, vk::DescriptorType type, vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range, uint32_t array_element = 0)
+		{
+			return { binding, array_element, type, vk::DescriptorImageInfo(), vk::DescriptorBufferInfo(buffer, offset, range), vk::BufferView() };
+		}
+
+		static Write TexelBuffer(uint32_t binding, vk::DescriptorType type, vk::BufferView view, uint32_t array_element = 0)
+		{
+			return { binding, array_element, type, vk::DescriptorImageInfo(), vk::DescriptorBufferInfo(), view };
+		}
+	};
+
+	DescriptorAllocator() = delete;
+	DescriptorAllocator(vk::Device, uint32_t frame_count);
+	~DescriptorAllocator();
+
+	bool Initialize(void);
+	void Destroy(void);
+
+	// the frame's previous work must have completed, resets its pools and cache
+	void BeginFrame(uint32_t frame_index);
+
+	// thread safe, valid until the frame slot comes around
+	// uninitialized set, the caller writes it
+	vk::DescriptorSet Allocate(vk::DescriptorSetLayout);
+
+	// cached by layout and contents, written on a miss
+	vk::DescriptorSet Get(vk::DescriptorSetLayout, const std::vector<Write>&);
+
+	uint32_t GetPoolCount(void) const;
+
+	// current frame
+	uint32_t GetAllocatedCount(void) const;
+	uint32_t GetCacheHitCount(void) const;
+};
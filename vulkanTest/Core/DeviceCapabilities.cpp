@@ -0,0 +1,434 @@
+#include<cstring>
+#include<iterator>
+#include<algorithm>
+
+#include"DeviceCapabilities.h"
+#include"../Utilities/Utils.h"
+#include"../Utilities/Log.h"
+
+namespace
+{
+	constexpr uint32_t file_magic = 0x43444b56;	// "VKDC"
+	constexpr uint32_t file_version = 1;
+	constexpr uint32_t data_limit = 4096;	// queue families or extensions per record, more is a corrupt file
+
+	// a header built with other vulkan headers has other struct sizes and is discarded
+	struct FileHeader
+	{
+		uint32_t	magic;
+		uint32_t	version;
+		uint32_t	features_size;
+		uint32_t	memory_size;
+		uint32_t	queue_family_size;
+		uint32_t	indexing_features_size;
+		uint32_t	indexing_props_size;
+		uint32_t	record_count;
+	};
+
+	FileHeader MakeHeader(uint32_t record_count)
+	{
+		return {
+			file_magic,
+			file_version,
+			sizeof(vk::PhysicalDeviceFeatures),
+			sizeof(vk::PhysicalDeviceMemoryProperties),
+			sizeof(vk::QueueFamilyProperties),
+			sizeof(vk::PhysicalDeviceDescriptorIndexingFeaturesEXT),
+			sizeof(vk::PhysicalDeviceDescriptorIndexingPropertiesEXT),
+			record_count };
+	}
+
+	class Writer
+	{
+	public:
+		std::vector<char> data;
+
+		void Write(const void* src, size_t size)
+		{
+			auto bytes = static_cast<const char*>(src);
+			data.insert(data.end(), bytes, bytes + size);
+		}
+
+		template<class T>
+		void Write(const T& value) { Write(&value, sizeof(T)); }
+	};
+
+	class Reader
+	{
+	public:
+		const std::vector<char>&	data;
+		size_t						offset;
+
+		Reader(const std::vector<char>& src) : data(src), offset(0) {}
+
+		bool Read(void* dst, size_t size)
+		{
+			if (data.size() - offset < size) return false;
+			std::memcpy(dst, data.data() + offset, size);
+			offset += size;
+			return true;
+		}
+
+		template<class T>
+		bool Read(T& value) { return Read(&value, sizeof(T)); }
+	};
+
+	// VkPhysicalDeviceFeatures is nothing but VkBool32 members in this order
+	const char* feature_names[] =
+	{
+		"robustBufferAccess", "fullDrawIndexUint32", "imageCubeArray", "independentBlend",
+		"geometryShader", "tessellationShader", "sampleRateShading", "dualSrcBlend",
+		"logicOp", "multiDrawIndirect", "drawIndirectFirstInstance", "depthClamp",
+		"depthBiasClamp", "fillModeNonSolid", "depthBounds", "wideLines",
+		"largePoints", "alphaToOne", "multiViewport", "samplerAnisotropy",
+		"textureCompressionETC2", "textureCompressionASTC_LDR", "textureCompressionBC", "occlusionQueryPrecise",
+		"pipelineStatisticsQuery", "vertexPipelineStoresAndAtomics", "fragmentStoresAndAtomics", "shaderTessellationAndGeometryPointSize",
+		"shaderImageGatherExtended", "shaderStorageImageExtendedFormats", "shaderStorageImageMultisample", "shaderStorageImageReadWithoutFormat",
+		"shaderStorageImageWriteWithoutFormat", "shaderUniformBufferArrayDynamicIndexing", "shaderSampledImageArrayDynamicIndexing", "shaderStorageBufferArrayDynamicIndexing",
+		"shaderStorageImageArrayDynamicIndexing", "shaderClipDistance", "shaderCullDistance", "shaderFloat64",
+		"shaderInt64", "shaderInt16", "shaderResourceResidency", "shaderResourceMinLod",
+		"sparseBinding", "sparseResidencyBuffer", "sparseResidencyImage2D", "sparseResidencyImage3D",
+		"sparseResidency2Samples", "sparseResidency4Samples", "sparseResidency8Samples", "sparseResidency16Samples",
+		"sparseResidencyAliased", "variableMultisampleRate", "inheritedQueries",
+	};
+
+	static_assert(DeviceCapabilities::feature_count == std::size(feature_names), "feature names out of date");
+
+	std::string VersionString(uint32_t version)
+	{
+		return std::to_string(VK_VERSION_MAJOR(version)) + "." +
+			std::to_string(VK_VERSION_MINOR(version)) + "." +
+			std::to_string(VK_VERSION_PATCH(version));
+	}
+
+	const char* DeviceTypeString(vk::PhysicalDeviceType type)
+	{
+		switch (type)
+		{
+		case vk::PhysicalDeviceType::eIntegratedGpu:	return "integrated";
+		case vk::PhysicalDeviceType::eDiscreteGpu:		return "discrete";
+		case vk::PhysicalDeviceType::eVirtualGpu:		return "virtual";
+		case vk::PhysicalDeviceType::eCpu:				return "cpu";
+		default:										return "other";
+		}
+	}
+}
+
+const char* DeviceCapabilities::GetFeatureName(size_t index)
+{
+	return index < feature_count ? feature_names[index] : "";
+}
+
+bool DeviceCapabilities::HasExtension(const char* name) const
+{
+	return std::any_of(extensions.begin(), extensions.end(), [name](const std::string& extension) { return extension == name; });
+}
+
+void DeviceCapabilities::LogSummary(uint32_t index) const
+{
+	vk::DeviceSize local_memory = 0;
+	for (uint32_t i = 0; i < memory.memoryHeapCount; ++i)
+	{
+		if (memory.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal) local_memory += memory.memoryHeaps[i].size;
+	}
+
+	Log::Info("VulkanPhysicalDevice[" + std::to_string(index) + "] " +
+		properties.deviceName + ", " + DeviceTypeString(properties.deviceType) +
+		", api " + VersionString(properties.apiVersion) +
+		", " + std::to_string(local_memory >> 20) + " MB local" +
+		(cached ? ", cached" : ""));
+}
+
+void DeviceCapabilities::Dump(uint32_t index, uint32_t count) const
+{
+	Log::Info("\n================ VulkanPhysicalDevice[%d/%d] ================", index + 1, count);
+	Log::Info(std::string(properties.deviceName));
+	Log::Info("apiVersion = " + VersionString(properties.apiVersion) + "\n");
+
+	for (uint32_t j = 0; j < queue_families.size(); ++j)
+	{
+		auto flags = queue_families[j].queueFlags;
+
+		std::string str = "";
+		if (flags & vk::QueueFlagBits::eGraphics)		str += "GRAPHICS ";
+		if (flags & vk::QueueFlagBits::eCompute)		str += "COMPUTE ";
+		if (flags & vk::QueueFlagBits::eTransfer)		str += "TRANSFER ";
+		if (flags & vk::QueueFlagBits::eSparseBinding)	str += "SPARSE ";
+		if (flags & vk::QueueFlagBits::eProtected)		str += "PROTECTED ";
+
+		Log::Info("QueueFamily[%d/%d] queueFlags:" + str, j + 1, static_cast<uint32_t>(queue_families.size()));
+	}
+
+	Log::Info("Extension Count = %d", static_cast<uint32_t>(extensions.size()));
+	for (auto& extension : extensions)
+	{
+		Log::Info("  " + extension);
+	}
+
+	Log::Info("enable features : true = 1, false = 0\n");
+
+	const auto flags = reinterpret_cast<const VkBool32*>(&features);
+	for (size_t i = 0; i < feature_count; ++i)
+	{
+		Log::Info("%s = %d", feature_names[i], flags[i]);
+	}
+
+	for (uint32_t j = 0; j < memory.memoryHeapCount; ++j)
+	{
+		auto& heap = memory.memoryHeaps[j];
+		Log::Info("MemoryHeap[%d/%d] %llu MB%s", j + 1, memory.memoryHeapCount,
+			static_cast<unsigned long long>(heap.size >> 20),
+			(heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal) ? " DEVICE_LOCAL" : "");
+	}
+
+	Log::Info("Descriptor indexing queried = %d\n", descriptor_indexing_queried ? 1 : 0);
+}
+
+class DeviceCapabilityCache::Impl
+{
+public:
+	std::string							path_;
+	uint32_t							instance_api_version_;
+	std::vector<DeviceCapabilities>		records_;	// from the file
+	std::vector<DeviceCapabilities>		current_;	// every Get this run, what Save writes
+	bool								dirty_;
+
+	Impl(const std::string& path, uint32_t instance_api_version)
+		: path_(path)
+		, instance_api_version_(instance_api_version)
+		, dirty_(false) {}
+
+	static void QueryKey(DeviceCapabilities& caps, uint32_t instance_api_version)
+	{
+		caps.gpu.getProperties(&caps.properties);
+
+		// the pipeline cache uuid changes with the driver build too, good enough without the 1.1 id
+		std::memcpy(caps.uuid, caps.properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+		if (instance_api_version >= VK_API_VERSION_1_1 && caps.properties.apiVersion >= VK_API_VERSION_1_1)
+		{
+			vk::PhysicalDeviceIDProperties id_props;
+			vk::PhysicalDeviceProperties2 props2;
+			props2.pNext = &id_props;
+			caps.gpu.getProperties2(&props2);
+
+			std::memcpy(caps.uuid, id_props.deviceUUID, VK_UUID_SIZE);
+		}
+	}
+
+	void Query(DeviceCapabilities& caps) const
+	{
+		auto& gpu = caps.gpu;
+
+		gpu.getFeatures(&caps.features);
+		gpu.getMemoryProperties(&caps.memory);
+
+		uint32_t family_count = 0;
+		gpu.getQueueFamilyProperties(&family_count, nullptr);
+		caps.queue_families.resize(family_count);
+		gpu.getQueueFamilyProperties(&family_count, caps.queue_families.data());
+
+		uint32_t extension_count = 0;
+		auto result = gpu.enumerateDeviceExtensionProperties(nullptr, &extension_count, nullptr);
+		std::vector<vk::ExtensionProperties> extensions(extension_count);
+		if (result == vk::Result::eSuccess && extension_count > 0)
+		{
+			result = gpu.enumerateDeviceExtensionProperties(nullptr, &extension_count, extensions.data());
+			extensions.resize(extension_count);
+		}
+		if (result != vk::Result::eSuccess)
+		{
+			Log::Error("vkEnumerateDeviceExtensionProperties failed.");
+			extensions.clear();
+		}
+
+		caps.extensions.clear();
+		for (auto& extension : extensions)
+		{
+			caps.extensions.push_back(extension.extensionName);
+		}
+
+		caps.descriptor_indexing_queried = IsIndexingQueryable(caps);
+		caps.descriptor_indexing_features = vk::PhysicalDeviceDescriptorIndexingFeaturesEXT();
+		caps.descriptor_indexing_props = vk::PhysicalDeviceDescriptorIndexingPropertiesEXT();
+
+		if (caps.descriptor_indexing_queried)
+		{
+			auto features2 = vk::PhysicalDeviceFeatures2().setPNext(&caps.descriptor_indexing_features);
+			gpu.getFeatures2(&features2);
+
+			vk::PhysicalDeviceProperties2 props2;
+			props2.pNext = &caps.descriptor_indexing_props;
+			gpu.getProperties2(&props2);
+
+			caps.descriptor_indexing_features.pNext = nullptr;
+			caps.descriptor_indexing_props.pNext = nullptr;
+		}
+	}
+
+	bool IsIndexingQueryable(const DeviceCapabilities& caps) const
+	{
+		return instance_api_version_ >= VK_API_VERSION_1_1 && caps.properties.apiVersion >= VK_API_VERSION_1_1 &&
+			caps.HasExtension(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+	}
+
+	static void WriteRecord(Writer& writer, const DeviceCapabilities& caps)
+	{
+		writer.Write(caps.uuid, VK_UUID_SIZE);
+		writer.Write(caps.properties.driverVersion);
+		writer.Write(caps.features);
+		writer.Write(caps.memory);
+
+		writer.Write(static_cast<uint32_t>(caps.queue_families.size()));
+		writer.Write(caps.queue_families.data(), caps.queue_families.size() * sizeof(vk::QueueFamilyProperties));
+
+		writer.Write(static_cast<uint32_t>(caps.extensions.size()));
+		for (auto& extension : caps.extensions)
+		{
+			writer.Write(static_cast<uint8_t>(extension.size()));
+			writer.Write(extension.data(), extension.size());
+		}
+
+		writer.Write(static_cast<uint8_t>(caps.descriptor_indexing_queried ? 1 : 0));
+		writer.Write(caps.descriptor_indexing_features);
+		writer.Write(caps.descriptor_indexing_props);
+	}
+
+	static bool ReadRecord(Reader& reader, DeviceCapabilities& caps)
+	{
+		uint32_t family_count, extension_count;
+		uint8_t indexing_queried;
+
+		if (!reader.Read(caps.uuid, VK_UUID_SIZE)) return false;
+		if (!reader.Read(caps.properties.driverVersion)) return false;
+		if (!reader.Read(caps.features)) return false;
+		if (!reader.Read(caps.memory)) return false;
+
+		if (!reader.Read(family_count) || family_count > data_limit) return false;
+		caps.queue_families.resize(family_count);
+		if (!reader.Read(caps.queue_families.data(), family_count * sizeof(vk::QueueFamilyProperties))) return false;
+
+		if (!reader.Read(extension_count) || extension_count > data_limit) return false;
+		caps.extensions.clear();
+		for (uint32_t i = 0; i < extension_count; ++i)
+		{
+			uint8_t length;
+			char name[256];
+			if (!reader.Read(length) || !reader.Read(name, length)) return false;
+			caps.extensions.emplace_back(name, length);
+		}
+
+		if (!reader.Read(indexing_queried)) return false;
+		if (!reader.Read(caps.descriptor_indexing_features)) return false;
+		if (!reader.Read(caps.descriptor_indexing_props)) return false;
+
+		caps.descriptor_indexing_queried = indexing_queried != 0;
+		caps.descriptor_indexing_features.pNext = nullptr;
+		caps.descriptor_indexing_props.pNext = nullptr;
+
+		return true;
+	}
+};
+
+DeviceCapabilityCache::DeviceCapabilityCache(const std::string& path, uint32_t instance_api_version)
+	: impl_(std::make_unique<Impl>(path, instance_api_version)) {}
+
+DeviceCapabilityCache::~DeviceCapabilityCache() = default;
+
+bool DeviceCapabilityCache::Load(void)
+{
+	impl_->records_.clear();
+
+	std::vector<char> data;
+	if (!FileUtils::ReadBinary(impl_->path_, data)) return false;
+
+	Reader reader(data);
+
+	FileHeader header;
+	const auto expected = MakeHeader(0);
+	if (!reader.Read(header) || header.magic != expected.magic || header.version != expected.version ||
+		header.features_size != expected.features_size ||
+		header.memory_size != expected.memory_size ||
+		header.queue_family_size != expected.queue_family_size ||
+		header.indexing_features_size != expected.indexing_features_size ||
+		header.indexing_props_size != expected.indexing_props_size)
+	{
+		Log::Warning("Device capability file is stale, discarded.");
+		return false;
+	}
+
+	for (uint32_t i = 0; i < header.record_count; ++i)
+	{
+		DeviceCapabilities caps = {};
+		if (!Impl::ReadRecord(reader, caps))
+		{
+			Log::Warning("Device capability file is truncated, discarded.");
+			impl_->records_.clear();
+			return false;
+		}
+		impl_->records_.push_back(std::move(caps));
+	}
+
+	return true;
+}
+
+DeviceCapabilities DeviceCapabilityCache::Get(vk::PhysicalDevice gpu)
+{
+	DeviceCapabilities caps = {};
+	caps.gpu = gpu;
+
+	Impl::QueryKey(caps, impl_->instance_api_version_);
+
+	auto record = std::find_if(impl_->records_.begin(), impl_->records_.end(), [&caps](const DeviceCapabilities& candidate)
+	{
+		return std::memcmp(candidate.uuid, caps.uuid, VK_UUID_SIZE) == 0 && candidate.properties.driverVersion == caps.properties.driverVersion;
+	});
+
+	if (record != impl_->records_.end())
+	{
+		caps.features = record->features;
+		caps.memory = record->memory;
+		caps.queue_families = record->queue_families;
+		caps.extensions = record->extensions;
+		caps.descriptor_indexing_queried = record->descriptor_indexing_queried;
+		caps.descriptor_indexing_features = record->descriptor_indexing_features;
+		caps.descriptor_indexing_props = record->descriptor_indexing_props;
+
+		// written under another instance version, may lack what this one can query
+		caps.cached = caps.descriptor_indexing_queried == impl_->IsIndexingQueryable(caps);
+	}
+
+	if (!caps.cached)
+	{
+		impl_->Query(caps);
+		impl_->dirty_ = true;
+	}
+
+	impl_->current_.push_back(caps);
+
+	return caps;
+}
+
+bool DeviceCapabilityCache::Save(void)
+{
+	if (!impl_->dirty_ && impl_->current_.size() == impl_->records_.size()) return true;
+
+	Writer writer;
+	writer.Write(MakeHeader(static_cast<uint32_t>(impl_->current_.size())));
+
+	for (auto& caps : impl_->current_)
+	{
+		Impl::WriteRecord(writer, caps);
+	}
+
+	if (!FileUtils::WriteBinaryAtomic(impl_->path_, writer.data.data(), writer.data.size()))
+	{
+		Log::Error("Device capability file cannot written.");
+		return false;
+	}
+
+	impl_->records_ = impl_->current_;
+	impl_->dirty_ = false;
+
+	return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include<memory>
+#include<string>
+#include<vector>
+#include"VulkanCommon.h"
+
+// What device selection and creation read from a gpu.
+// properties are always queried, they carry the key : device uuid (pipeline cache uuid before 1.1) and driver version.
+struct DeviceCapabilities
+{
+	vk::PhysicalDevice									gpu;
+	vk::PhysicalDeviceProperties						properties;
+	uint8_t												uuid[VK_UUID_SIZE];
+	vk::PhysicalDeviceFeatures							features;
+	vk::PhysicalDeviceMemoryProperties					memory;
+	std::vector<vk::QueueFamilyProperties>				queue_families;
+	std::vector<std::string>							extensions;
+	bool												descriptor_indexing_queried;	// instance and device 1.1 with the extension
+	vk::PhysicalDeviceDescriptorIndexingFeaturesEXT		descriptor_indexing_features;
+	vk::PhysicalDeviceDescriptorIndexingPropertiesEXT	descriptor_indexing_props;
+	bool												cached;		// read from the file this run
+
+	// vk::PhysicalDeviceFeatures as an array of VkBool32
+	static constexpr size_t feature_count = sizeof(vk::PhysicalDeviceFeatures) / sizeof(VkBool32);
+	static const char* GetFeatureName(size_t index);
+
+	bool HasExtension(const char* name) const;
+
+	// one line per gpu on every launch, index as --gpu takes it
+	// Dump is the full listing for --device-info
+	void LogSummary(uint32_t index) const;
+	void Dump(uint32_t index, uint32_t count) const;
+};
+
+// Keeps DeviceCapabilities on disk between runs, one record per gpu.
+// A record is reused while the uuid and driver version match, a driver update queries the gpu again.
+class DeviceCapabilityCache
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	DeviceCapabilityCache() = delete;
+	DeviceCapabilityCache(const std::string& path, uint32_t instance_api_version);
+	~DeviceCapabilityCache();
+
+	// false when the file is missing, stale or from another build
+	bool Load(void);
+
+	DeviceCapabilities Get(vk::PhysicalDevice);
+
+	// skipped when every gpu came from the file
+	bool Save(void);
+};
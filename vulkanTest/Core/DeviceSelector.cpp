@@ -0,0 +1,222 @@
+#include<cctype>
+#include<iterator>
+#include<algorithm>
+
+#include"DeviceSelector.h"
+#include"../Utilities/Log.h"
+
+namespace
+{
+	int TypeScore(vk::PhysicalDeviceType type)
+	{
+		switch (type)
+		{
+		case vk::PhysicalDeviceType::eDiscreteGpu:		return 1000;
+		case vk::PhysicalDeviceType::eIntegratedGpu:	return 400;
+		case vk::PhysicalDeviceType::eVirtualGpu:		return 300;
+		case vk::PhysicalDeviceType::eCpu:				return 100;
+		default:										return 0;
+		}
+	}
+
+	// integrated gpus report shared system memory as device local, type still outweighs it
+	int MemoryScore(const vk::PhysicalDeviceMemoryProperties& memory)
+	{
+		vk::DeviceSize largest = 0;
+		for (uint32_t i = 0; i < memory.memoryHeapCount; ++i)
+		{
+			if (memory.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal)
+			{
+				largest = std::max(largest, memory.memoryHeaps[i].size);
+			}
+		}
+
+		// a point per 32 MB up to 16 GB
+		return static_cast<int>(std::min<vk::DeviceSize>(largest >> 25, 512));
+	}
+
+	int QueueScore(const std::vector<vk::QueueFamilyProperties>& families)
+	{
+		// timestamps for the gpu profiler, async compute and copy queues
+		const auto any = [&families](vk::QueueFlags with, vk::QueueFlags without)
+		{
+			return std::any_of(families.begin(), families.end(), [&](const vk::QueueFamilyProperties& family)
+			{
+				return (family.queueFlags & with) && !(family.queueFlags & without);
+			});
+		};
+
+		const bool timestamps = std::any_of(families.begin(), families.end(), [](const vk::QueueFamilyProperties& family)
+		{
+			return (family.queueFlags & vk::QueueFlagBits::eGraphics) && family.timestampValidBits > 0;
+		});
+
+		int score = timestamps ? 20 : 0;
+		if (any(vk::QueueFlagBits::eCompute, vk::QueueFlagBits::eGraphics)) score += 20;
+		if (any(vk::QueueFlagBits::eTransfer, vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute)) score += 20;
+
+		return score;
+	}
+
+	void AddMissing(DeviceSelector::Score& score, const std::string& what)
+	{
+		score.suitable = false;
+		score.missing += (score.missing.empty() ? "" : ", ") + what;
+	}
+
+	std::string ToLower(std::string str)
+	{
+		std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return str;
+	}
+
+	// -1 when nothing matches
+	int FindOverride(const std::vector<DeviceCapabilities>& capabilities, const std::string& value)
+	{
+		if (value.size() <= 4 && std::all_of(value.begin(), value.end(), [](unsigned char c) { return std::isdigit(c) != 0; }))
+		{
+			const auto index = std::stoul(value);
+			return index < capabilities.size() ? static_cast<int>(index) : -1;
+		}
+
+		std::string hex;
+		std::copy_if(value.begin(), value.end(), std::back_inserter(hex), [](char c) { return c != '-'; });
+		hex = ToLower(hex);
+
+		if (hex.size() == VK_UUID_SIZE * 2 && std::all_of(hex.begin(), hex.end(), [](unsigned char c) { return std::isxdigit(c) != 0; }))
+		{
+			for (size_t i = 0; i < capabilities.size(); ++i)
+			{
+				auto uuid = DeviceSelector::UuidString(capabilities[i].uuid);
+				uuid.erase(std::remove(uuid.begin(), uuid.end(), '-'), uuid.end());
+				if (uuid == hex) return static_cast<int>(i);
+			}
+			return -1;
+		}
+
+		const auto name = ToLower(value);
+		for (size_t i = 0; i < capabilities.size(); ++i)
+		{
+			if (ToLower(capabilities[i].properties.deviceName).find(name) != std::string::npos) return static_cast<int>(i);
+		}
+
+		return -1;
+	}
+}
+
+DeviceSelector::Score DeviceSelector::Evaluate(const DeviceCapabilities& caps, const Requirements& requirements)
+{
+	Score score = {};
+	score.suitable = true;
+
+	for (auto extension : requirements.required_extensions)
+	{
+		if (!caps.HasExtension(extension)) AddMissing(score, extension);
+	}
+
+	for (auto extension : requirements.wanted_extensions)
+	{
+		if (caps.HasExtension(extension)) score.extensions += 50;
+	}
+
+	const auto supported = reinterpret_cast<const VkBool32*>(&caps.features);
+	const auto required = reinterpret_cast<const VkBool32*>(&requirements.required_features);
+	const auto wanted = reinterpret_cast<const VkBool32*>(&requirements.wanted_features);
+
+	for (size_t i = 0; i < DeviceCapabilities::feature_count; ++i)
+	{
+		if (required[i] && !supported[i]) AddMissing(score, DeviceCapabilities::GetFeatureName(i));
+		if (wanted[i] && supported[i]) score.features += 10;
+	}
+
+	// the device gets a single queue, it renders and presents
+	bool graphics = false;
+	for (uint32_t i = 0; i < caps.queue_families.size() && !graphics; ++i)
+	{
+		auto& family = caps.queue_families[i];
+		if (!(family.queueFlags & vk::QueueFlagBits::eGraphics) || family.queueCount == 0) continue;
+
+		uint32_t present_supported = VK_FALSE;
+		graphics = !requirements.surface ||
+			(caps.gpu.getSurfaceSupportKHR(i, requirements.surface, &present_supported) == vk::Result::eSuccess && present_supported == VK_TRUE);
+	}
+	if (!graphics) AddMissing(score, requirements.surface ? "graphics queue presenting to the window" : "graphics queue");
+
+	score.type = TypeScore(caps.properties.deviceType);
+	score.memory = MemoryScore(caps.memory);
+	score.queues = QueueScore(caps.queue_families);
+	score.api = caps.properties.apiVersion >= VK_API_VERSION_1_1 ? 50 : 0;
+	score.total = score.type + score.memory + score.extensions + score.features + score.queues + score.api;
+
+	return score;
+}
+
+int DeviceSelector::Select(const std::vector<DeviceCapabilities>& capabilities, const Requirements& requirements, const std::string& override_value)
+{
+	std::vector<Score> scores;
+	for (auto& caps : capabilities)
+	{
+		scores.push_back(Evaluate(caps, requirements));
+	}
+
+	int selected = -1;
+	bool overridden = false;
+
+	if (!override_value.empty())
+	{
+		const auto index = FindOverride(capabilities, override_value);
+		if (index < 0)
+		{
+			Log::Warning("GPU override " + override_value + " matches no device, selecting by score.");
+		}
+		else if (!scores[index].suitable)
+		{
+			Log::Warning("GPU override " + override_value + " is missing " + scores[index].missing + ", selecting by score.");
+		}
+		else
+		{
+			selected = index;
+			overridden = true;
+		}
+	}
+
+	// first enumerated wins a tie
+	for (size_t i = 0; i < scores.size() && !overridden; ++i)
+	{
+		if (scores[i].suitable && (selected < 0 || scores[i].total > scores[selected].total)) selected = static_cast<int>(i);
+	}
+
+	if (selected < 0)
+	{
+		for (size_t i = 0; i < capabilities.size(); ++i)
+		{
+			Log::Error("VulkanPhysicalDevice[" + std::to_string(i) + "] " + capabilities[i].properties.deviceName + " is missing " + scores[i].missing);
+		}
+		return -1;
+	}
+
+	auto& caps = capabilities[selected];
+	auto& score = scores[selected];
+
+	Log::Info("Selected VulkanPhysicalDevice[" + std::to_string(selected) + "] " + caps.properties.deviceName +
+		(overridden ? " by --gpu" : " by score") + ", uuid " + UuidString(caps.uuid));
+	Log::Info("  score %d : type %d, memory %d, extensions %d, features %d, queues %d, api %d",
+		score.total, score.type, score.memory, score.extensions, score.features, score.queues, score.api);
+
+	return selected;
+}
+
+std::string DeviceSelector::UuidString(const uint8_t (&uuid)[VK_UUID_SIZE])
+{
+	static const char digits[] = "0123456789abcdef";
+
+	// 8-4-4-4-12
+	std::string str;
+	for (size_t i = 0; i < VK_UUID_SIZE; ++i)
+	{
+		if (i == 4 || i == 6 || i == 8 || i == 10) str += '-';
+		str += digits[uuid[i] >> 4];
+		str += digits[uuid[i] & 0xf];
+	}
+	return str;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include<string>
+#include<vector>
+#include"DeviceCapabilities.h"
+
+// Scores every gpu and picks the highest.
+// Missing a required extension, feature or a graphics queue (that presents to the surface, when given) rules a gpu out,
+// otherwise device type dominates, then device local memory, wanted extensions and features, queues.
+// --gpu=<value> overrides the score : an index in enumeration order from 0, a device uuid in hex, or part of the name.
+namespace DeviceSelector
+{
+	struct Requirements
+	{
+		std::vector<const char*>	required_extensions;
+		std::vector<const char*>	wanted_extensions;
+		vk::PhysicalDeviceFeatures	required_features;
+		vk::PhysicalDeviceFeatures	wanted_features;
+		vk::SurfaceKHR				surface;	// null : headless, no presentation
+	};
+
+	struct Score
+	{
+		bool		suitable;
+		std::string	missing;	// why it is not, comma separated
+		int			type;
+		int			memory;
+		int			extensions;
+		int			features;
+		int			queues;
+		int			api;
+		int			total;
+	};
+
+	Score Evaluate(const DeviceCapabilities&, const Requirements&);
+
+	// index into capabilities, -1 when no gpu is suitable
+	// logs the chosen gpu's score breakdown
+	int Select(const std::vector<DeviceCapabilities>&, const Requirements&, const std::string& override_value);
+
+	std::string UuidString(const uint8_t (&uuid)[VK_UUID_SIZE]);
+}
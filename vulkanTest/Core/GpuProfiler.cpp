@@ -0,0 +1,322 @@
+#include<map>
+#include<cmath>
+#include<deque>
+#include<mutex>
+#include<vector>
+#include<algorithm>
+
+#include"GpuProfiler.h"
+#include"GpuTimeline.h"
+#include"../Utilities/Settings.h"
+#include"../Utilities/Log.h"
+
+class GpuProfiler::Impl
+{
+public:
+	static constexpr uint32_t no_query = 0xffffffff;
+
+	struct ScopeRecord
+	{
+		std::string	name;
+		uint32_t	depth;
+		uint32_t	begin_query;	// relative to the slot
+		uint32_t	end_query;
+	};
+
+	// one frame in flight
+	struct Slot
+	{
+		uint64_t					submit_value;
+		bool						pending;
+		uint32_t					query_count;
+		std::vector<ScopeRecord>	scopes;
+	};
+
+	struct History
+	{
+		uint32_t			depth;
+		double				last_ms;
+		std::deque<double>	samples;
+		std::vector<std::pair<std::string, uint64_t>>	counters;
+	};
+
+	vk::Device							device_;
+	GpuTimeline&						timeline_;
+	double								period_ns_;
+	uint64_t							valid_mask_;
+	uint32_t							frame_count_;
+	uint32_t							queries_per_frame_;
+	vk::QueryPool						pool_;
+
+	std::vector<Slot>					slots_;
+	uint32_t							current_;
+	std::vector<uint32_t>				open_;			// scope indices, no_query when dropped
+	bool								overflow_logged_;
+
+	mutable std::mutex					mutex_;
+	size_t								history_size_;
+	std::map<std::string, History>		history_;
+	std::vector<std::string>			last_order_;
+
+	Impl(vk::Device device, GpuTimeline& timeline, const vk::PhysicalDeviceLimits& limits, uint32_t timestamp_valid_bits, uint32_t frame_count)
+		: device_(device)
+		, timeline_(timeline)
+		, period_ns_(limits.timestampPeriod)
+		, valid_mask_(timestamp_valid_bits >= 64 ? ~0ull : (1ull << timestamp_valid_bits) - 1)
+		, frame_count_(frame_count)
+		, queries_per_frame_(Settings::gpu_profiler_max_scopes<uint32_t> * 2)
+		, current_(0)
+		, overflow_logged_(false)
+		, history_size_(Settings::gpu_profiler_history<size_t>)
+	{
+		if (timestamp_valid_bits == 0) valid_mask_ = 0;
+	}
+
+	uint32_t GetBase(uint32_t slot) const
+	{
+		return slot * queries_per_frame_;
+	}
+
+	// the slot's submission completed, no wait flag
+	void Resolve(uint32_t slot_index)
+	{
+		auto& slot = slots_[slot_index];
+		if (slot.query_count == 0) return;
+
+		std::vector<uint64_t> results(slot.query_count);
+		auto result = device_.getQueryPoolResults(pool_, GetBase(slot_index), slot.query_count,
+			results.size() * sizeof(uint64_t), results.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+		if (result != vk::Result::eSuccess) return;
+
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		last_order_.clear();
+		for (auto& scope : slot.scopes)
+		{
+			if (scope.end_query == no_query) continue;
+
+			const uint64_t ticks = (results[scope.end_query] - results[scope.begin_query]) & valid_mask_;
+			const double ms = ticks * period_ns_ / 1000000.0;
+
+			auto& history = history_[scope.name];
+			history.depth = scope.depth;
+			history.last_ms = ms;
+			history.samples.push_back(ms);
+			if (history.samples.size() > history_size_) history.samples.pop_front();
+
+			// a name used twice in a frame reports its last use
+			if (std::find(last_order_.begin(), last_order_.end(), scope.name) == last_order_.end())
+			{
+				last_order_.push_back(scope.name);
+			}
+		}
+	}
+
+	Timing MakeTiming(const std::string& name, const History& history) const
+	{
+		Timing timing = {};
+		timing.name = name;
+		timing.depth = history.depth;
+		timing.last_ms = history.last_ms;
+		timing.sample_count = static_cast<uint32_t>(history.samples.size());
+		timing.counters = history.counters;
+		if (history.samples.empty()) return timing;
+
+		std::vector<double> sorted(history.samples.begin(), history.samples.end());
+		std::sort(sorted.begin(), sorted.end());
+
+		double sum = 0.0;
+		for (auto sample : sorted) sum += sample;
+
+		const size_t p99_index = static_cast<size_t>(std::ceil(sorted.size() * 0.99)) - 1;
+
+		timing.average_ms = sum / sorted.size();
+		timing.min_ms = sorted.front();
+		timing.max_ms = sorted.back();
+		timing.p99_ms = sorted[std::min(p99_index, sorted.size() - 1)];
+
+		return timing;
+	}
+};
+
+GpuProfiler::GpuProfiler(vk::Device device, GpuTimeline& timeline, const vk::PhysicalDeviceLimits& limits, uint32_t timestamp_valid_bits, uint32_t frame_count)
+	: impl_(std::make_unique<Impl>(device, timeline, limits, timestamp_valid_bits, frame_count)) {}
+
+GpuProfiler::~GpuProfiler() = default;
+
+bool GpuProfiler::Initialize(void)
+{
+	impl_->slots_.resize(impl_->frame_count_);
+	for (auto& slot : impl_->slots_)
+	{
+		slot.submit_value = 0;
+		slot.pending = false;
+		slot.query_count = 0;
+	}
+
+	if (!impl_->valid_mask_)
+	{
+		Log::Warning("Graphics queue has no timestamps, gpu profiler disabled.");
+		return true;
+	}
+
+	auto const pool_info = vk::QueryPoolCreateInfo()
+		.setQueryType(vk::QueryType::eTimestamp)
+		.setQueryCount(impl_->queries_per_frame_ * impl_->frame_count_);
+
+	auto result = impl_->device_.createQueryPool(&pool_info, nullptr, &impl_->pool_);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Timestamp query pool cannot created.");
+		return false;
+	}
+
+	VulkanStats::CountCreated();
+
+	Log::Info("Gpu profiler create done.");
+
+	return true;
+}
+
+void GpuProfiler::Destroy(void)
+{
+	if (impl_->pool_) impl_->device_.destroyQueryPool(impl_->pool_);
+	impl_->pool_ = vk::QueryPool();
+}
+
+void GpuProfiler::BeginFrame(uint32_t frame_index, vk::CommandBuffer cmd_buffer)
+{
+	if (!impl_->pool_) return;
+
+	impl_->current_ = frame_index % impl_->frame_count_;
+
+	auto& slot = impl_->slots_[impl_->current_];
+	if (slot.pending && impl_->timeline_.IsCompleted(slot.submit_value))
+	{
+		impl_->Resolve(impl_->current_);
+	}
+
+	slot.pending = false;
+	slot.query_count = 0;
+	slot.scopes.clear();
+	impl_->open_.clear();
+
+	cmd_buffer.resetQueryPool(impl_->pool_, impl_->GetBase(impl_->current_), impl_->queries_per_frame_);
+}
+
+void GpuProfiler::EndFrame(uint64_t submit_value)
+{
+	if (!impl_->pool_) return;
+
+	if (!impl_->open_.empty())
+	{
+		Log::Warning("%d gpu profiler scopes left open.", static_cast<int>(impl_->open_.size()));
+		impl_->open_.clear();
+	}
+
+	auto& slot = impl_->slots_[impl_->current_];
+	slot.submit_value = submit_value;
+	slot.pending = submit_value != 0;
+}
+
+void GpuProfiler::BeginScope(vk::CommandBuffer cmd_buffer, const std::string& name)
+{
+	if (!impl_->pool_) return;
+
+	auto& slot = impl_->slots_[impl_->current_];
+
+	// room for the end query of every open scope
+	if (slot.query_count + impl_->open_.size() + 2 > impl_->queries_per_frame_)
+	{
+		if (!impl_->overflow_logged_) Log::Warning("Gpu profiler scopes are full.");
+		impl_->overflow_logged_ = true;
+		impl_->open_.push_back(Impl::no_query);
+		return;
+	}
+
+	Impl::ScopeRecord scope;
+	scope.name = name;
+	scope.depth = static_cast<uint32_t>(impl_->open_.size());
+	scope.begin_query = slot.query_count++;
+	scope.end_query = Impl::no_query;
+
+	cmd_buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, impl_->pool_, impl_->GetBase(impl_->current_) + scope.begin_query);
+
+	impl_->open_.push_back(static_cast<uint32_t>(slot.scopes.size()));
+	slot.scopes.push_back(scope);
+}
+
+void GpuProfiler::EndScope(vk::CommandBuffer cmd_buffer)
+{
+	if (!impl_->pool_ || impl_->open_.empty()) return;
+
+	auto index = impl_->open_.back();
+	impl_->open_.pop_back();
+	if (index == Impl::no_query) return;
+
+	auto& slot = impl_->slots_[impl_->current_];
+	auto& scope = slot.scopes[index];
+	scope.end_query = slot.query_count++;
+
+	// every earlier command has finished once bottom of pipe is reached
+	cmd_buffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, impl_->pool_, impl_->GetBase(impl_->current_) + scope.end_query);
+}
+
+bool GpuProfiler::IsEnabled(void) const
+{
+	return impl_->pool_;
+}
+
+void GpuProfiler::SetCounters(const std::string& name, std::vector<std::pair<std::string, uint64_t>> counters)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	impl_->history_[name].counters = std::move(counters);
+}
+
+void GpuProfiler::ResetHistory(size_t history_size)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	impl_->history_size_ = std::max<size_t>(history_size, 1);
+	for (auto& history : impl_->history_)
+	{
+		history.second.samples.clear();
+	}
+}
+
+std::vector<GpuProfiler::Timing> GpuProfiler::GetTimings(void) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	std::vector<Timing> timings;
+	for (auto& name : impl_->last_order_)
+	{
+		timings.push_back(impl_->MakeTiming(name, impl_->history_.at(name)));
+	}
+	return timings;
+}
+
+bool GpuProfiler::GetTiming(const std::string& name, Timing& timing) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	auto found = impl_->history_.find(name);
+	if (found == impl_->history_.end()) return false;
+
+	timing = impl_->MakeTiming(name, found->second);
+	return true;
+}
+
+void GpuProfiler::LogTimings(void) const
+{
+	for (auto& timing : GetTimings())
+	{
+		Log::Info("%*s%s : avg %.3f min %.3f max %.3f p99 %.3f ms", static_cast<int>(timing.depth * 2), "", timing.name.c_str(),
+			timing.average_ms, timing.min_ms, timing.max_ms, timing.p99_ms);
+
+		for (auto& counter : timing.counters)
+		{
+			Log::Info("%*s  %s = %llu", static_cast<int>(timing.depth * 2), "", counter.first.c_str(), static_cast<unsigned long long>(counter.second));
+		}
+	}
+}
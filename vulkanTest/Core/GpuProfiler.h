@@ -0,0 +1,91 @@
+#pragma once
+
+#include<memory>
+#include<string>
+#include<vector>
+#include<utility>
+#include"VulkanCommon.h"
+
+class GpuTimeline;
+
+// Timestamp queries around named scopes, one query range per frame in flight.
+// A frame's results are read when its slot comes around and the timeline says
+// the work completed, never waited for. Each scope name keeps a rolling window
+// of samples for average, min, max and p99.
+class GpuProfiler
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	struct Timing
+	{
+		std::string	name;
+		uint32_t	depth;			// nesting level, 0 : outermost
+		double		last_ms;
+		double		average_ms;
+		double		min_ms;
+		double		max_ms;
+		double		p99_ms;
+		uint32_t	sample_count;
+		std::vector<std::pair<std::string, uint64_t>>	counters;	// latest values from SetCounters
+	};
+
+	// begin in the constructor, end in the destructor, null profiler : nothing
+	class Scope
+	{
+	private:
+		GpuProfiler*		profiler_;
+		vk::CommandBuffer	cmd_buffer_;
+
+	public:
+		Scope(GpuProfiler* profiler, vk::CommandBuffer cmd_buffer, const std::string& name)
+			: profiler_(profiler)
+			, cmd_buffer_(cmd_buffer)
+		{
+			if (profiler_) profiler_->BeginScope(cmd_buffer_, name);
+		}
+
+		~Scope()
+		{
+			if (profiler_) profiler_->EndScope(cmd_buffer_);
+		}
+
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+	GpuProfiler() = delete;
+	// timestamp_valid_bits of the queue family, 0 : no timestamps, the profiler stays idle
+	GpuProfiler(vk::Device, GpuTimeline&, const vk::PhysicalDeviceLimits&, uint32_t timestamp_valid_bits, uint32_t frame_count);
+	~GpuProfiler();
+
+	bool Initialize(void);
+	void Destroy(void);
+
+	// first thing in the frame's primary command buffer, outside a render pass
+	// collects the slot's previous results and resets its queries
+	void BeginFrame(uint32_t frame_index, vk::CommandBuffer);
+
+	// the value the frame's command buffer was submitted with
+	void EndFrame(uint64_t submit_value);
+
+	// nest, a scope ends the innermost open one
+	void BeginScope(vk::CommandBuffer, const std::string& name);
+	void EndScope(vk::CommandBuffer);
+
+	bool IsEnabled(void) const;
+
+	// extra per-frame numbers reported with a scope, e.g. pipeline statistics
+	void SetCounters(const std::string& name, std::vector<std::pair<std::string, uint64_t>> counters);
+
+	// drops every sample so far, each scope keeps history_size samples from now on
+	void ResetHistory(size_t history_size);
+
+	// scopes of the latest resolved frame in recording order
+	std::vector<Timing> GetTimings(void) const;
+	bool GetTiming(const std::string& name, Timing&) const;
+
+	void LogTimings(void) const;
+};
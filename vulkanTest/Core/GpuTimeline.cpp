@@ -0,0 +1,234 @@
+#include<algorithm>
+#include<deque>
+#include<map>
+#include<mutex>
+#include<vector>
+
+#include"GpuTimeline.h"
+#include"../Utilities/Log.h"
+
+// VK_KHR_timeline_semaphore is not in the 1.1.82 sdk headers,
+// the timeline is emulated with a recycled fence per pending value.
+class GpuTimeline::Impl
+{
+public:
+	struct Pending
+	{
+		uint64_t	value;
+		vk::Fence	fence;
+	};
+
+	vk::Device											device_;
+	vk::Queue											queue_;
+	std::mutex											mutex_;
+	uint64_t											submitted_value_;
+	uint64_t											completed_value_;
+	std::deque<Pending>									pending_;		// submission order
+	std::vector<vk::Fence>								free_fences_;
+	std::map<vk::Fence, uint32_t>						waiters_;		// Wait outside the lock, not recycled meanwhile
+	std::multimap<uint64_t, std::function<void(void)>>	callbacks_;
+
+	Impl(vk::Device device, vk::Queue queue)
+		: device_(device)
+		, queue_(queue)
+		, submitted_value_(0)
+		, completed_value_(0) {}
+
+	vk::Fence GetFence(void)
+	{
+		if (!free_fences_.empty())
+		{
+			auto fence = free_fences_.back();
+			free_fences_.pop_back();
+			device_.resetFences(fence);
+			return fence;
+		}
+
+		vk::Fence fence;
+		vk::FenceCreateInfo fence_info;
+		device_.createFence(&fence_info, nullptr, &fence);
+		if (fence) VulkanStats::CountCreated();
+
+		return fence;
+	}
+
+	// single queue, fences signal in submission order
+	void Poll(void)
+	{
+		while (!pending_.empty())
+		{
+			auto& front = pending_.front();
+			if (device_.getFenceStatus(front.fence) != vk::Result::eSuccess) break;
+
+			completed_value_ = front.value;
+			if (waiters_.find(front.fence) == waiters_.end()) free_fences_.push_back(front.fence);
+			pending_.pop_front();
+		}
+	}
+
+	std::vector<std::function<void(void)>> TakeDueCallbacks(void)
+	{
+		std::vector<std::function<void(void)>> due;
+
+		auto end = callbacks_.upper_bound(completed_value_);
+		for (auto it = callbacks_.begin(); it != end; ++it)
+		{
+			due.push_back(std::move(it->second));
+		}
+		callbacks_.erase(callbacks_.begin(), end);
+
+		return due;
+	}
+};
+
+GpuTimeline::GpuTimeline(vk::Device device, vk::Queue queue) : impl_(std::make_unique<Impl>(device, queue)) {}
+
+GpuTimeline::~GpuTimeline() = default;
+
+uint64_t GpuTimeline::Submit(const vk::SubmitInfo& submit_info)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	auto fence = impl_->GetFence();
+	if (!fence)
+	{
+		Log::Error("Timeline fence cannot created.");
+		return 0;
+	}
+
+	auto result = impl_->queue_.submit(submit_info, fence);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Queue submit failed.");
+		impl_->free_fences_.push_back(fence);
+		return 0;
+	}
+
+	impl_->pending_.push_back({ ++impl_->submitted_value_, fence });
+
+	return impl_->submitted_value_;
+}
+
+uint64_t GpuTimeline::GetSubmittedValue(void) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	return impl_->submitted_value_;
+}
+
+uint64_t GpuTimeline::GetCompletedValue(void)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	impl_->Poll();
+	return impl_->completed_value_;
+}
+
+bool GpuTimeline::IsCompleted(uint64_t value)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	if (value <= impl_->completed_value_) return true;
+
+	impl_->Poll();
+	return value <= impl_->completed_value_;
+}
+
+bool GpuTimeline::Wait(uint64_t value)
+{
+	vk::Fence fence;
+
+	{
+		std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+		if (value <= impl_->completed_value_) return true;
+
+		for (auto& pending : impl_->pending_)
+		{
+			if (pending.value >= value)
+			{
+				fence = pending.fence;
+				break;
+			}
+		}
+
+		// never submitted
+		if (!fence) return false;
+
+		// Submit must not reset the fence while it is waited on
+		++impl_->waiters_[fence];
+	}
+
+	auto result = impl_->device_.waitForFences(fence, VK_TRUE, UINT64_MAX);
+
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	impl_->Poll();
+
+	// the last waiter recycles it once Poll has retired it
+	auto waiter = impl_->waiters_.find(fence);
+	if (--waiter->second == 0)
+	{
+		impl_->waiters_.erase(waiter);
+
+		const bool pending = std::any_of(impl_->pending_.begin(), impl_->pending_.end(), [fence](const Impl::Pending& entry) { return entry.fence == fence; });
+		if (!pending) impl_->free_fences_.push_back(fence);
+	}
+
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Timeline wait failed.");
+		return false;
+	}
+
+	return true;
+}
+
+void GpuTimeline::OnCompleted(uint64_t value, std::function<void(void)> callback)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	impl_->callbacks_.emplace(value, std::move(callback));
+}
+
+void GpuTimeline::Update(void)
+{
+	std::vector<std::function<void(void)>> due;
+
+	{
+		std::lock_guard<std::mutex> lock(impl_->mutex_);
+		impl_->Poll();
+		due = impl_->TakeDueCallbacks();
+	}
+
+	// outside the lock, callbacks may query the timeline
+	for (auto& callback : due)
+	{
+		callback();
+	}
+}
+
+void GpuTimeline::Destroy(void)
+{
+	std::vector<vk::Fence> fences;
+
+	{
+		std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+		for (auto& pending : impl_->pending_)
+		{
+			fences.push_back(pending.fence);
+		}
+	}
+
+	if (!fences.empty())
+	{
+		impl_->device_.waitForFences(fences, VK_TRUE, UINT64_MAX);
+	}
+
+	Update();
+
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	for (auto& fence : impl_->free_fences_)
+	{
+		impl_->device_.destroyFence(fence);
+	}
+	impl_->free_fences_.clear();
+}
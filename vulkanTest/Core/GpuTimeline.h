@@ -0,0 +1,40 @@
+#pragma once
+
+#include<memory>
+#include<functional>
+#include"VulkanCommon.h"
+
+// Monotonic counter of gpu work on one queue.
+// Every submit is tagged with the next value, subsystems key resource reuse,
+// deferred deletion and readbacks off the completed value instead of own fences.
+class GpuTimeline
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	GpuTimeline() = delete;
+	GpuTimeline(vk::Device, vk::Queue);
+	~GpuTimeline();
+
+	// submit and tag the work with the next value, returns the value (0 on failure)
+	uint64_t Submit(const vk::SubmitInfo&);
+
+	uint64_t GetSubmittedValue(void) const;
+	uint64_t GetCompletedValue(void);
+
+	// non-blocking
+	bool IsCompleted(uint64_t value);
+
+	// blocks until the value completes
+	bool Wait(uint64_t value);
+
+	// called from Update() or the first poll that sees the value completed
+	void OnCompleted(uint64_t value, std::function<void(void)> callback);
+
+	// polls the gpu and runs due callbacks, once per frame
+	void Update(void);
+
+	void Destroy(void);
+};
@@ -3,18 +3,42 @@
 #include<sstream>
 #include<iostream>
 #include<iterator>
+#include<algorithm>
 #include"Graphics.h"
-#define VK_USE_PLATFORM_WIN32_KHR
-#define VULKAN_HPP_NO_SMART_HANDLE
-#define VULKAN_HPP_NO_EXCEPTIONS
-#include<vulkan/vulkan.hpp>
+#include"VulkanCommon.h"
+#include"GpuTimeline.h"
+#include"CommandRecorder.h"
+#include"RenderGraph.h"
+#include"MemoryAllocator.h"
+#include"TransientAllocator.h"
+#include"UploadRing.h"
+#include"PipelineCacheFile.h"
+#include"PipelineCompiler.h"
+#include"PipelineLayoutCache.h"
+#include"ShaderModuleCache.h"
+#include"BindlessHeap.h"
+#include"DescriptorAllocator.h"
+#include"GpuProfiler.h"
+#include"PipelineStatistics.h"
+#include"DeviceCapabilities.h"
+#include"DeviceSelector.h"
 #include<vulkan/vk_sdk_platform.h>
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
 #include<vulkan/vulkan_win32.h>
+#endif
 
-#include"..\Utilities\Settings.h"
-#include"..\Utilities\Log.h"
+#include"../Utilities/Settings.h"
+#include"../Utilities/Log.h"
+#include"../Utilities/ThreadPool.h"
+#include"../Utilities/TaskGraph.h"
+#include"../Utilities/Utils.h"
+#include"../Utilities/CommandLine.h"
+#include"../Utilities/CpuProfiler.h"
+#include"../Application/BaseSystem/BaseSystem.h"
 
+#if defined(_MSC_VER)
 #pragma comment(lib, "vulkan-1.lib")
+#endif
 
 // this call back is global
 VKAPI_ATTR vk::Bool32 VKAPI_CALL DebugMessageCallback(
@@ -35,28 +59,53 @@ public:
 		vk::Format				format;
 		vk::Image				image;
 		vk::ImageView			view;
-		vk::MemoryAllocateInfo	mem_alloc;
-		vk::DeviceMemory		mem;
+		MemoryAllocator::Allocation	allocation;
 	};
 
 	struct BufferResource
 	{
-		vk::Buffer			buffer;
-		vk::DeviceMemory	mem;
+		vk::Buffer					buffer;
+		MemoryAllocator::Allocation	allocation;
+	};
+
+	// what empty and released bindless slots point at in fallback mode
+	struct BindlessDefaults
+	{
+		vk::Image					image;
+		vk::ImageView				view;
+		MemoryAllocator::Allocation	allocation;
+		vk::Sampler					sampler;
+		BufferResource				buffer;
 	};
 
-	const std::unique_ptr<Window>&					window_;
+	Platform&										platform_;
 
 	vk::Instance									instance_;
 	vk::PhysicalDevice								gpu_;
 	vk::PhysicalDeviceProperties					gpu_props_;
+	vk::PhysicalDeviceFeatures						gpu_features_;
+	vk::PhysicalDeviceDescriptorIndexingFeaturesEXT	descriptor_indexing_features_;
+	vk::PhysicalDeviceDescriptorIndexingPropertiesEXT	descriptor_indexing_props_;
 	vk::Device										device_;
 	vk::PipelineCache								pipeline_cache_;
+	std::unique_ptr<PipelineCacheFile>				pipeline_cache_file_;
 	vk::Queue										queue_;
+	std::unique_ptr<GpuTimeline>					timeline_;
+	std::unique_ptr<MemoryAllocator>				memory_;
 	vk::CommandPool									command_pool_;
-	std::vector<vk::CommandBuffer>					command_buffers_;
-	vk::Semaphore									present_complete_semaphore_;
-	vk::Semaphore									draw_complete_semaphore_;
+	std::unique_ptr<ThreadPool>						thread_pool_;
+	std::unique_ptr<CommandRecorder>				recorder_;
+	std::unique_ptr<PipelineCompiler>				pipeline_compiler_;
+	std::unique_ptr<PipelineLayoutCache>			layout_cache_;
+	std::unique_ptr<ShaderModuleCache>				shader_cache_;
+	std::unique_ptr<BindlessHeap>					bindless_;
+	BindlessDefaults								bindless_defaults_;
+	std::unique_ptr<DescriptorAllocator>			descriptors_;
+	std::unique_ptr<GpuProfiler>					profiler_;
+	std::unique_ptr<PipelineStatistics>				statistics_;
+	RenderGraph										render_graph_;
+	std::unique_ptr<TransientAllocator>				transients_;
+	std::unique_ptr<UploadRing>						upload_ring_;
 	Depth											depth_target_;
 	BufferResource									vertex_buffer_, index_buffer_;
 
@@ -75,8 +124,29 @@ public:
 	{
 		vk::Image		image;
 		vk::ImageView	view;
-		vk::Fence		fence;
+		uint64_t		submit_value;	// timeline value of the frame that rendered last
 		vk::Framebuffer	frame_buffer;
+		MemoryAllocator::Allocation	allocation;	// headless only, swapchain images own no memory
+	};
+
+	// replaced by a rebuild, destroyed once the frames in flight at that time are done
+	struct RetiredSwapchain
+	{
+		vk::SwapchainKHR				swap_chain;
+		std::vector<vk::ImageView>		views;
+		std::vector<vk::Framebuffer>	frame_buffers;
+		Depth							depth;
+		uint64_t						submit_value;
+	};
+
+	// frames in flight
+	struct FrameResources
+	{
+		uint64_t			submit_value;	// timeline value of the last submit from this slot
+		vk::Semaphore		acquire_semaphore;
+		vk::Semaphore		render_semaphore;
+		vk::CommandPool		command_pool;	// transient, reset as a whole every frame
+		vk::CommandBuffer	cmd_buffer;
 	};
 
 	vk::Format										swap_target_format_;
@@ -87,16 +157,40 @@ public:
 	vk::SurfaceKHR									surface_;
 	vk::SwapchainKHR								swap_chain_;
 	vk::PresentInfoKHR								present_info_;
+	vk::Extent2D									swap_extent_;
+	vk::PresentModeKHR								present_mode_;
+	Settings::Window								window_settings_;
+	bool											swapchain_dirty_;
+	bool											headless_;		// no window, offscreen images stand in for the swapchain
+	std::vector<RetiredSwapchain>					retired_swapchains_;
+	uint32_t										instance_api_version_;
+	bool											descriptor_indexing_supported_;
+
+	uint32_t										frame_count_;
+	uint32_t										frame_index_;
+	std::unique_ptr<FrameResources[]>				frame_resources_;
+	uint64_t										frame_begin_object_count_;
+	uint64_t										frame_created_object_count_;
 
 	vk::PhysicalDeviceMemoryProperties mem_props_;
 	vk::RenderPass render_pass_;
 
 	static const char* debug_layers_[];
 
-	Impl(std::unique_ptr<Window>& window)
-		: window_(window)
+	Impl(Platform& platform)
+		: platform_(platform)
 		, sc_image_count_(0)
 		, sc_current_image_(0)
+		, present_mode_(vk::PresentModeKHR::eFifo)
+		, window_settings_(Settings::window)
+		, swapchain_dirty_(false)
+		, headless_(false)
+		, instance_api_version_(VK_API_VERSION_1_0)
+		, descriptor_indexing_supported_(false)
+		, frame_count_(Settings::frames_in_flight<uint32_t>)
+		, frame_index_(0)
+		, frame_begin_object_count_(0)
+		, frame_created_object_count_(0)
 #if defined(_DEBUG)
 		, create_debug_report_callback_(VK_NULL_HANDLE)
 		, destroy_debug_report_callback_(VK_NULL_HANDLE)
@@ -114,25 +208,109 @@ public:
 	bool CreateSurface(void);
 	bool CreateDevice(void);
 	bool CreateQueue(void);
+	bool CreateTimeline(void);
 	bool CreatePipelineCache(void);
 	bool CreateCommandPool(void);		// similar command allocater
 	bool CreateSwapChain(void);
+	bool CreateOffscreenTargets(void);
 	bool CreateRenderPass(void);
 	bool InitSemaphoreSettings(void);
 	bool CreateCommandBufffer(void);
+	bool CreateCommandRecorder(void);
+	bool CreatePipelineCompiler(void);
+	bool CreateLayoutCache(void);
+	bool CreateShaderCache(void);
+	bool CreateBindlessHeap(void);
+	bool CreateBindlessDefaults(void);
+	bool CreateDescriptorAllocator(void);
+	bool CreateGpuProfiler(void);
+	bool CreateMemoryAllocator(void);
+	bool CreateTransientAllocator(void);
+	bool CreateUploadRing(void);
 	bool CreateSwapChainResources(void);
 	bool CreateDepthImage(void);
 
 	bool CreateFrameBuffer(void);
 
+	bool RecreateSwapChain(void);
+	void ReleaseRetiredSwapChains(bool force = false);
+	void DestroySwapChain(void);
+	void DestroyFrameResources(void);
+	void DestroyBindlessDefaults(void);
+
+	void RecordDrawPass(vk::CommandBuffer cmd_buffer, const vk::ClearColorValue& clear_color)
+	{
+		auto& frame_buffer = sc_resources_[sc_current_image_].frame_buffer;
+
+		const vk::ClearValue clear_values[] =
+		{
+			vk::ClearValue().setColor(clear_color),
+			vk::ClearValue().setDepthStencil(vk::ClearDepthStencilValue(1.0f, 0)),
+		};
+
+		auto const pass_info = vk::RenderPassBeginInfo()
+			.setRenderPass(render_pass_)
+			.setFramebuffer(frame_buffer)
+			.setRenderArea(vk::Rect2D(vk::Offset2D(0, 0), swap_extent_))
+			.setClearValueCount(std::size(clear_values))
+			.setPClearValues(clear_values);
+
+		// secondaries run under the pass's statistics and occlusion queries
+		auto const inheritance = vk::CommandBufferInheritanceInfo()
+			.setRenderPass(render_pass_)
+			.setSubpass(0)
+			.setFramebuffer(frame_buffer)
+			.setOcclusionQueryEnable(statistics_->IsOcclusionInherited())
+			.setQueryFlags(statistics_->IsOcclusionInherited() ? statistics_->GetOcclusionFlags() : vk::QueryControlFlags())
+			.setPipelineStatistics(statistics_->GetInheritedStatistics());
+
+		// workers record while the primary waits, then runs them in slice order
+		auto& secondaries = recorder_->Record(inheritance);
+
+		cmd_buffer.beginRenderPass(pass_info, vk::SubpassContents::eSecondaryCommandBuffers);
+		if (!secondaries.empty()) cmd_buffer.executeCommands(secondaries);
+		cmd_buffer.endRenderPass();
+	}
+
+	vk::PresentModeKHR SelectPresentMode(const std::vector<vk::PresentModeKHR>& supported) const
+	{
+		std::vector<vk::PresentModeKHR> preferred;
+
+		if (window_settings_.vsync)
+		{
+			// relaxed tears a late frame instead of waiting another interval
+			if (window_settings_.present_policy == Settings::PresentPolicy::LOW_LATENCY)
+				preferred.push_back(vk::PresentModeKHR::eFifoRelaxed);
+		}
+		else if (window_settings_.present_policy == Settings::PresentPolicy::LOW_LATENCY)
+		{
+			preferred = { vk::PresentModeKHR::eImmediate, vk::PresentModeKHR::eMailbox };
+		}
+		else
+		{
+			// uncapped without tearing, measures real gpu throughput
+			preferred = { vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate };
+		}
+
+		for (auto mode : preferred)
+		{
+			if (std::find(supported.begin(), supported.end(), mode) != supported.end()) return mode;
+		}
+
+		// fifo is always supported
+		return vk::PresentModeKHR::eFifo;
+	}
+
 	uint32_t FindQueue(vk::QueueFlags flag)
 	{
 		for (uint32_t i = 0; i < queue_family_count_; ++i)
 		{
 			if (queue_props_[i].queueFlags & flag)
 			{
-				uint32_t supported;
-				if (gpu_.getSurfaceSupportKHR(i, surface_, &supported) != vk::Result::eSuccess)
+				if (headless_) return i;
+
+				uint32_t supported = VK_FALSE;
+				if (gpu_.getSurfaceSupportKHR(i, surface_, &supported) != vk::Result::eSuccess || supported != VK_TRUE)
 				{
 					continue;
 				}
@@ -164,245 +342,412 @@ public:
 		return 0xffffffff;
 	}
 
-	uint32_t AcquireNextImage(vk::Semaphore present_completed)
+	bool AcquireNextImage(vk::Semaphore present_completed)
 	{
-		auto result = device_.acquireNextImageKHR(swap_chain_, UINT64_MAX, present_completed, vk::Fence());
-
-		if (result.result != vk::Result::eSuccess)
+		if (headless_)
 		{
-			return sc_current_image_;
+			// round robin, WaitImage covers the image's previous frame
+			sc_current_image_ = (sc_current_image_ + 1) % sc_image_count_;
+			return true;
 		}
 
-		sc_current_image_ = result.value;
-		return sc_current_image_;
-	}
-
-	void SetPipelineBarrier(
-		vk::CommandBuffer cmd_buffer,
-		vk::Image image,
-		vk::ImageLayout old_layout,
-		vk::ImageLayout new_layout,
-		vk::ImageSubresourceRange sub_range)
-	{
-		vk::ImageMemoryBarrier image_memory_barrier = vk::ImageMemoryBarrier()
-			.setImage(image)
-			.setOldLayout(old_layout)
-			.setNewLayout(new_layout)
-			.setSubresourceRange(sub_range);
-
-		/*old layout*/ {
-			if (old_layout == vk::ImageLayout::ePreinitialized)
-				image_memory_barrier.srcAccessMask = vk::AccessFlagBits::eHostWrite;
-			// transfer destination
-			else if (old_layout == vk::ImageLayout::eTransferDstOptimal)
-				image_memory_barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-			// transfer source
-			else if (old_layout == vk::ImageLayout::eTransferSrcOptimal)
-				image_memory_barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
-			// color
-			else if (old_layout == vk::ImageLayout::eColorAttachmentOptimal)
-				image_memory_barrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
-			// depth stencil
-			else if (old_layout == vk::ImageLayout::eDepthStencilAttachmentOptimal)
-				image_memory_barrier.srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
-			// shader resource
-			else if (old_layout == vk::ImageLayout::eShaderReadOnlyOptimal)
-				image_memory_barrier.srcAccessMask = vk::AccessFlagBits::eShaderRead;
-		}
+		uint32_t image_index = 0;
+		auto result = device_.acquireNextImageKHR(swap_chain_, UINT64_MAX, present_completed, vk::Fence(), &image_index);
 
-		/*next layout*/ {
-			// transfer destination
-			if (new_layout == vk::ImageLayout::eTransferDstOptimal)
-				image_memory_barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-			// transfer source
-			else if (new_layout == vk::ImageLayout::eTransferSrcOptimal)
-				image_memory_barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;// | image_memory_barrier.srcAccessMask;
-																					   // color																																	 // J[
-			else if (new_layout == vk::ImageLayout::eColorAttachmentOptimal)
-				image_memory_barrier.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
-			// depth stencil
-			else if (new_layout == vk::ImageLayout::eDepthStencilAttachmentOptimal)
-				image_memory_barrier.dstAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
-			// shader resource
-			else if (new_layout == vk::ImageLayout::eShaderReadOnlyOptimal)
-				image_memory_barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		switch (result)
+		{
+		case vk::Result::eSuccess:
+			break;
+		case vk::Result::eSuboptimalKHR:
+			// still presentable, rebuilt after this frame
+			swapchain_dirty_ = true;
+			break;
+		case vk::Result::eErrorOutOfDateKHR:
+			swapchain_dirty_ = true;
+			return false;
+		default:
+			Log::Error("Swapchain image cannot acquired.");
+			return false;
 		}
 
-		cmd_buffer.pipelineBarrier(
-			vk::PipelineStageFlagBits::eTopOfPipe,
-			vk::PipelineStageFlagBits::eTopOfPipe,
-			vk::DependencyFlags(),
-			nullptr, nullptr, image_memory_barrier);
+		sc_current_image_ = image_index;
+		return true;
 	}
 
 	void Present(vk::Semaphore wait_semaphore)
 	{
+		if (headless_) return;
+
 		present_info_.waitSemaphoreCount = wait_semaphore ? 1 : 0;
 		present_info_.pWaitSemaphores = &wait_semaphore;
-		queue_.presentKHR(present_info_);
-	}
-
-	vk::Fence GetSubmitFence(bool destroy = false)
-	{
-		auto& sc_resouce = sc_resources_[sc_current_image_];
 
-		while (sc_resouce.fence)
+		auto result = queue_.presentKHR(&present_info_);
+		if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR)
 		{
-			auto fence_res = device_.waitForFences(sc_resouce.fence, VK_TRUE, 100000000000);
-			if (fence_res == vk::Result::eSuccess)
-			{
-				if (destroy)
-				{
-					device_.destroyFence(sc_resouce.fence);
-				}
-				sc_resouce.fence = vk::Fence();
-			}
+			swapchain_dirty_ = true;
 		}
+	}
+
+	void WaitFrame(const FrameResources& frame)
+	{
+		// returns at once unless the cpu laps the ring
+		timeline_->Wait(frame.submit_value);
+		timeline_->Update();
+		transients_->Update();
+	}
 
-		device_.createFence(&vk::FenceCreateInfo(), nullptr, &sc_resouce.fence);
-		return sc_resouce.fence;
+	void WaitImage(const SwapchainImageResources& sc_resource)
+	{
+		// image acquired out of order may still be rendered by another frame
+		timeline_->Wait(sc_resource.submit_value);
 	}
 };
 
 const char* Graphics::Impl::debug_layers_[] = { "VK_LAYER_LUNARG_standard_validation" };
 
-Graphics::Graphics(std::unique_ptr<Window>& window) : impl_(std::make_unique<Impl>(window)) {}
+Graphics::Graphics(Platform& platform) : impl_(std::make_unique<Impl>(platform)) {}
 
 Graphics::~Graphics() = default;
 
 bool Graphics::Initialize(void)
 {
-	if (!impl_->CreateInstance()) return false;
-
-	if (!impl_->EnumeratePhysicalDevice()) return false;
-
-	if (!impl_->CreateSurface()) return false;
+	PROFILE_FUNCTION();
+
+	impl_->headless_ = impl_->platform_.IsHeadless();
+	if (impl_->headless_) Log::Info("Headless mode, rendering into offscreen images.");
+
+	// the init steps run on it too
+	impl_->thread_pool_ = std::make_unique<ThreadPool>(Settings::worker_thread_count<uint32_t>);
+
+	// a step starts once the steps whose members it reads are done
+	auto impl = impl_.get();
+	TaskGraph init;
+
+	// the debug messenger comes first so the validation output of every later step reaches it
+	auto instance = init.Add("CreateInstance", [impl] { return impl->CreateInstance(); });
+	auto debug_layer = init.Add("CreateDebugLayer", [impl] { return impl->CreateDebugLayer(); }, { instance });
+	auto surface = init.Add("CreateSurface", [impl] { return impl->CreateSurface(); }, { instance, debug_layer });
+	auto gpu = init.Add("EnumeratePhysicalDevice", [impl] { return impl->EnumeratePhysicalDevice(); }, { instance, surface });
+	auto device = init.Add("CreateDevice", [impl] { return impl->CreateDevice(); }, { gpu, surface, debug_layer });
+
+	auto pipeline_cache = init.Add("CreatePipelineCache", [impl] { return impl->CreatePipelineCache(); }, { device });
+	auto queue = init.Add("CreateQueue", [impl] { return impl->CreateQueue(); }, { device });
+	auto timeline = init.Add("CreateTimeline", [impl] { return impl->CreateTimeline(); }, { queue });
+	auto memory = init.Add("CreateMemoryAllocator", [impl] { return impl->CreateMemoryAllocator(); }, { device });
+	init.Add("CreateTransientAllocator", [impl] { return impl->CreateTransientAllocator(); }, { timeline, memory });
+	auto command_pool = init.Add("CreateCommandPool", [impl] { return impl->CreateCommandPool(); }, { device });
+
+	auto swap_chain = init.Add("CreateSwapChain", [impl] { return impl->CreateSwapChain(); }, { device });
+	auto depth = init.Add("CreateDepthImage", [impl] { return impl->CreateDepthImage(); }, { swap_chain, memory });
+	auto render_pass = init.Add("CreateRenderPass", [impl] { return impl->CreateRenderPass(); }, { swap_chain, depth });
+	auto sc_resources = init.Add("CreateSwapChainResources", [impl] { return impl->CreateSwapChainResources(); }, { swap_chain, memory });
+	init.Add("CreateFrameBuffer", [impl] { return impl->CreateFrameBuffer(); }, { render_pass, sc_resources, depth });
+
+	auto semaphores = init.Add("InitSemaphoreSettings", [impl] { return impl->InitSemaphoreSettings(); }, { device });
+	init.Add("CreateCommandBufffer", [impl] { return impl->CreateCommandBufffer(); }, { semaphores });
+	init.Add("CreateCommandRecorder", [impl] { return impl->CreateCommandRecorder(); }, { device });
+
+	init.Add("CreatePipelineCompiler", [impl] { return impl->CreatePipelineCompiler(); }, { pipeline_cache });
+	init.Add("CreateLayoutCache", [impl] { return impl->CreateLayoutCache(); }, { device });
+	init.Add("CreateShaderCache", [impl] { return impl->CreateShaderCache(); }, { device });
+	auto bindless = init.Add("CreateBindlessHeap", [impl] { return impl->CreateBindlessHeap(); }, { timeline });
+	init.Add("CreateBindlessDefaults", [impl] { return impl->CreateBindlessDefaults(); }, { bindless, command_pool, memory });
+	init.Add("CreateDescriptorAllocator", [impl] { return impl->CreateDescriptorAllocator(); }, { device });
+	init.Add("CreateGpuProfiler", [impl] { return impl->CreateGpuProfiler(); }, { timeline });
+	init.Add("CreateUploadRing", [impl] { return impl->CreateUploadRing(); }, { memory });
+
+	const bool succeeded = init.Run(*impl_->thread_pool_);
+
+	init.LogTimings("[STARTUP] Graphics::Initialize");
+
+	return succeeded;
+}
 
-	if (!impl_->CreateDevice()) return false;
+bool Graphics::Run(void)
+{
+	PROFILE_FUNCTION();
 
-	if (!impl_->CreateDebugLayer()) return false;
+	auto& frame = impl_->frame_resources_[impl_->frame_index_];
 
-	if (!impl_->CreatePipelineCache()) return false;
+	/*wait frame*/ {
+		PROFILE_ZONE("wait frame");
+		impl_->WaitFrame(frame);
+	}
 
-	if (!impl_->CreateQueue()) return false;
+	impl_->ReleaseRetiredSwapChains();
 
-	if (!impl_->CreateCommandPool()) return false;
+	// resized or minimized, skip the frame until a swapchain can be built
+	if (impl_->swapchain_dirty_ && !impl_->RecreateSwapChain()) return true;
 
-	if (!impl_->CreateSwapChain()) return false;
+	/*acquire*/ {
+		PROFILE_ZONE("acquire");
 
-	if (!impl_->CreateRenderPass()) return false;
+		// get next buffer
+		if (!impl_->AcquireNextImage(frame.acquire_semaphore)) return true;
+	}
 
-	if (!impl_->InitSemaphoreSettings()) return false;
+	auto& sc_resource = impl_->sc_resources_[impl_->sc_current_image_];
+	impl_->WaitImage(sc_resource);
 
-	if (!impl_->CreateCommandBufffer()) return false;
+	impl_->recorder_->BeginFrame(impl_->frame_index_);
+	impl_->upload_ring_->BeginFrame(impl_->frame_index_);
+	impl_->bindless_->BeginFrame(impl_->frame_index_);
+	impl_->descriptors_->BeginFrame(impl_->frame_index_);
+	impl_->transients_->BeginFrame(impl_->frame_index_);
 
-	if (!impl_->CreateSwapChainResources()) return false;
+	auto& cmd_buffer = frame.cmd_buffer;
 
-	if (!impl_->CreateDepthImage()) return false;
+	// frame graph, barriers and the semaphore wait stage come from the declared usages
+	auto& graph = impl_->render_graph_;
+	graph.Reset();
 
-	//if (!impl_->CreateFrameBuffer()) return false;
+	// headless : no acquire semaphore to chain to, the result is left ready for a readback
+	auto back_buffer = graph.ImportImage(
+		"back_buffer",
+		sc_resource.image,
+		vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1),
+		vk::ImageLayout::eUndefined,
+		impl_->headless_ ? vk::PipelineStageFlagBits::eTopOfPipe : vk::PipelineStageFlags(),
+		vk::AccessFlags(),
+		true,
+		impl_->headless_ ? RenderGraph::Usage::TRANSFER_SRC : RenderGraph::Usage::PRESENT);
 
-	return true;
-}
+	vk::ClearColorValue clear_color(std::array<float, 4>{ 0.0f, 0.5f, 0.5f, 1.0f });
 
-bool Graphics::Run(void)
-{
-	// get next buffer
-	uint32_t current_buffer = impl_->AcquireNextImage(impl_->present_complete_semaphore_);
+	if (impl_->recorder_->HasDrawList())
+	{
+		// one depth image for every frame in flight, the previous frame's depth writes finish first
+		auto depth = graph.ImportImage(
+			"depth",
+			impl_->depth_target_.image,
+			vk::ImageSubresourceRange(TransientAllocator::GetAspect(impl_->depth_target_.format), 0, 1, 0, 1),
+			vk::ImageLayout::eUndefined,
+			vk::PipelineStageFlagBits::eLateFragmentTests,
+			vk::AccessFlagBits::eDepthStencilAttachmentWrite,
+			false);
+
+		// render pass clears both attachments
+		graph.AddPass("draw", {},
+			{ { back_buffer, RenderGraph::Usage::COLOR_ATTACHMENT }, { depth, RenderGraph::Usage::DEPTH_ATTACHMENT } },
+			[&](vk::CommandBuffer cmd) { impl_->RecordDrawPass(cmd, clear_color); });
+	}
+	else
+	{
+		graph.AddPass("clear", {}, { { back_buffer, RenderGraph::Usage::TRANSFER_DST } },
+			[&](vk::CommandBuffer cmd)
+		{
+			auto const image_sub_range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+			cmd.clearColorImage(sc_resource.image, vk::ImageLayout::eTransferDstOptimal, clear_color, image_sub_range);
+		});
+	}
 
-	auto& cmd_buffer = impl_->command_buffers_[current_buffer];
+	if (!graph.Compile()) return false;
 
 	/*command buffer stack*/ {
-		cmd_buffer.reset(vk::CommandBufferResetFlagBits::eReleaseResources);
-		vk::CommandBufferBeginInfo cmd_buf_info;
-		cmd_buffer.begin(cmd_buf_info);
+		PROFILE_ZONE("record");
 
-		vk::ClearColorValue clear_color(std::array<float, 4>{ 0.0f, 0.5f, 0.5f, 1.0f });
-
-		vk::ImageSubresourceRange image_sub_range = vk::ImageSubresourceRange()
-			.setAspectMask(vk::ImageAspectFlagBits::eColor)
-			.setLevelCount(1)
-			.setLayerCount(1);
-
-		auto& color_image = impl_->sc_resources_[impl_->sc_current_image_].image;
-
-		impl_->SetPipelineBarrier(
-			cmd_buffer,
-			color_image,
-			vk::ImageLayout::eUndefined,
-			vk::ImageLayout::eTransferDstOptimal,
-			image_sub_range);
+		// recycles every buffer of the slot, memory stays with the pool
+		impl_->device_.resetCommandPool(frame.command_pool, vk::CommandPoolResetFlags());
+		auto cmd_buf_info = vk::CommandBufferBeginInfo().setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+		cmd_buffer.begin(cmd_buf_info);
 
-		cmd_buffer.clearColorImage(color_image, vk::ImageLayout::eTransferDstOptimal, clear_color, image_sub_range);
+		impl_->profiler_->BeginFrame(impl_->frame_index_, cmd_buffer);
+		impl_->statistics_->BeginFrame(impl_->frame_index_, cmd_buffer);
 
-		impl_->SetPipelineBarrier(
-			cmd_buffer,
-			color_image,
-			vk::ImageLayout::eTransferDstOptimal,
-			vk::ImageLayout::ePresentSrcKHR,
-			image_sub_range);
+		/*frame*/ {
+			GpuProfiler::Scope scope(impl_->profiler_.get(), cmd_buffer, "frame");
+			graph.Execute(cmd_buffer);
+		}
 
 		cmd_buffer.end();
 	}
 
 	/*command buffer submit*/ {
-		vk::PipelineStageFlags pipeline_stages = vk::PipelineStageFlagBits::eBottomOfPipe;
+		PROFILE_ZONE("submit");
+
+		// the image is not touched before its first use in the graph
+		vk::PipelineStageFlags pipeline_stages = graph.GetFirstStage(back_buffer);
 		vk::SubmitInfo submitInfo;
 		submitInfo.pWaitDstStageMask = &pipeline_stages;
 		// wait semaphore
-		submitInfo.waitSemaphoreCount = 1;
-		submitInfo.pWaitSemaphores = &impl_->present_complete_semaphore_;
+		submitInfo.waitSemaphoreCount = impl_->headless_ ? 0 : 1;
+		submitInfo.pWaitSemaphores = &frame.acquire_semaphore;
 		// pass command buffer
 		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &impl_->command_buffers_[current_buffer];
+		submitInfo.pCommandBuffers = &frame.cmd_buffer;
 		// render semaphore registering
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &impl_->draw_complete_semaphore_;
+		submitInfo.signalSemaphoreCount = impl_->headless_ ? 0 : 1;
+		submitInfo.pSignalSemaphores = &frame.render_semaphore;
+
+		// submit at queue, the value is waited when this slot comes around again
+		frame.submit_value = impl_->timeline_->Submit(submitInfo);
+		sc_resource.submit_value = frame.submit_value;
 
-		// submit at queue
-		vk::Fence fence = impl_->GetSubmitFence(true);
-		impl_->queue_.submit(submitInfo, fence);
-		auto result = impl_->device_.waitForFences(fence, VK_TRUE, 100000000000);
-		assert(result == vk::Result::eSuccess);
-		//impl_->queue_.waitIdle();
+		impl_->profiler_->EndFrame(frame.submit_value);
+		impl_->statistics_->EndFrame(frame.submit_value);
 	}
 
-	impl_->Present(impl_->draw_complete_semaphore_);
+	/*present*/ {
+		PROFILE_ZONE("present");
+		impl_->Present(frame.render_semaphore);
+	}
+
+	impl_->pipeline_cache_file_->Update(*impl_->thread_pool_);
+
+	impl_->frame_index_ = (impl_->frame_index_ + 1) % impl_->frame_count_;
 
 	return true;
 }
 
 void Graphics::Exit(void)
 {
-
+	// initialize failed before the device
+	if (!impl_->device_) return;
+
+	impl_->DestroyFrameResources();
+	if (impl_->recorder_) impl_->recorder_->Destroy();
+	if (impl_->transients_) impl_->transients_->Destroy();
+	if (impl_->upload_ring_) impl_->upload_ring_->Destroy();
+	if (impl_->pipeline_compiler_) impl_->pipeline_compiler_->Destroy();
+	if (impl_->thread_pool_) impl_->thread_pool_->Exit();
+	if (impl_->layout_cache_) impl_->layout_cache_->Destroy();
+	if (impl_->shader_cache_) impl_->shader_cache_->Destroy();
+	if (impl_->bindless_) impl_->bindless_->Destroy();
+	impl_->DestroyBindlessDefaults();
+	if (impl_->descriptors_) impl_->descriptors_->Destroy();
+	if (impl_->statistics_) impl_->statistics_->Destroy();
+	if (impl_->profiler_)
+	{
+		impl_->profiler_->LogTimings();
+		impl_->profiler_->Destroy();
+	}
+	if (impl_->pipeline_cache_file_)
+	{
+		impl_->pipeline_cache_file_->Save();
+		impl_->pipeline_cache_file_->Destroy();
+	}
+	impl_->ReleaseRetiredSwapChains(true);
+	impl_->DestroySwapChain();
+	if (impl_->memory_)
+	{
+		impl_->memory_->LogStatistics();
+		impl_->memory_->Destroy();
+	}
+	if (impl_->timeline_) impl_->timeline_->Destroy();
 }
 
 void Graphics::BeginFrame(void)
 {
-
+	impl_->frame_begin_object_count_ = VulkanStats::GetCreatedCount();
 }
 
 void Graphics::EndFrame(void)
 {
+	impl_->frame_created_object_count_ = VulkanStats::GetCreatedCount() - impl_->frame_begin_object_count_;
+
+	CpuProfiler::Counter("vulkan objects created", static_cast<int64_t>(impl_->frame_created_object_count_));
+
+#if defined(_DEBUG)
+	if (impl_->frame_created_object_count_ > 0)
+	{
+		Log::Warning("%llu vulkan objects created in frame.", impl_->frame_created_object_count_);
+	}
+#endif
+}
+
+uint64_t Graphics::GetCreatedObjectCount(void) const
+{
+	return VulkanStats::GetCreatedCount();
+}
+
+uint64_t Graphics::GetFrameCreatedObjectCount(void) const
+{
+	return impl_->frame_created_object_count_;
+}
+
+CommandRecorder& Graphics::GetCommandRecorder(void)
+{
+	return *impl_->recorder_;
+}
+
+MemoryAllocator& Graphics::GetMemoryAllocator(void)
+{
+	return *impl_->memory_;
+}
+
+PipelineCompiler& Graphics::GetPipelineCompiler(void)
+{
+	return *impl_->pipeline_compiler_;
+}
+
+PipelineLayoutCache& Graphics::GetLayoutCache(void)
+{
+	return *impl_->layout_cache_;
+}
+
+ShaderModuleCache& Graphics::GetShaderCache(void)
+{
+	return *impl_->shader_cache_;
+}
+
+BindlessHeap& Graphics::GetBindlessHeap(void)
+{
+	return *impl_->bindless_;
+}
+
+DescriptorAllocator& Graphics::GetDescriptorAllocator(void)
+{
+	return *impl_->descriptors_;
+}
+
+GpuProfiler& Graphics::GetGpuProfiler(void)
+{
+	return *impl_->profiler_;
+}
+
+PipelineStatistics& Graphics::GetPipelineStatistics(void)
+{
+	return *impl_->statistics_;
+}
 
+UploadRing& Graphics::GetUploadRing(void)
+{
+	return *impl_->upload_ring_;
 }
 
 bool Graphics::Impl::CreateInstance(void)
 {
+	PROFILE_FUNCTION();
+
+	// 1.1 for the features2 queries, a 1.0 loader has no vkEnumerateInstanceVersion
+	instance_api_version_ = VK_API_VERSION_1_0;
+	auto enumerate_instance_version = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+	if (enumerate_instance_version)
+	{
+		uint32_t version = VK_API_VERSION_1_0;
+		if (enumerate_instance_version(&version) == VK_SUCCESS && version >= VK_API_VERSION_1_1)
+		{
+			instance_api_version_ = VK_API_VERSION_1_1;
+		}
+	}
+
 	auto const app_info = vk::ApplicationInfo()
 		.setPApplicationName(Settings::application_name<char[]>)
 		.setPEngineName(Settings::application_name<char[]>)
-		.setApiVersion(VK_API_VERSION_1_0);
+		.setApiVersion(instance_api_version_);
 
-	const char* extention[] =
+	std::vector<const char*> extention;
+	if (!headless_)
 	{
-		VK_KHR_SURFACE_EXTENSION_NAME,			// necessary
-		VK_KHR_WIN32_SURFACE_EXTENSION_NAME,	// necessary win32
+		extention.push_back(VK_KHR_SURFACE_EXTENSION_NAME);			// necessary
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+		extention.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);	// necessary win32
+#endif
+	}
 #if defined(_DEBUG)
-		VK_EXT_DEBUG_REPORT_EXTENSION_NAME
+	extention.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 #endif
-	};
-	unsigned int extension_count = std::size(extention);
+	unsigned int extension_count = static_cast<unsigned int>(extention.size());
 
 	auto const instance_info = vk::InstanceCreateInfo()
 		.setPApplicationInfo(&app_info)
@@ -411,7 +756,7 @@ bool Graphics::Impl::CreateInstance(void)
 		.setPpEnabledLayerNames(debug_layers_)
 #endif
 		.setEnabledExtensionCount(extension_count)
-		.setPpEnabledExtensionNames(extention);
+		.setPpEnabledExtensionNames(extention.data());
 
 	vk::createInstance(&instance_info, nullptr, &instance_);
 
@@ -421,6 +766,8 @@ bool Graphics::Impl::CreateInstance(void)
 		return false;
 	}
 
+	VulkanStats::CountCreated();
+
 	Log::Info("Instance create done.");
 
 	return true;
@@ -428,6 +775,8 @@ bool Graphics::Impl::CreateInstance(void)
 
 bool Graphics::Impl::EnumeratePhysicalDevice(void)
 {
+	PROFILE_FUNCTION();
+
 	uint32_t gpu_count;
 	instance_.enumeratePhysicalDevices(&gpu_count, nullptr);
 
@@ -435,156 +784,74 @@ bool Graphics::Impl::EnumeratePhysicalDevice(void)
 	{
 		std::unique_ptr<vk::PhysicalDevice[]> physical_devices(new vk::PhysicalDevice[gpu_count]);
 		auto result = instance_.enumeratePhysicalDevices(&gpu_count, physical_devices.get());
-		assert(result == vk::Result::eSuccess);
-
-		for (unsigned int i = 0; i < gpu_count; ++i)
+		if (result != vk::Result::eSuccess)
 		{
-			gpu_ = physical_devices[i];
-
-			gpu_.getProperties(&gpu_props_);
-
-			Log::Info("\n================ VulkanPhysicalDevice[%d/%d] ================", i + 1, gpu_count);
-			Log::Info("%s", gpu_props_.deviceName);
-			Log::Info("apiVersion = %d.%d.%d\n",
-				VK_VERSION_MAJOR(gpu_props_.apiVersion),
-				VK_VERSION_MINOR(gpu_props_.apiVersion),
-				VK_VERSION_PATCH(gpu_props_.apiVersion));
+			Log::Error("Physical devices cannot enumerated.");
+			return false;
+		}
 
-			gpu_.getProperties(&gpu_props_);
+		// the full listing is slow console output, only on request
+		const bool dump = Settings::device_info_dump<bool> || CommandLine::HasOption("device-info");
 
-			uint32_t family_count;
-			std::unique_ptr<vk::QueueFamilyProperties[]> queue_props;
+		DeviceCapabilityCache capability_cache(BaseSystem::workspace_directory_ + "/device_capabilities.bin", instance_api_version_);
+		capability_cache.Load();
 
-			gpu_.getQueueFamilyProperties(&family_count, nullptr);
-			queue_props.reset(new vk::QueueFamilyProperties[family_count]);
-			gpu_.getQueueFamilyProperties(&family_count, queue_props.get());
+		std::vector<DeviceCapabilities> capabilities;
+		for (unsigned int i = 0; i < gpu_count; ++i)
+		{
+			capabilities.push_back(capability_cache.Get(physical_devices[i]));
 
-			for (unsigned int j = 0; j < family_count; ++j)
-			{
-				std::string str = "";
-				if (queue_props[j].queueFlags && VK_QUEUE_GRAPHICS_BIT)       str += "GRAPHICS ";
-				if (queue_props[j].queueFlags && VK_QUEUE_COMPUTE_BIT)       str += "COMPUTE ";
-				if (queue_props[j].queueFlags && VK_QUEUE_TRANSFER_BIT)       str += "TRANSFER ";
-				if (queue_props[j].queueFlags && VK_QUEUE_SPARSE_BINDING_BIT) str += "SPARSE ";
-				if (queue_props[j].queueFlags && VK_QUEUE_PROTECTED_BIT)      str += "PROTECTED ";
-
-				Log::Info("QueueFamily[%d/%d] queueFlags:" + str, j + 1, family_count);
-			}
+			if (dump) capabilities.back().Dump(i, gpu_count);
+			else capabilities.back().LogSummary(i);
+		}
 
-			uint32_t device_extension_count = 0;
-
-			auto result = gpu_.enumerateDeviceExtensionProperties(nullptr, &device_extension_count, nullptr);
-			assert(result == vk::Result::eSuccess);
-			Log::Info("Extension Count = %d", device_extension_count);
-
-			/*device features*/ {
-				vk::PhysicalDeviceFeatures dev_features;
-				gpu_.getFeatures(&dev_features);
-
-				Log::Info("enable features : true = 1, false = 0\n");
-				Log::Info("robustBufferAccess = %d", dev_features.robustBufferAccess);
-				Log::Info("fullDrawIndexUint32 = %d", dev_features.fullDrawIndexUint32);
-				Log::Info("imageCubeArray = %d", dev_features.imageCubeArray);
-				Log::Info("independentBlend = %d", dev_features.independentBlend);
-				Log::Info("geometryShader = %d", dev_features.geometryShader);
-				Log::Info("tessellationShader = %d", dev_features.tessellationShader);
-				Log::Info("sampleRateShading = %d", dev_features.sampleRateShading);
-				Log::Info("dualSrcBlend = %d", dev_features.dualSrcBlend);
-				Log::Info("logicOp = %d", dev_features.logicOp);
-				Log::Info("multiDrawIndirect = %d", dev_features.multiDrawIndirect);
-				Log::Info("drawIndirectFirstInstance = %d", dev_features.drawIndirectFirstInstance);
-				Log::Info("depthClamp = %d", dev_features.depthClamp);
-				Log::Info("depthBiasClamp = %d", dev_features.depthBiasClamp);
-				Log::Info("fillModeNonSolid = %d", dev_features.fillModeNonSolid);
-				Log::Info("depthBounds = %d", dev_features.depthBounds);
-				Log::Info("wideLines = %d", dev_features.wideLines);
-				Log::Info("largePoints = %d", dev_features.largePoints);
-				Log::Info("alphaToOne = %d", dev_features.alphaToOne);
-				Log::Info("multiViewport = %d", dev_features.multiViewport);
-				Log::Info("samplerAnisotropy = %d", dev_features.samplerAnisotropy);
-				Log::Info("textureCompressionETC2 = %d", dev_features.textureCompressionETC2);
-				Log::Info("textureCompressionASTC_LDR = %d", dev_features.textureCompressionASTC_LDR);
-				Log::Info("textureCompressionBC = %d", dev_features.textureCompressionBC);
-				Log::Info("occlusionQueryPrecise = %d", dev_features.occlusionQueryPrecise);
-				Log::Info("pipelineStatisticsQuery = %d", dev_features.pipelineStatisticsQuery);
-				Log::Info("vertexPipelineStoresAndAtomics = %d", dev_features.vertexPipelineStoresAndAtomics);
-				Log::Info("fragmentStoresAndAtomics = %d", dev_features.fragmentStoresAndAtomics);
-				Log::Info("shaderTessellationAndGeometryPointSize = %d", dev_features.shaderTessellationAndGeometryPointSize);
-				Log::Info("shaderImageGatherExtended = %d", dev_features.shaderImageGatherExtended);
-				Log::Info("shaderStorageImageExtendedFormats = %d", dev_features.shaderStorageImageExtendedFormats);
-				Log::Info("shaderStorageImageMultisample = %d", dev_features.shaderStorageImageMultisample);
-				Log::Info("shaderStorageImageReadWithoutFormat = %d", dev_features.shaderStorageImageReadWithoutFormat);
-				Log::Info("shaderStorageImageWriteWithoutFormat = %d", dev_features.shaderStorageImageWriteWithoutFormat);
-				Log::Info("shaderUniformBufferArrayDynamicIndexing = %d", dev_features.shaderUniformBufferArrayDynamicIndexing);
-				Log::Info("shaderSampledImageArrayDynamicIndexing = %d", dev_features.shaderSampledImageArrayDynamicIndexing);
-				Log::Info("shaderStorageBufferArrayDynamicIndexing = %d", dev_features.shaderStorageBufferArrayDynamicIndexing);
-				Log::Info("shaderStorageImageArrayDynamicIndexing = %d", dev_features.shaderStorageImageArrayDynamicIndexing);
-				Log::Info("shaderClipDistance = %d", dev_features.shaderClipDistance);
-				Log::Info("shaderCullDistance = %d", dev_features.shaderCullDistance);
-				Log::Info("shaderFloat64 = %d", dev_features.shaderFloat64);
-				Log::Info("shaderInt64 = %d", dev_features.shaderInt64);
-				Log::Info("shaderInt16 = %d", dev_features.shaderInt16);
-				Log::Info("shaderResourceResidency = %d", dev_features.shaderResourceResidency);
-				Log::Info("shaderResourceMinLod = %d", dev_features.shaderResourceMinLod);
-				Log::Info("sparseBinding = %d", dev_features.sparseBinding);
-				Log::Info("sparseResidencyBuffer = %d", dev_features.sparseResidencyBuffer);
-				Log::Info("sparseResidencyImage2D = %d", dev_features.sparseResidencyImage2D);
-				Log::Info("sparseResidencyImage3D = %d", dev_features.sparseResidencyImage3D);
-				Log::Info("sparseResidency2Samples = %d", dev_features.sparseResidency2Samples);
-				Log::Info("sparseResidency4Samples = %d", dev_features.sparseResidency4Samples);
-				Log::Info("sparseResidency8Samples = %d", dev_features.sparseResidency8Samples);
-				Log::Info("sparseResidency16Samples = %d", dev_features.sparseResidency16Samples);
-				Log::Info("sparseResidencyAliased = %d", dev_features.sparseResidencyAliased);
-				Log::Info("variableMultisampleRate = %d", dev_features.variableMultisampleRate);
-				Log::Info("inheritedQueries = %d\n", dev_features.inheritedQueries);
-			}
+		capability_cache.Save();
 
-			/*memory propaties*/ {
-				vk::PhysicalDeviceMemoryProperties memory_props;
-				gpu_.getMemoryProperties(&memory_props);
-			}
+		DeviceSelector::Requirements requirements = {};
+		requirements.surface = surface_;
+		if (!headless_) requirements.required_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+		if (Settings::bindless_enabled<bool>) requirements.wanted_extensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		if (Settings::pipeline_statistics_enabled<bool> || CommandLine::HasOption("pipeline-stats"))
+		{
+			requirements.wanted_features.pipelineStatisticsQuery = VK_TRUE;
+			requirements.wanted_features.inheritedQueries = VK_TRUE;
+			requirements.wanted_features.occlusionQueryPrecise = VK_TRUE;
 		}
 
-		/* For demo we just grab the first physical device */
-		gpu_ = physical_devices[0];
+		const auto selected = DeviceSelector::Select(capabilities, requirements, CommandLine::GetValue("gpu", Settings::gpu_override<const char*>));
+		if (selected < 0)
+		{
+			Log::Error("No physical device is suitable.\n\n"
+				"Do you have a compatible Vulkan installable client driver (ICD) installed?\n"
+				"Please look at the Getting Started guide for additional information.\n");
+			return false;
+		}
 
-		uint32_t device_extension_count = 0;
-		bool swapchain_ext_found = false;
-		unsigned int enabled_extension_count = 0;
+		auto& caps = capabilities[selected];
+		gpu_ = caps.gpu;
+		gpu_props_ = caps.properties;
+		gpu_features_ = caps.features;
+		mem_props_ = caps.memory;
 
-		result = gpu_.enumerateDeviceExtensionProperties(nullptr, &device_extension_count, nullptr);
-		assert(result == vk::Result::eSuccess);
+		queue_family_count_ = static_cast<uint32_t>(caps.queue_families.size());
+		queue_props_.reset(new vk::QueueFamilyProperties[queue_family_count_]);
+		std::copy(caps.queue_families.begin(), caps.queue_families.end(), queue_props_.get());
 
-		if (device_extension_count > 0)
-		{
-			std::unique_ptr<vk::ExtensionProperties[]> device_extensions(new vk::ExtensionProperties[device_extension_count]);
-			result = gpu_.enumerateDeviceExtensionProperties(nullptr, &device_extension_count, device_extensions.get());
-			assert(result == vk::Result::eSuccess);
+		/*descriptor indexing*/ {
+			descriptor_indexing_supported_ = false;
+			descriptor_indexing_features_ = caps.descriptor_indexing_features;
+			descriptor_indexing_props_ = caps.descriptor_indexing_props;
 
-			for (uint32_t i = 0; i < device_extension_count; ++i)
+			if (Settings::bindless_enabled<bool> && caps.descriptor_indexing_queried)
 			{
-				if (!strcmp(VK_KHR_SWAPCHAIN_EXTENSION_NAME, device_extensions[i].extensionName))
-				{
-					swapchain_ext_found = true;
-					//extension_names[enabled_extension_count++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
-				}
-				assert(enabled_extension_count < 64);
+				auto& f = descriptor_indexing_features_;
+				descriptor_indexing_supported_ = f.runtimeDescriptorArray && f.descriptorBindingPartiallyBound &&
+					f.descriptorBindingUpdateUnusedWhilePending && f.shaderSampledImageArrayNonUniformIndexing &&
+					f.descriptorBindingSampledImageUpdateAfterBind && f.descriptorBindingStorageBufferUpdateAfterBind;
 			}
-		}
 
-		if (!swapchain_ext_found)
-		{
-			Log::Error("vkEnumerateDeviceExtensionProperties failed to find the " VK_KHR_SWAPCHAIN_EXTENSION_NAME
-				" extension.\n\n"
-				"Do you have a compatible Vulkan installable client driver (ICD) installed?\n"
-				"Please look at the Getting Started guide for additional information.\n",
-				"vkCreateInstance Failure\n");
+			Log::Info("Descriptor indexing = %d", descriptor_indexing_supported_ ? 1 : 0);
 		}
-
-		gpu_.getQueueFamilyProperties(&queue_family_count_, nullptr);
-		queue_props_.reset(new vk::QueueFamilyProperties[queue_family_count_]);
-		gpu_.getQueueFamilyProperties(&queue_family_count_, queue_props_.get());
-		gpu_.getMemoryProperties(&mem_props_);
 	}
 	else
 	{
@@ -600,17 +867,30 @@ bool Graphics::Impl::EnumeratePhysicalDevice(void)
 
 bool Graphics::Impl::CreateSurface(void)
 {
+	PROFILE_FUNCTION();
+
+	if (headless_) return true;
+
+#if defined(VK_USE_PLATFORM_WIN32_KHR)
+	auto handles = platform_.GetNativeHandles();
+
 	auto const create_info = vk::Win32SurfaceCreateInfoKHR()
-		.setHinstance(window_->GetWindowInstance())
-		.setHwnd(window_->GetWindowHandle());
+		.setHinstance(static_cast<HINSTANCE>(handles.instance))
+		.setHwnd(static_cast<HWND>(handles.window));
 
 	auto result = instance_.createWin32SurfaceKHR(&create_info, nullptr, &surface_);
+#else
+	// no window system here, Platform::Create only gives the headless platform
+	auto result = vk::Result::eErrorExtensionNotPresent;
+#endif
 	if (result != vk::Result::eSuccess)
 	{
 		Log::Error("Surface cannot created.");
 		return false;
 	}
 
+	VulkanStats::CountCreated();
+
 	Log::Info("Surface create done.");
 
 	return true;
@@ -618,7 +898,14 @@ bool Graphics::Impl::CreateSurface(void)
 
 bool Graphics::Impl::CreateDevice(void)
 {
+	PROFILE_FUNCTION();
+
 	graphics_queue_family_index_ = FindQueue(vk::QueueFlagBits::eGraphics);
+	if (graphics_queue_family_index_ == 0xffffffff)
+	{
+		Log::Error("Graphics queue that presents cannot found.");
+		return false;
+	}
 
 	float const priorities[] = { 0.0 };
 
@@ -627,16 +914,29 @@ bool Graphics::Impl::CreateDevice(void)
 		.setQueueCount(1)
 		.setPQueuePriorities(priorities);
 
-	const char *extention_name[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+	std::vector<const char*> extention_name;
+	if (!headless_) extention_name.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	if (descriptor_indexing_supported_) extention_name.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+	// only what the bindless heap uses
+	auto indexing_features = vk::PhysicalDeviceDescriptorIndexingFeaturesEXT()
+		.setRuntimeDescriptorArray(VK_TRUE)
+		.setDescriptorBindingPartiallyBound(VK_TRUE)
+		.setDescriptorBindingUpdateUnusedWhilePending(VK_TRUE)
+		.setShaderSampledImageArrayNonUniformIndexing(VK_TRUE)
+		.setShaderStorageBufferArrayNonUniformIndexing(descriptor_indexing_features_.shaderStorageBufferArrayNonUniformIndexing)
+		.setDescriptorBindingSampledImageUpdateAfterBind(VK_TRUE)
+		.setDescriptorBindingStorageBufferUpdateAfterBind(VK_TRUE);
 
 	auto device_info = vk::DeviceCreateInfo()
+		.setPNext(descriptor_indexing_supported_ ? &indexing_features : nullptr)
 		.setQueueCreateInfoCount(1)
 		.setPQueueCreateInfos(&queue_info)
 		.setEnabledLayerCount(std::size(debug_layers_))
 		.setPpEnabledLayerNames(debug_layers_)
-		.setEnabledExtensionCount(std::size(extention_name))
-		.setPpEnabledExtensionNames(reinterpret_cast<const char* const*>(extention_name))
-		.setPEnabledFeatures(&gpu_.getFeatures());
+		.setEnabledExtensionCount(static_cast<uint32_t>(extention_name.size()))
+		.setPpEnabledExtensionNames(extention_name.data())
+		.setPEnabledFeatures(&gpu_features_);
 
 	gpu_.createDevice(&device_info, nullptr, &device_);
 
@@ -646,6 +946,8 @@ bool Graphics::Impl::CreateDevice(void)
 		return false;
 	}
 
+	VulkanStats::CountCreated();
+
 	Log::Info("Device create done.");
 
 	return true;
@@ -653,6 +955,8 @@ bool Graphics::Impl::CreateDevice(void)
 
 bool Graphics::Impl::CreateDebugLayer(void)
 {
+	PROFILE_FUNCTION();
+
 #if defined(_DEBUG)
 	{
 		create_debug_report_callback_ = reinterpret_cast<PFN_vkCreateDebugReportCallbackEXT>(instance_.getProcAddr("vkCreateDebugReportCallbackEXT"));
@@ -672,6 +976,8 @@ bool Graphics::Impl::CreateDebugLayer(void)
 			Log::Error("Debug layer cannot created.");
 			return false;
 		}
+
+		VulkanStats::CountCreated();
 	}
 #endif
 
@@ -680,14 +986,14 @@ bool Graphics::Impl::CreateDebugLayer(void)
 
 bool Graphics::Impl::CreatePipelineCache(void)
 {
-	auto result = device_.createPipelineCache(vk::PipelineCacheCreateInfo());
-	if (result.result != vk::Result::eSuccess)
-	{
-		Log::Error("Pipeline cache cannot created.");
-		return false;
-	}
+	PROFILE_FUNCTION();
+
+	DirectoryUtils::CreateDirectories(BaseSystem::workspace_directory_);
 
-	pipeline_cache_ = result.value;
+	pipeline_cache_file_ = std::make_unique<PipelineCacheFile>(device_, gpu_props_, BaseSystem::workspace_directory_ + "/" + PipelineCacheFile::GetFileName(gpu_props_));
+
+	pipeline_cache_ = pipeline_cache_file_->Create();
+	if (!pipeline_cache_) return false;
 
 	Log::Info("Pipeline cache create done.");
 
@@ -696,6 +1002,8 @@ bool Graphics::Impl::CreatePipelineCache(void)
 
 bool Graphics::Impl::CreateQueue(void)
 {
+	PROFILE_FUNCTION();
+
 	device_.getQueue(graphics_queue_family_index_, 0, &queue_);
 
 	Log::Info("Graphics queue create done.");
@@ -703,8 +1011,48 @@ bool Graphics::Impl::CreateQueue(void)
 	return true;
 }
 
+bool Graphics::Impl::CreateTimeline(void)
+{
+	PROFILE_FUNCTION();
+
+	timeline_ = std::make_unique<GpuTimeline>(device_, queue_);
+
+	Log::Info("Gpu timeline create done.");
+
+	return true;
+}
+
+bool Graphics::Impl::CreateMemoryAllocator(void)
+{
+	PROFILE_FUNCTION();
+
+	memory_ = std::make_unique<MemoryAllocator>(device_, mem_props_,
+		[this](uint32_t type_bits, vk::MemoryPropertyFlags flags) { return FindMemoryTypeIndex(type_bits, flags); });
+
+	Log::Info("Memory allocator create done.");
+
+	return true;
+}
+
+bool Graphics::Impl::CreateTransientAllocator(void)
+{
+	PROFILE_FUNCTION();
+
+	transients_ = std::make_unique<TransientAllocator>(device_, *timeline_, *memory_, frame_count_);
+
+	transients_->SetAliasingEnabled(Settings::transient_aliasing<bool>);
+
+	render_graph_.SetTransientAllocator(transients_.get());
+
+	Log::Info("Transient allocator create done.");
+
+	return true;
+}
+
 bool Graphics::Impl::CreateCommandPool(void)
 {
+	PROFILE_FUNCTION();
+
 	auto command_info = vk::CommandPoolCreateInfo()
 		.setQueueFamilyIndex(graphics_queue_family_index_)
 		.setFlags(vk::CommandPoolCreateFlagBits::eResetCommandBuffer);
@@ -717,6 +1065,8 @@ bool Graphics::Impl::CreateCommandPool(void)
 		return false;
 	}
 
+	VulkanStats::CountCreated();
+
 	Log::Info("Commandpool create done.");
 
 	return true;
@@ -724,39 +1074,58 @@ bool Graphics::Impl::CreateCommandPool(void)
 
 bool Graphics::Impl::CreateSwapChain(void)
 {
+	PROFILE_FUNCTION();
+
 	auto old_sc = swap_chain_;
 
 	swap_target_format_ = vk::Format::eR8G8B8A8Unorm;
 
+	if (headless_) return CreateOffscreenTargets();
+
 	vk::SurfaceCapabilitiesKHR caps;
 	auto result = gpu_.getSurfaceCapabilitiesKHR(surface_, &caps);
 	assert(result == vk::Result::eSuccess);
 
+	if (caps.currentExtent.width == 0 || caps.currentExtent.height == 0)
+	{
+		// minimized
+		return false;
+	}
+
 	uint32_t format_count;
 	result = gpu_.getSurfaceFormatsKHR(surface_, &format_count, nullptr);
 	assert(result == vk::Result::eSuccess);
 	
 	auto surface_format = std::make_unique<vk::SurfaceFormatKHR[]>(format_count);
-	
-	for (unsigned int i = 0; i < format_count; ++i)
-	{
-		gpu_.getSurfaceFormatsKHR(surface_, &i, &surface_format[i]);
-		// color formats
-		Log::Info("[%d]colorSpace : %d", i, surface_format[i].colorSpace);
-	}
 
 	result = gpu_.getSurfaceFormatsKHR(surface_, &format_count, surface_format.get());
 	assert(result == vk::Result::eSuccess);
 
+	if (!old_sc)
+	{
+		for (unsigned int i = 0; i < format_count; ++i)
+		{
+			// color formats
+			Log::Info("[%d]colorSpace : %d", i, surface_format[i].colorSpace);
+		}
+	}
+
 	uint32_t present_mode_count;
 	result = gpu_.getSurfacePresentModesKHR(surface_, &present_mode_count, nullptr);
 	assert(result == vk::Result::eSuccess);
 
-	auto present_mode = std::make_unique<vk::PresentModeKHR[]>(present_mode_count);
-	result = gpu_.getSurfacePresentModesKHR(surface_, &present_mode_count, present_mode.get());
+	std::vector<vk::PresentModeKHR> present_modes(present_mode_count);
+	result = gpu_.getSurfacePresentModesKHR(surface_, &present_mode_count, present_modes.data());
 	assert(result == vk::Result::eSuccess);
 
-	uint32_t image_count = 2;
+	present_mode_ = SelectPresentMode(present_modes);
+
+	uint32_t image_count = static_cast<uint32_t>(window_settings_.swapchain_image_count);
+	if (present_mode_ == vk::PresentModeKHR::eMailbox && image_count < 3)
+	{
+		// mailbox needs a spare image to replace
+		image_count = 3;
+	}
 	if (image_count < caps.minImageCount)
 	{
 		image_count = caps.minImageCount;
@@ -766,15 +1135,14 @@ bool Graphics::Impl::CreateSwapChain(void)
 		image_count = caps.maxImageCount;
 	}
 
-	vk::Extent2D extent;
 	if (caps.currentExtent.width == static_cast<uint32_t>(-1))
 	{
-		extent.width = Settings::window_width<uint32_t>;
-		extent.height = Settings::window_height<uint32_t>;
+		swap_extent_.width = static_cast<uint32_t>(window_settings_.width);
+		swap_extent_.height = static_cast<uint32_t>(window_settings_.height);
 	}
 	else
 	{
-		extent = caps.currentExtent;
+		swap_extent_ = caps.currentExtent;
 	}
 
 	vk::CompositeAlphaFlagBitsKHR composite_alpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
@@ -808,13 +1176,13 @@ bool Graphics::Impl::CreateSwapChain(void)
 		.setMinImageCount(image_count)
 		.setImageFormat(swap_target_format_)
 		.setImageColorSpace(vk::ColorSpaceKHR::eSrgbNonlinear)
-		.setImageExtent(extent)
+		.setImageExtent(swap_extent_)
 		.setImageArrayLayers(1)
-		.setImageUsage(vk::ImageUsageFlagBits::eColorAttachment)
+		.setImageUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst)
 		.setImageSharingMode(vk::SharingMode::eExclusive)
 		.setCompositeAlpha(composite_alpha)
 		.setPreTransform(pre_transform)
-		.setPresentMode(vk::PresentModeKHR::eFifo)
+		.setPresentMode(present_mode_)
 		.setClipped(true)
 		.setQueueFamilyIndexCount(0)
 		.setPQueueFamilyIndices(nullptr)
@@ -827,21 +1195,50 @@ bool Graphics::Impl::CreateSwapChain(void)
 		return false;
 	}
 
-	if (old_sc)
-	{
-		device_.destroySwapchainKHR(old_sc, nullptr);
-	}
+	VulkanStats::CountCreated();
+
+	// the old swapchain is retired by the caller, its images may still be in flight
 
 	auto sc_image_count = device_.getSwapchainImagesKHR(swap_chain_).value;
 	sc_image_count_ = static_cast<uint32_t>(sc_image_count.size());
 
-	Log::Info("Swapchain create done.");
+	Log::Info("Swapchain create done. (%dx%d, %d images, present mode %s)",
+		swap_extent_.width, swap_extent_.height, sc_image_count_, vk::to_string(present_mode_).c_str());
+
+	return true;
+}
+
+bool Graphics::Impl::CreateOffscreenTargets(void)
+{
+	PROFILE_FUNCTION();
+
+	auto const required = vk::FormatFeatureFlagBits::eColorAttachment | vk::FormatFeatureFlagBits::eTransferSrc | vk::FormatFeatureFlagBits::eTransferDst;
+
+	auto format_props = gpu_.getFormatProperties(swap_target_format_);
+	if ((format_props.optimalTilingFeatures & required) != required)
+	{
+		// 1.0 core has no transfer bits, the attachment feature decides
+		if (!(format_props.optimalTilingFeatures & vk::FormatFeatureFlagBits::eColorAttachment))
+		{
+			Log::Error("Offscreen target format do not supported ""eR8G8B8A8Unorm"".");
+			return false;
+		}
+	}
+
+	// fixed size, nothing resizes without a window
+	swap_extent_.width = static_cast<uint32_t>(window_settings_.width);
+	swap_extent_.height = static_cast<uint32_t>(window_settings_.height);
+	sc_image_count_ = std::max(1u, static_cast<uint32_t>(window_settings_.swapchain_image_count));
+
+	Log::Info("Offscreen targets create done. (%dx%d, %d images)", swap_extent_.width, swap_extent_.height, sc_image_count_);
 
 	return true;
 }
 
 bool Graphics::Impl::CreateRenderPass(void)
 {
+	PROFILE_FUNCTION();
+
 	const vk::AttachmentDescription attachments[] =
 	{
 		vk::AttachmentDescription()
@@ -852,7 +1249,7 @@ bool Graphics::Impl::CreateRenderPass(void)
 		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
 		.setInitialLayout(vk::ImageLayout::eUndefined)
-		.setFinalLayout(vk::ImageLayout::ePresentSrcKHR),
+		.setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal),	// render graph transitions to present
 		vk::AttachmentDescription()
 		.setFormat(depth_target_.format)
 		.setSamples(vk::SampleCountFlagBits::e1)
@@ -860,7 +1257,7 @@ bool Graphics::Impl::CreateRenderPass(void)
 		.setStoreOp(vk::AttachmentStoreOp::eDontCare)
 		.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 		.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-		.setInitialLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+		.setInitialLayout(vk::ImageLayout::eUndefined)
 		.setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
 	};
 
@@ -879,21 +1276,14 @@ bool Graphics::Impl::CreateRenderPass(void)
 		.setPreserveAttachmentCount(0)
 		.setPPreserveAttachments(nullptr);
 
-	auto const dependency = vk::SubpassDependency()
-		.setSrcSubpass(0)
-		.setDstSubpass(VK_SUBPASS_EXTERNAL)
-		.setSrcStageMask(vk::PipelineStageFlagBits::eBottomOfPipe)
-		.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-		.setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
-		.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentRead);
-
+	// external dependencies come from the render graph barriers around the pass
 	auto const rp_info = vk::RenderPassCreateInfo()
 		.setAttachmentCount(std::size(attachments))
 		.setPAttachments(attachments)
 		.setSubpassCount(1)
 		.setPSubpasses(&subpass)
-		.setDependencyCount(1)
-		.setPDependencies(&dependency);
+		.setDependencyCount(0)
+		.setPDependencies(nullptr);
 
 	auto result = device_.createRenderPass(&rp_info, nullptr, &render_pass_);
 	if (result != vk::Result::eSuccess)
@@ -902,6 +1292,8 @@ bool Graphics::Impl::CreateRenderPass(void)
 		return false;
 	}
 
+	VulkanStats::CountCreated();
+
 	Log::Info("Render pass create done.");
 
 	return true;
@@ -909,18 +1301,32 @@ bool Graphics::Impl::CreateRenderPass(void)
 
 bool Graphics::Impl::InitSemaphoreSettings(void)
 {
-	vk::SemaphoreCreateInfo semaphore_info;
+	PROFILE_FUNCTION();
 
-	// present command completed comfirm
-	device_.createSemaphore(&semaphore_info, nullptr, &present_complete_semaphore_);
+	vk::SemaphoreCreateInfo semaphore_info;
 
-	// draw command completed comfirm
-	device_.createSemaphore(&semaphore_info, nullptr, &draw_complete_semaphore_);
+	frame_resources_.reset(new FrameResources[frame_count_]);
 
-	if (!present_complete_semaphore_ || !draw_complete_semaphore_)
+	for (uint32_t i = 0; i < frame_count_; ++i)
 	{
-		Log::Error("Semaphores cannot setting.");
-		return false;
+		auto& frame = frame_resources_[i];
+
+		// nothing submitted, first wait of each slot does not block
+		frame.submit_value = 0;
+
+		// image acquired comfirm
+		device_.createSemaphore(&semaphore_info, nullptr, &frame.acquire_semaphore);
+
+		// draw command completed comfirm
+		device_.createSemaphore(&semaphore_info, nullptr, &frame.render_semaphore);
+
+		if (!frame.acquire_semaphore || !frame.render_semaphore)
+		{
+			Log::Error("Semaphores cannot setting.");
+			return false;
+		}
+
+		VulkanStats::CountCreated(2);
 	}
 
 	Log::Info("Semaphores setting done.");
@@ -930,42 +1336,392 @@ bool Graphics::Impl::InitSemaphoreSettings(void)
 
 bool Graphics::Impl::CreateCommandBufffer(void)
 {
-	vk::CommandBufferAllocateInfo alloc_info;
-	alloc_info.commandPool = command_pool_;
-	alloc_info.commandBufferCount = sc_image_count_;
+	PROFILE_FUNCTION();
+
+	auto pool_info = vk::CommandPoolCreateInfo()
+		.setQueueFamilyIndex(graphics_queue_family_index_)
+		.setFlags(vk::CommandPoolCreateFlagBits::eTransient);
 
-	auto result = device_.allocateCommandBuffers(alloc_info);
-	if (result.result != vk::Result::eSuccess)
+	for (uint32_t i = 0; i < frame_count_; ++i)
 	{
-		Log::Error("Command buffers cannot created.");
-		return false;
-	}
+		auto& frame = frame_resources_[i];
 
-	command_buffers_ = result.value;
+		device_.createCommandPool(&pool_info, nullptr, &frame.command_pool);
+		if (!frame.command_pool)
+		{
+			Log::Error("Frame commandpool cannot created.");
+			return false;
+		}
+
+		vk::CommandBufferAllocateInfo alloc_info;
+		alloc_info.commandPool = frame.command_pool;
+		alloc_info.commandBufferCount = 1;
+
+		auto result = device_.allocateCommandBuffers(alloc_info);
+		if (result.result != vk::Result::eSuccess)
+		{
+			Log::Error("Command buffers cannot created.");
+			return false;
+		}
+
+		frame.cmd_buffer = result.value[0];
+
+		VulkanStats::CountCreated(2);
+	}
 
 	Log::Info("Command buffers create done.");
 
 	return true;
 }
 
-bool Graphics::Impl::CreateSwapChainResources(void)
+bool Graphics::Impl::CreateCommandRecorder(void)
+{
+	PROFILE_FUNCTION();
+
+	recorder_ = std::make_unique<CommandRecorder>(device_, graphics_queue_family_index_, frame_count_, *thread_pool_);
+
+	return recorder_->Initialize();
+}
+
+bool Graphics::Impl::CreatePipelineCompiler(void)
+{
+	PROFILE_FUNCTION();
+
+	pipeline_compiler_ = std::make_unique<PipelineCompiler>(device_, pipeline_cache_, *thread_pool_);
+
+	Log::Info("Pipeline compiler create done.");
+
+	return true;
+}
+
+bool Graphics::Impl::CreateLayoutCache(void)
+{
+	PROFILE_FUNCTION();
+
+	layout_cache_ = std::make_unique<PipelineLayoutCache>(device_);
+
+	Log::Info("Pipeline layout cache create done.");
+
+	return true;
+}
+
+bool Graphics::Impl::CreateShaderCache(void)
+{
+	PROFILE_FUNCTION();
+
+	shader_cache_ = std::make_unique<ShaderModuleCache>(device_, BaseSystem::workspace_directory_ + "/shader_index.txt");
+
+	Log::Info("Shader module cache create done.");
+
+	return true;
+}
+
+bool Graphics::Impl::CreateBindlessHeap(void)
+{
+	PROFILE_FUNCTION();
+
+	// combined image samplers count as samplers and sampled images, eAll stages against every per-stage limit
+	uint32_t image_capacity, buffer_capacity, stage_resources;
+
+	if (descriptor_indexing_supported_)
+	{
+		auto& props = descriptor_indexing_props_;
+		image_capacity = std::min({ Settings::bindless_image_capacity<uint32_t>,
+			props.maxPerStageDescriptorUpdateAfterBindSamplers, props.maxPerStageDescriptorUpdateAfterBindSampledImages,
+			props.maxDescriptorSetUpdateAfterBindSamplers, props.maxDescriptorSetUpdateAfterBindSampledImages });
+		buffer_capacity = std::min({ Settings::bindless_buffer_capacity<uint32_t>,
+			props.maxPerStageDescriptorUpdateAfterBindStorageBuffers, props.maxDescriptorSetUpdateAfterBindStorageBuffers });
+		stage_resources = props.maxPerStageUpdateAfterBindResources;
+	}
+	else
+	{
+		auto& limits = gpu_props_.limits;
+		image_capacity = std::min({ Settings::bindless_fallback_capacity<uint32_t>,
+			limits.maxPerStageDescriptorSamplers, limits.maxPerStageDescriptorSampledImages,
+			limits.maxDescriptorSetSamplers, limits.maxDescriptorSetSampledImages });
+		buffer_capacity = std::min({ Settings::bindless_fallback_capacity<uint32_t>,
+			limits.maxPerStageDescriptorStorageBuffers, limits.maxDescriptorSetStorageBuffers });
+		stage_resources = limits.maxPerStageResources;
+	}
+
+	// both bindings share the stage's resource budget, in proportion to what they asked for
+	if (static_cast<uint64_t>(image_capacity) + buffer_capacity > stage_resources)
+	{
+		const uint64_t total = static_cast<uint64_t>(image_capacity) + buffer_capacity;
+		image_capacity = static_cast<uint32_t>(static_cast<uint64_t>(image_capacity) * stage_resources / total);
+		buffer_capacity = stage_resources - image_capacity;
+	}
+
+	bindless_ = std::make_unique<BindlessHeap>(device_, *timeline_, descriptor_indexing_supported_, image_capacity, buffer_capacity, frame_count_);
+
+	return bindless_->Initialize();
+}
+
+bool Graphics::Impl::CreateBindlessDefaults(void)
 {
-	auto result = device_.getSwapchainImagesKHR(swap_chain_, &sc_image_count_, nullptr);
+	PROFILE_FUNCTION();
+
+	// update-after-bind sets are partially bound, an empty slot is never read
+	if (bindless_->IsUpdateAfterBind()) return true;
+
+	auto& defaults = bindless_defaults_;
+
+	auto const image_info = vk::ImageCreateInfo()
+		.setImageType(vk::ImageType::e2D)
+		.setFormat(vk::Format::eR8G8B8A8Unorm)
+		.setExtent(vk::Extent3D(1, 1, 1))
+		.setMipLevels(1)
+		.setArrayLayers(1)
+		.setSamples(vk::SampleCountFlagBits::e1)
+		.setTiling(vk::ImageTiling::eOptimal)
+		.setUsage(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst)
+		.setSharingMode(vk::SharingMode::eExclusive)
+		.setInitialLayout(vk::ImageLayout::eUndefined);
+
+	auto result = device_.createImage(&image_info, nullptr, &defaults.image);
 	if (result != vk::Result::eSuccess)
 	{
-		Log::Error("Swap chain image count cannot get.");
+		Log::Error("Bindless default image cannot created.");
 		return false;
 	}
 
-	std::unique_ptr<vk::Image[]> images(new vk::Image[sc_image_count_]);
-	result = device_.getSwapchainImagesKHR(swap_chain_, &sc_image_count_, images.get());
+	VulkanStats::CountCreated();
+
+	defaults.allocation = memory_->AllocateImage(defaults.image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	if (!defaults.allocation)
+	{
+		Log::Error("Bindless default image memory cannot allocated.");
+		return false;
+	}
+
+	auto const color_range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+	auto const view_info = vk::ImageViewCreateInfo()
+		.setImage(defaults.image)
+		.setViewType(vk::ImageViewType::e2D)
+		.setFormat(image_info.format)
+		.setSubresourceRange(color_range);
+
+	result = device_.createImageView(&view_info, nullptr, &defaults.view);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Bindless default image view cannot created.");
+		return false;
+	}
+
+	VulkanStats::CountCreated();
+
+	auto const sampler_info = vk::SamplerCreateInfo()
+		.setMagFilter(vk::Filter::eNearest)
+		.setMinFilter(vk::Filter::eNearest)
+		.setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+		.setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+		.setAddressModeW(vk::SamplerAddressMode::eClampToEdge);
+
+	result = device_.createSampler(&sampler_info, nullptr, &defaults.sampler);
 	if (result != vk::Result::eSuccess)
 	{
-		Log::Error("Swap chain image cannot get.");
+		Log::Error("Bindless default sampler cannot created.");
 		return false;
 	}
 
-	sc_resources_.reset(new SwapchainImageResources[sc_image_count_]);
+	VulkanStats::CountCreated();
+
+	// storage buffers have to cover at least the minimum offset alignment
+	const vk::DeviceSize buffer_size = std::max<vk::DeviceSize>(256, gpu_props_.limits.minStorageBufferOffsetAlignment);
+
+	auto const buffer_info = vk::BufferCreateInfo()
+		.setSize(buffer_size)
+		.setUsage(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst)
+		.setSharingMode(vk::SharingMode::eExclusive);
+
+	result = device_.createBuffer(&buffer_info, nullptr, &defaults.buffer.buffer);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Bindless default buffer cannot created.");
+		return false;
+	}
+
+	VulkanStats::CountCreated();
+
+	defaults.buffer.allocation = memory_->AllocateBuffer(defaults.buffer.buffer, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	if (!defaults.buffer.allocation)
+	{
+		Log::Error("Bindless default buffer memory cannot allocated.");
+		return false;
+	}
+
+	// zero both and leave the image readable, once before the first frame
+	vk::CommandBufferAllocateInfo alloc_info;
+	alloc_info.commandPool = command_pool_;
+	alloc_info.commandBufferCount = 1;
+
+	auto cmd_result = device_.allocateCommandBuffers(alloc_info);
+	if (cmd_result.result != vk::Result::eSuccess)
+	{
+		Log::Error("Bindless default command buffer cannot created.");
+		return false;
+	}
+
+	auto cmd = cmd_result.value[0];
+	cmd.begin(vk::CommandBufferBeginInfo().setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+	auto to_transfer = vk::ImageMemoryBarrier()
+		.setOldLayout(vk::ImageLayout::eUndefined)
+		.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+		.setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+		.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setImage(defaults.image)
+		.setSubresourceRange(color_range);
+	cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &to_transfer);
+
+	cmd.clearColorImage(defaults.image, vk::ImageLayout::eTransferDstOptimal, vk::ClearColorValue(std::array<float, 4>{ 0.0f, 0.0f, 0.0f, 0.0f }), color_range);
+	cmd.fillBuffer(defaults.buffer.buffer, 0, VK_WHOLE_SIZE, 0);
+
+	auto to_shader = vk::ImageMemoryBarrier()
+		.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+		.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+		.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+		.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+		.setImage(defaults.image)
+		.setSubresourceRange(color_range);
+	auto const buffer_ready = vk::MemoryBarrier()
+		.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+		.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+	cmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eAllCommands, vk::DependencyFlags(), 1, &buffer_ready, 0, nullptr, 1, &to_shader);
+
+	cmd.end();
+
+	vk::SubmitInfo submit_info;
+	submit_info.commandBufferCount = 1;
+	submit_info.pCommandBuffers = &cmd;
+
+	const auto value = timeline_->Submit(submit_info);
+	const bool completed = value != 0 && timeline_->Wait(value);
+
+	device_.freeCommandBuffers(command_pool_, 1, &cmd);
+
+	if (!completed)
+	{
+		Log::Error("Bindless defaults cannot initialized.");
+		return false;
+	}
+
+	bindless_->SetDefaults(
+		vk::DescriptorImageInfo(defaults.sampler, defaults.view, vk::ImageLayout::eShaderReadOnlyOptimal),
+		vk::DescriptorBufferInfo(defaults.buffer.buffer, 0, VK_WHOLE_SIZE));
+
+	Log::Info("Bindless defaults create done.");
+
+	return true;
+}
+
+bool Graphics::Impl::CreateDescriptorAllocator(void)
+{
+	PROFILE_FUNCTION();
+
+	descriptors_ = std::make_unique<DescriptorAllocator>(device_, frame_count_);
+
+	return descriptors_->Initialize();
+}
+
+bool Graphics::Impl::CreateGpuProfiler(void)
+{
+	PROFILE_FUNCTION();
+
+	profiler_ = std::make_unique<GpuProfiler>(device_, *timeline_, gpu_props_.limits,
+		queue_props_[graphics_queue_family_index_].timestampValidBits, frame_count_);
+
+	render_graph_.SetProfiler(profiler_.get());
+
+	if (!profiler_->Initialize()) return false;
+
+	const bool statistics_enabled = Settings::pipeline_statistics_enabled<bool> || CommandLine::HasOption("pipeline-stats");
+	statistics_ = std::make_unique<PipelineStatistics>(device_, *timeline_, gpu_features_, frame_count_, statistics_enabled);
+	statistics_->SetProfiler(profiler_.get());
+
+	if (!statistics_->Initialize()) return false;
+
+	if (statistics_->IsEnabled()) render_graph_.SetPipelineStatistics(statistics_.get());
+
+	return true;
+}
+
+bool Graphics::Impl::CreateUploadRing(void)
+{
+	PROFILE_FUNCTION();
+
+	upload_ring_ = std::make_unique<UploadRing>(device_, *memory_, gpu_props_.limits, frame_count_, Settings::upload_ring_frame_size<vk::DeviceSize>);
+
+	return upload_ring_->Initialize();
+}
+
+bool Graphics::Impl::CreateSwapChainResources(void)
+{
+	PROFILE_FUNCTION();
+
+	std::unique_ptr<vk::Image[]> images;
+	vk::Result result;
+
+	if (headless_)
+	{
+		images.reset(new vk::Image[sc_image_count_]);
+		sc_resources_.reset(new SwapchainImageResources[sc_image_count_]);
+
+		auto const image_info = vk::ImageCreateInfo()
+			.setImageType(vk::ImageType::e2D)
+			.setFormat(swap_target_format_)
+			.setExtent(vk::Extent3D(swap_extent_.width, swap_extent_.height, 1))
+			.setMipLevels(1)
+			.setArrayLayers(1)
+			.setSamples(vk::SampleCountFlagBits::e1)
+			.setTiling(vk::ImageTiling::eOptimal)
+			.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc)
+			.setSharingMode(vk::SharingMode::eExclusive)
+			.setInitialLayout(vk::ImageLayout::eUndefined);
+
+		for (uint32_t i = 0; i < sc_image_count_; ++i)
+		{
+			result = device_.createImage(&image_info, nullptr, &images[i]);
+			if (result != vk::Result::eSuccess)
+			{
+				Log::Error("Offscreen image cannot created.");
+				return false;
+			}
+
+			VulkanStats::CountCreated();
+
+			sc_resources_[i].allocation = memory_->AllocateImage(images[i], vk::MemoryPropertyFlagBits::eDeviceLocal);
+			if (!sc_resources_[i].allocation)
+			{
+				device_.destroyImage(images[i]);
+				Log::Error("Offscreen image memory cannot allocated.");
+				return false;
+			}
+		}
+	}
+	else
+	{
+		result = device_.getSwapchainImagesKHR(swap_chain_, &sc_image_count_, nullptr);
+		if (result != vk::Result::eSuccess)
+		{
+			Log::Error("Swap chain image count cannot get.");
+			return false;
+		}
+
+		images.reset(new vk::Image[sc_image_count_]);
+		result = device_.getSwapchainImagesKHR(swap_chain_, &sc_image_count_, images.get());
+		if (result != vk::Result::eSuccess)
+		{
+			Log::Error("Swap chain image cannot get.");
+			return false;
+		}
+
+		sc_resources_.reset(new SwapchainImageResources[sc_image_count_]);
+	}
 
 	for (unsigned int i = 0; i < sc_image_count_; ++i)
 	{
@@ -977,7 +1733,7 @@ bool Graphics::Impl::CreateSwapChainResources(void)
 		sc_resources_[i].image = images[i];
 		image_view_info.image = sc_resources_[i].image;
 
-		sc_resources_[i].fence = vk::Fence();
+		sc_resources_[i].submit_value = 0;
 
 		result = device_.createImageView(&image_view_info, nullptr, &sc_resources_[i].view);
 		if (result != vk::Result::eSuccess)
@@ -985,6 +1741,8 @@ bool Graphics::Impl::CreateSwapChainResources(void)
 			Log::Error("Swap chain resources cannot created.");
 			return false;
 		}
+
+		VulkanStats::CountCreated();
 	}
 
 	Log::Info("Swap chain resources create done.");
@@ -994,18 +1752,38 @@ bool Graphics::Impl::CreateSwapChainResources(void)
 
 bool Graphics::Impl::CreateDepthImage(void)
 {
-	// supported check
-	depth_target_.format = vk::Format::eD32SfloatS8Uint;
-	vk::FormatProperties format_props = gpu_.getFormatProperties(depth_target_.format);
-	if (!(format_props.optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment))
+	PROFILE_FUNCTION();
+
+	// supported check, software and mobile drivers may lack the stencil formats
+	const vk::Format depth_formats[] =
+	{
+		vk::Format::eD32SfloatS8Uint,
+		vk::Format::eD24UnormS8Uint,
+		vk::Format::eD16UnormS8Uint,
+		vk::Format::eD32Sfloat,
+		vk::Format::eD16Unorm,
+	};
+
+	depth_target_.format = vk::Format::eUndefined;
+	for (auto format : depth_formats)
+	{
+		vk::FormatProperties format_props = gpu_.getFormatProperties(format);
+		if (format_props.optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment)
+		{
+			depth_target_.format = format;
+			break;
+		}
+	}
+
+	if (depth_target_.format == vk::Format::eUndefined)
 	{
-		Log::Error("Depth buffer format do not supported ""eD32SfloatS8Uint"".");
+		Log::Error("Depth buffer format do not supported.");
 		return false;
 	}
 
 	vk::Extent3D extent = vk::Extent3D()
-		.setWidth(Settings::window_width<uint32_t>)
-		.setHeight(Settings::window_height<uint32_t>)
+		.setWidth(swap_extent_.width)
+		.setHeight(swap_extent_.height)
 		.setDepth(1);
 
 	auto const image = vk::ImageCreateInfo()
@@ -1029,26 +1807,15 @@ bool Graphics::Impl::CreateDepthImage(void)
 		return false;
 	}
 
-	vk::MemoryRequirements mem_reqs;
-	device_.getImageMemoryRequirements(depth_target_.image, &mem_reqs);
-
-	depth_target_.mem_alloc.setAllocationSize(mem_reqs.size)
-		.setMemoryTypeIndex(FindMemoryTypeIndex(mem_reqs.memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal));
+	VulkanStats::CountCreated();
 
-	result = device_.allocateMemory(&depth_target_.mem_alloc, nullptr, &depth_target_.mem);
-	if (result != vk::Result::eSuccess)
+	depth_target_.allocation = memory_->AllocateImage(depth_target_.image, vk::MemoryPropertyFlagBits::eDeviceLocal);
+	if (!depth_target_.allocation)
 	{
 		Log::Error("Depth buffer memory cannot allocated.");
 		return false;
 	}
 
-	result = device_.bindImageMemory(depth_target_.image, depth_target_.mem, 0);
-	if (result != vk::Result::eSuccess)
-	{
-		Log::Error("Depth buffer memory cannot binded.");
-		return false;
-	}
-
 	vk::ImageViewCreateInfo view = vk::ImageViewCreateInfo()
 		.setImage(depth_target_.image)
 		.setViewType(vk::ImageViewType::e2D)
@@ -1063,6 +1830,8 @@ bool Graphics::Impl::CreateDepthImage(void)
 		return false;
 	}
 
+	VulkanStats::CountCreated();
+
 	Log::Info("Depth image create done.");
 
 	return true;
@@ -1070,6 +1839,8 @@ bool Graphics::Impl::CreateDepthImage(void)
 
 bool Graphics::Impl::CreateFrameBuffer(void)
 {
+	PROFILE_FUNCTION();
+
 	vk::ImageView attachments[2];
 	attachments[1] = depth_target_.view;
 
@@ -1077,8 +1848,8 @@ bool Graphics::Impl::CreateFrameBuffer(void)
 		.setRenderPass(render_pass_)
 		.setAttachmentCount(std::size(attachments))
 		.setPAttachments(attachments)
-		.setWidth(Settings::window_width<uint32_t>)
-		.setHeight(Settings::window_height<uint32_t>)
+		.setWidth(swap_extent_.width)
+		.setHeight(swap_extent_.height)
 		.setLayers(1);
 
 	for (uint32_t i = 0; i < sc_image_count_; ++i)
@@ -1089,7 +1860,10 @@ bool Graphics::Impl::CreateFrameBuffer(void)
 		if (result != vk::Result::eSuccess)
 		{
 			Log::Error("Frame buffer cannot created.");
+			continue;
 		}
+
+		VulkanStats::CountCreated();
 	}
 
 	Log::Info("Frame buffer create done.");
@@ -1097,6 +1871,139 @@ bool Graphics::Impl::CreateFrameBuffer(void)
 	return true;
 }
 
+bool Graphics::Impl::RecreateSwapChain(void)
+{
+	// no device wide wait, the in flight frames keep using the old objects
+	RetiredSwapchain retired;
+	retired.swap_chain = swap_chain_;
+	retired.depth = depth_target_;
+	retired.submit_value = timeline_->GetSubmittedValue();
+
+	for (uint32_t i = 0; i < sc_image_count_; ++i)
+	{
+		retired.views.push_back(sc_resources_[i].view);
+		retired.frame_buffers.push_back(sc_resources_[i].frame_buffer);
+	}
+
+	if (!CreateSwapChain())
+	{
+		// minimized or failed, nothing is retired yet
+		swap_chain_ = retired.swap_chain;
+		return false;
+	}
+
+	retired_swapchains_.push_back(retired);
+
+	if (!CreateSwapChainResources()) return false;
+
+	if (!CreateDepthImage()) return false;
+
+	if (!CreateFrameBuffer()) return false;
+
+	swapchain_dirty_ = false;
+
+	Log::Info("Swapchain rebuild done.");
+
+	return true;
+}
+
+void Graphics::Impl::ReleaseRetiredSwapChains(bool force)
+{
+	auto it = retired_swapchains_.begin();
+	while (it != retired_swapchains_.end())
+	{
+		// every frame submitted before the rebuild has completed
+		if (!force && !timeline_->IsCompleted(it->submit_value))
+		{
+			++it;
+			continue;
+		}
+
+		for (auto& frame_buffer : it->frame_buffers)
+		{
+			if (frame_buffer) device_.destroyFramebuffer(frame_buffer);
+		}
+		for (auto& view : it->views)
+		{
+			device_.destroyImageView(view);
+		}
+
+		device_.destroyImageView(it->depth.view);
+		device_.destroyImage(it->depth.image);
+		memory_->Free(it->depth.allocation);
+
+		device_.destroySwapchainKHR(it->swap_chain);
+
+		it = retired_swapchains_.erase(it);
+	}
+}
+
+void Graphics::Impl::DestroyBindlessDefaults(void)
+{
+	auto& defaults = bindless_defaults_;
+
+	if (defaults.sampler) device_.destroySampler(defaults.sampler);
+	if (defaults.view) device_.destroyImageView(defaults.view);
+	if (defaults.image) device_.destroyImage(defaults.image);
+	if (defaults.buffer.buffer) device_.destroyBuffer(defaults.buffer.buffer);
+	if (memory_)
+	{
+		memory_->Free(defaults.allocation);
+		memory_->Free(defaults.buffer.allocation);
+	}
+
+	bindless_defaults_ = BindlessDefaults();
+}
+
+void Graphics::Impl::DestroySwapChain(void)
+{
+	for (uint32_t i = 0; i < sc_image_count_; ++i)
+	{
+		if (sc_resources_[i].frame_buffer) device_.destroyFramebuffer(sc_resources_[i].frame_buffer);
+		device_.destroyImageView(sc_resources_[i].view);
+
+		// offscreen images are ours, swapchain images go with the swapchain
+		if (sc_resources_[i].allocation)
+		{
+			device_.destroyImage(sc_resources_[i].image);
+			if (memory_) memory_->Free(sc_resources_[i].allocation);
+		}
+	}
+	sc_resources_.reset();
+
+	device_.destroyImageView(depth_target_.view);
+	device_.destroyImage(depth_target_.image);
+	if (memory_) memory_->Free(depth_target_.allocation);
+	depth_target_ = Depth();
+
+	if (swap_chain_) device_.destroySwapchainKHR(swap_chain_);
+	swap_chain_ = vk::SwapchainKHR();
+}
+
+void Graphics::Impl::DestroyFrameResources(void)
+{
+	if (!frame_resources_) return;
+
+	// presents may still wait on render semaphores
+	queue_.waitIdle();
+
+	for (uint32_t i = 0; i < frame_count_; ++i)
+	{
+		auto& frame = frame_resources_[i];
+
+		device_.destroyCommandPool(frame.command_pool);
+		device_.destroySemaphore(frame.acquire_semaphore);
+		device_.destroySemaphore(frame.render_semaphore);
+	}
+
+	frame_resources_.reset();
+
+	for (uint32_t i = 0; i < sc_image_count_; ++i)
+	{
+		sc_resources_[i].submit_value = 0;
+	}
+}
+
 VKAPI_ATTR vk::Bool32 VKAPI_CALL DebugMessageCallback(
 	vk::DebugReportFlagsEXT flags,
 	vk::DebugReportObjectTypeEXT objType,
@@ -1,7 +1,19 @@
 #pragma once
 
 #include<memory>
-#include"..\Application\Window\Window.h"
+#include<cstdint>
+#include"../Application/Platform/Platform.h"
+
+class CommandRecorder;
+class MemoryAllocator;
+class UploadRing;
+class PipelineCompiler;
+class PipelineLayoutCache;
+class ShaderModuleCache;
+class BindlessHeap;
+class DescriptorAllocator;
+class GpuProfiler;
+class PipelineStatistics;
 
 class Graphics
 {
@@ -10,7 +22,8 @@ private:
 	std::unique_ptr<Impl> impl_;
 public:
 	Graphics() = delete;
-	Graphics(std::unique_ptr<Window>&);
+	// headless platform : offscreen images replace the surface and swapchain
+	Graphics(Platform&);
 	~Graphics();
 
 	bool Initialize(void);
@@ -19,4 +32,38 @@ public:
 
 	void BeginFrame(void);
 	void EndFrame(void);
+
+	// vk objects created in total, and during the last frame (0 in steady state)
+	uint64_t GetCreatedObjectCount(void) const;
+	uint64_t GetFrameCreatedObjectCount(void) const;
+
+	// draw list recorded in parallel into the main render pass
+	CommandRecorder& GetCommandRecorder(void);
+
+	// device memory of every buffer and image
+	MemoryAllocator& GetMemoryAllocator(void);
+
+	// asynchronous pipeline creation against the shared cache
+	PipelineCompiler& GetPipelineCompiler(void);
+
+	// layouts from reflected shaders, shared between pipelines with the same interface
+	PipelineLayoutCache& GetLayoutCache(void);
+
+	// one vk::ShaderModule per distinct SPIR-V binary
+	ShaderModuleCache& GetShaderCache(void);
+
+	// textures and buffers by index, one set for every draw
+	BindlessHeap& GetBindlessHeap(void);
+
+	// per-frame descriptor sets, reset with the frame
+	DescriptorAllocator& GetDescriptorAllocator(void);
+
+	// gpu time of the frame and of every render graph pass
+	GpuProfiler& GetGpuProfiler(void);
+
+	// per-pass pipeline statistics, idle unless enabled
+	PipelineStatistics& GetPipelineStatistics(void);
+
+	// per-frame dynamic data, bound with dynamic offsets
+	UploadRing& GetUploadRing(void);
 };
\ No newline at end of file
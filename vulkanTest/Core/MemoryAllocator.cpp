@@ -0,0 +1,428 @@
+#include<set>
+#include<mutex>
+#include<vector>
+#include<algorithm>
+
+#include"MemoryAllocator.h"
+#include"../Utilities/Log.h"
+
+namespace
+{
+	constexpr vk::DeviceSize max_block_size = 64ull * 1024 * 1024;
+	constexpr vk::DeviceSize min_node_size = 256;
+
+	vk::DeviceSize NextPowerOfTwo(vk::DeviceSize value)
+	{
+		vk::DeviceSize result = 1;
+		while (result < value) result <<= 1;
+		return result;
+	}
+}
+
+class MemoryAllocator::Impl
+{
+public:
+	struct Block
+	{
+		vk::DeviceMemory						memory;
+		void*									mapped;
+		std::vector<std::set<vk::DeviceSize>>	free_nodes;		// [level] offsets, level 0 is the whole block
+		vk::DeviceSize							used;
+	};
+
+	// one per memory type and kind
+	struct Pool
+	{
+		uint32_t				memory_type;
+		vk::DeviceSize			block_size;
+		uint32_t				level_count;
+		std::vector<Block>		blocks;
+	};
+
+	vk::Device							device_;
+	vk::PhysicalDeviceMemoryProperties	mem_props_;
+	FindMemoryType						find_memory_type_;
+	mutable std::mutex					mutex_;
+	std::vector<Pool>					pools_;			// [memory_type * 2 + kind]
+	std::vector<uint64_t>				requested_;		// [pool]
+	uint32_t							allocation_count_;
+	uint32_t							dedicated_count_;
+	uint64_t							dedicated_bytes_;
+	std::array<uint64_t, VK_MAX_MEMORY_HEAPS>	dedicated_heap_bytes_;
+
+	Impl(vk::Device device, const vk::PhysicalDeviceMemoryProperties& mem_props, FindMemoryType find_memory_type)
+		: device_(device)
+		, mem_props_(mem_props)
+		, find_memory_type_(find_memory_type)
+		, allocation_count_(0)
+		, dedicated_count_(0)
+		, dedicated_bytes_(0)
+		, dedicated_heap_bytes_()
+	{
+		pools_.resize(mem_props_.memoryTypeCount * 2);
+		requested_.resize(pools_.size(), 0);
+
+		for (uint32_t i = 0; i < pools_.size(); ++i)
+		{
+			auto& pool = pools_[i];
+			pool.memory_type = i / 2;
+
+			// small heaps get smaller blocks
+			auto heap_size = mem_props_.memoryHeaps[mem_props_.memoryTypes[pool.memory_type].heapIndex].size;
+			pool.block_size = max_block_size;
+			while (pool.block_size > min_node_size && pool.block_size > heap_size / 8) pool.block_size >>= 1;
+
+			pool.level_count = 1;
+			for (auto size = pool.block_size; size > min_node_size; size >>= 1) ++pool.level_count;
+		}
+	}
+
+	bool IsHostVisible(uint32_t memory_type) const
+	{
+		return static_cast<bool>(mem_props_.memoryTypes[memory_type].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible);
+	}
+
+	uint32_t GetHeap(uint32_t memory_type) const
+	{
+		return mem_props_.memoryTypes[memory_type].heapIndex;
+	}
+
+	vk::DeviceMemory AllocateMemory(uint32_t memory_type, vk::DeviceSize size, void** mapped)
+	{
+		auto const alloc_info = vk::MemoryAllocateInfo()
+			.setAllocationSize(size)
+			.setMemoryTypeIndex(memory_type);
+
+		vk::DeviceMemory memory;
+		auto result = device_.allocateMemory(&alloc_info, nullptr, &memory);
+		if (result != vk::Result::eSuccess)
+		{
+			Log::Error("Device memory cannot allocated.");
+			return vk::DeviceMemory();
+		}
+
+		VulkanStats::CountCreated();
+
+		*mapped = nullptr;
+		if (IsHostVisible(memory_type))
+		{
+			// persistently mapped
+			result = device_.mapMemory(memory, 0, VK_WHOLE_SIZE, vk::MemoryMapFlags(), mapped);
+			if (result != vk::Result::eSuccess)
+			{
+				Log::Error("Device memory cannot mapped.");
+				device_.freeMemory(memory);
+				return vk::DeviceMemory();
+			}
+		}
+
+		return memory;
+	}
+
+	void FreeMemory(vk::DeviceMemory memory, void* mapped)
+	{
+		if (mapped) device_.unmapMemory(memory);
+		device_.freeMemory(memory);
+	}
+
+	// split a larger free node down to the level
+	bool TakeNode(Pool& pool, Block& block, uint32_t level, vk::DeviceSize* offset)
+	{
+		uint32_t source = level + 1;
+		while (source-- > 0)
+		{
+			if (!block.free_nodes[source].empty()) break;
+		}
+		if (source > level) return false;
+
+		auto node = *block.free_nodes[source].begin();
+		block.free_nodes[source].erase(block.free_nodes[source].begin());
+
+		for (auto split = source; split < level; ++split)
+		{
+			// upper half becomes free at the next level
+			block.free_nodes[split + 1].insert(node + (pool.block_size >> (split + 1)));
+		}
+
+		*offset = node;
+		return true;
+	}
+
+	void ReleaseNode(Pool& pool, Block& block, uint32_t level, vk::DeviceSize offset)
+	{
+		while (level > 0)
+		{
+			auto buddy = offset ^ (pool.block_size >> level);
+			auto it = block.free_nodes[level].find(buddy);
+			if (it == block.free_nodes[level].end()) break;
+
+			block.free_nodes[level].erase(it);
+			offset = std::min(offset, buddy);
+			--level;
+		}
+
+		block.free_nodes[level].insert(offset);
+	}
+
+	uint32_t GetLevel(const Pool& pool, vk::DeviceSize size) const
+	{
+		uint32_t level = 0;
+		while (level + 1 < pool.level_count && (pool.block_size >> (level + 1)) >= size) ++level;
+		return level;
+	}
+};
+
+MemoryAllocator::MemoryAllocator(vk::Device device, const vk::PhysicalDeviceMemoryProperties& mem_props, FindMemoryType find_memory_type)
+	: impl_(std::make_unique<Impl>(device, mem_props, find_memory_type)) {}
+
+MemoryAllocator::~MemoryAllocator() = default;
+
+uint32_t MemoryAllocator::FindMemoryTypeIndex(uint32_t type_bits, vk::MemoryPropertyFlags flags) const
+{
+	return impl_->find_memory_type_(type_bits, flags);
+}
+
+MemoryAllocator::Allocation MemoryAllocator::Allocate(const vk::MemoryRequirements& reqs, vk::MemoryPropertyFlags flags, Kind kind)
+{
+	Allocation allocation = {};
+	allocation.level = no_level;
+
+	auto memory_type = FindMemoryTypeIndex(reqs.memoryTypeBits, flags);
+	if (memory_type == 0xffffffff)
+	{
+		Log::Error("Memory type do not supported.");
+		return allocation;
+	}
+
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	auto pool_index = memory_type * 2 + (kind == Kind::OPTIMAL ? 1 : 0);
+	auto& pool = impl_->pools_[pool_index];
+
+	// buddy nodes are aligned to their size
+	auto node_size = std::max({ NextPowerOfTwo(reqs.size), NextPowerOfTwo(reqs.alignment), min_node_size });
+
+	allocation.memory_type = memory_type;
+	allocation.pool = pool_index;
+	allocation.size = reqs.size;
+
+	// large resources would waste most of a block
+	if (node_size > pool.block_size / 2)
+	{
+		allocation.memory = impl_->AllocateMemory(memory_type, reqs.size, &allocation.mapped);
+		if (!allocation.memory) return allocation;
+
+		++impl_->dedicated_count_;
+		impl_->dedicated_bytes_ += reqs.size;
+		impl_->dedicated_heap_bytes_[impl_->GetHeap(memory_type)] += reqs.size;
+		++impl_->allocation_count_;
+		return allocation;
+	}
+
+	auto level = impl_->GetLevel(pool, node_size);
+
+	for (uint32_t i = 0; i < pool.blocks.size(); ++i)
+	{
+		auto& block = pool.blocks[i];
+		if (!block.memory) continue;
+
+		if (impl_->TakeNode(pool, block, level, &allocation.offset))
+		{
+			block.used += pool.block_size >> level;
+			allocation.memory = block.memory;
+			allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + allocation.offset : nullptr;
+			allocation.block = i;
+			allocation.level = level;
+			impl_->requested_[pool_index] += reqs.size;
+			++impl_->allocation_count_;
+			return allocation;
+		}
+	}
+
+	// new block, reuse an emptied slot
+	Impl::Block block;
+	block.memory = impl_->AllocateMemory(memory_type, pool.block_size, &block.mapped);
+	if (!block.memory) return allocation;
+	block.free_nodes.resize(pool.level_count);
+	block.free_nodes[0].insert(0);
+	block.used = 0;
+
+	uint32_t block_index = 0;
+	while (block_index < pool.blocks.size() && pool.blocks[block_index].memory) ++block_index;
+	if (block_index == pool.blocks.size()) pool.blocks.push_back(Impl::Block());
+	pool.blocks[block_index] = std::move(block);
+
+	auto& new_block = pool.blocks[block_index];
+	impl_->TakeNode(pool, new_block, level, &allocation.offset);
+	new_block.used += pool.block_size >> level;
+
+	allocation.memory = new_block.memory;
+	allocation.mapped = new_block.mapped ? static_cast<char*>(new_block.mapped) + allocation.offset : nullptr;
+	allocation.block = block_index;
+	allocation.level = level;
+	impl_->requested_[pool_index] += reqs.size;
+	++impl_->allocation_count_;
+
+	return allocation;
+}
+
+MemoryAllocator::Allocation MemoryAllocator::AllocateImage(vk::Image image, vk::MemoryPropertyFlags flags, Kind kind)
+{
+	vk::MemoryRequirements mem_reqs;
+	impl_->device_.getImageMemoryRequirements(image, &mem_reqs);
+
+	auto allocation = Allocate(mem_reqs, flags, kind);
+	if (!allocation) return allocation;
+
+	auto result = impl_->device_.bindImageMemory(image, allocation.memory, allocation.offset);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Image memory cannot binded.");
+		Free(allocation);
+	}
+
+	return allocation;
+}
+
+MemoryAllocator::Allocation MemoryAllocator::AllocateBuffer(vk::Buffer buffer, vk::MemoryPropertyFlags flags)
+{
+	vk::MemoryRequirements mem_reqs;
+	impl_->device_.getBufferMemoryRequirements(buffer, &mem_reqs);
+
+	auto allocation = Allocate(mem_reqs, flags, Kind::LINEAR);
+	if (!allocation) return allocation;
+
+	auto result = impl_->device_.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Buffer memory cannot binded.");
+		Free(allocation);
+	}
+
+	return allocation;
+}
+
+void MemoryAllocator::Free(Allocation& allocation)
+{
+	if (!allocation) return;
+
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	--impl_->allocation_count_;
+
+	if (allocation.level == no_level)
+	{
+		impl_->FreeMemory(allocation.memory, allocation.mapped);
+		--impl_->dedicated_count_;
+		impl_->dedicated_bytes_ -= allocation.size;
+		impl_->dedicated_heap_bytes_[impl_->GetHeap(allocation.memory_type)] -= allocation.size;
+		allocation = Allocation();
+		return;
+	}
+
+	auto& pool = impl_->pools_[allocation.pool];
+	auto& block = pool.blocks[allocation.block];
+
+	impl_->ReleaseNode(pool, block, allocation.level, allocation.offset);
+	block.used -= pool.block_size >> allocation.level;
+	impl_->requested_[allocation.pool] -= allocation.size;
+
+	// keep one empty block per pool against churn
+	if (block.used == 0)
+	{
+		auto empty_count = std::count_if(pool.blocks.begin(), pool.blocks.end(),
+			[](const Impl::Block& b) { return b.memory && b.used == 0; });
+
+		if (empty_count > 1)
+		{
+			impl_->FreeMemory(block.memory, block.mapped);
+			block = Impl::Block();
+		}
+	}
+
+	allocation = Allocation();
+}
+
+MemoryAllocator::Statistics MemoryAllocator::GetStatistics(void) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	Statistics stats = {};
+	stats.allocation_count = impl_->allocation_count_;
+	stats.dedicated_count = impl_->dedicated_count_;
+	stats.requested_bytes = impl_->dedicated_bytes_;
+	stats.used_bytes = impl_->dedicated_bytes_;
+	stats.reserved_bytes = impl_->dedicated_bytes_;
+	stats.heap_used_bytes = impl_->dedicated_heap_bytes_;
+	stats.heap_reserved_bytes = impl_->dedicated_heap_bytes_;
+
+	uint64_t free_bytes = 0;
+	uint64_t largest_free = 0;
+
+	for (uint32_t i = 0; i < impl_->pools_.size(); ++i)
+	{
+		auto& pool = impl_->pools_[i];
+		auto heap = impl_->GetHeap(pool.memory_type);
+
+		stats.requested_bytes += impl_->requested_[i];
+
+		for (auto& block : pool.blocks)
+		{
+			if (!block.memory) continue;
+
+			++stats.block_count;
+			stats.used_bytes += block.used;
+			stats.reserved_bytes += pool.block_size;
+			stats.heap_used_bytes[heap] += block.used;
+			stats.heap_reserved_bytes[heap] += pool.block_size;
+
+			free_bytes += pool.block_size - block.used;
+			for (uint32_t level = 0; level < pool.level_count; ++level)
+			{
+				if (block.free_nodes[level].empty()) continue;
+
+				largest_free = std::max<uint64_t>(largest_free, pool.block_size >> level);
+				break;
+			}
+		}
+	}
+
+	stats.fragmentation = free_bytes ? 1.0f - static_cast<float>(largest_free) / static_cast<float>(free_bytes) : 0.0f;
+
+	return stats;
+}
+
+void MemoryAllocator::LogStatistics(void) const
+{
+	auto stats = GetStatistics();
+
+	Log::Info("Memory %u allocations (%u dedicated) in %u blocks, fragmentation %.2f",
+		stats.allocation_count, stats.dedicated_count, stats.block_count, stats.fragmentation);
+
+	for (uint32_t i = 0; i < impl_->mem_props_.memoryHeapCount; ++i)
+	{
+		if (!stats.heap_reserved_bytes[i]) continue;
+
+		Log::Info("Memory heap %u : %llu KB used / %llu KB reserved", i,
+			stats.heap_used_bytes[i] / 1024, stats.heap_reserved_bytes[i] / 1024);
+	}
+}
+
+void MemoryAllocator::Destroy(void)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	if (impl_->allocation_count_ > 0)
+	{
+		Log::Warning("%u device memory allocations leaked.", impl_->allocation_count_);
+	}
+
+	for (auto& pool : impl_->pools_)
+	{
+		for (auto& block : pool.blocks)
+		{
+			if (block.memory) impl_->FreeMemory(block.memory, block.mapped);
+		}
+		pool.blocks.clear();
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include<array>
+#include<memory>
+#include<functional>
+#include"VulkanCommon.h"
+
+// Device memory sub-allocator.
+// Blocks are allocated per memory type and split with a buddy scheme, buffers and
+// optimal images use separate pools so bufferImageGranularity never applies.
+// Large resources get a dedicated vk::DeviceMemory.
+class MemoryAllocator
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	using FindMemoryType = std::function<uint32_t(uint32_t type_bits, vk::MemoryPropertyFlags)>;
+
+	enum class Kind
+	{
+		LINEAR,		// buffers and linear images
+		OPTIMAL,	// optimal tiling images
+	};
+
+	struct Allocation
+	{
+		vk::DeviceMemory	memory;
+		vk::DeviceSize		offset;
+		vk::DeviceSize		size;		// requested size
+		void*				mapped;		// host visible memory only
+		uint32_t			memory_type;
+		uint32_t			pool;
+		uint32_t			block;
+		uint32_t			level;		// buddy level, dedicated allocations use none
+
+		explicit operator bool(void) const { return static_cast<bool>(memory); }
+	};
+
+	struct Statistics
+	{
+		uint32_t	allocation_count;
+		uint32_t	dedicated_count;
+		uint32_t	block_count;
+		uint64_t	requested_bytes;
+		uint64_t	used_bytes;			// rounded to buddy nodes
+		uint64_t	reserved_bytes;		// vk::DeviceMemory in total
+		float		fragmentation;		// 1 - largest free node / free bytes
+		std::array<uint64_t, VK_MAX_MEMORY_HEAPS>	heap_used_bytes;
+		std::array<uint64_t, VK_MAX_MEMORY_HEAPS>	heap_reserved_bytes;
+	};
+
+	static constexpr uint32_t no_level = 0xffffffff;
+
+	MemoryAllocator() = delete;
+	MemoryAllocator(vk::Device, const vk::PhysicalDeviceMemoryProperties&, FindMemoryType);
+	~MemoryAllocator();
+
+	uint32_t FindMemoryTypeIndex(uint32_t type_bits, vk::MemoryPropertyFlags) const;
+
+	// empty allocation on failure
+	Allocation Allocate(const vk::MemoryRequirements&, vk::MemoryPropertyFlags, Kind);
+
+	// allocate and bind
+	Allocation AllocateImage(vk::Image, vk::MemoryPropertyFlags, Kind = Kind::OPTIMAL);
+	Allocation AllocateBuffer(vk::Buffer, vk::MemoryPropertyFlags);
+
+	// resource must no longer be used by the gpu
+	void Free(Allocation&);
+
+	Statistics GetStatistics(void) const;
+	void LogStatistics(void) const;
+
+	void Destroy(void);
+};
@@ -0,0 +1,213 @@
+#include<mutex>
+#include<atomic>
+#include<chrono>
+#include<vector>
+#include<cstring>
+
+#include"PipelineCacheFile.h"
+#include"../Utilities/Settings.h"
+#include"../Utilities/ThreadPool.h"
+#include"../Utilities/Utils.h"
+#include"../Utilities/Log.h"
+
+namespace
+{
+	// VkPipelineCacheHeaderVersionOne layout
+	struct CacheHeader
+	{
+		uint32_t	header_size;
+		uint32_t	header_version;
+		uint32_t	vendor_id;
+		uint32_t	device_id;
+		uint8_t		uuid[VK_UUID_SIZE];
+	};
+
+	void AppendHex(std::string& str, const uint8_t* bytes, size_t size)
+	{
+		static const char digits[] = "0123456789abcdef";
+
+		for (size_t i = 0; i < size; ++i)
+		{
+			str += digits[bytes[i] >> 4];
+			str += digits[bytes[i] & 0xf];
+		}
+	}
+
+	void AppendHex(std::string& str, uint32_t value)
+	{
+		const uint8_t bytes[] =
+		{
+			static_cast<uint8_t>(value >> 24), static_cast<uint8_t>(value >> 16),
+			static_cast<uint8_t>(value >> 8), static_cast<uint8_t>(value),
+		};
+		AppendHex(str, bytes, sizeof(bytes));
+	}
+}
+
+class PipelineCacheFile::Impl
+{
+public:
+	vk::Device								device_;
+	vk::PhysicalDeviceProperties			props_;
+	std::string								path_;
+	vk::PipelineCache						cache_;
+	std::mutex								save_mutex_;
+	std::atomic<bool>						saving_;
+	uint64_t								saved_hash_;	// content of the file, Save only, under save_mutex_
+	std::chrono::steady_clock::time_point	last_check_;
+
+	Impl(vk::Device device, const vk::PhysicalDeviceProperties& props, const std::string& path)
+		: device_(device)
+		, props_(props)
+		, path_(path)
+		, saving_(false)
+		, saved_hash_(0)
+		, last_check_(std::chrono::steady_clock::now()) {}
+
+	bool IsValid(const std::vector<char>& data) const
+	{
+		if (data.size() < sizeof(CacheHeader)) return false;
+
+		CacheHeader header;
+		std::memcpy(&header, data.data(), sizeof(header));
+
+		return header.header_size >= sizeof(CacheHeader)
+			&& header.header_version == static_cast<uint32_t>(vk::PipelineCacheHeaderVersion::eOne)
+			&& header.vendor_id == props_.vendorID
+			&& header.device_id == props_.deviceID
+			&& std::memcmp(header.uuid, props_.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+	size_t GetDataSize(void) const
+	{
+		size_t size = 0;
+		device_.getPipelineCacheData(cache_, &size, nullptr);
+		return size;
+	}
+
+	// a blob of the same size may still differ, the hash decides
+	static uint64_t Hash(const std::vector<char>& data)
+	{
+		return data.empty() ? 0 : HashUtils::Hash64(data.data(), data.size());
+	}
+};
+
+PipelineCacheFile::PipelineCacheFile(vk::Device device, const vk::PhysicalDeviceProperties& props, const std::string& path)
+	: impl_(std::make_unique<Impl>(device, props, path)) {}
+
+PipelineCacheFile::~PipelineCacheFile() = default;
+
+std::string PipelineCacheFile::GetFileName(const vk::PhysicalDeviceProperties& props)
+{
+	std::string name = "pipeline_cache_";
+	AppendHex(name, props.vendorID);
+	name += '_';
+	AppendHex(name, props.deviceID);
+	name += '_';
+	AppendHex(name, props.pipelineCacheUUID, VK_UUID_SIZE);
+	return name + ".bin";
+}
+
+vk::PipelineCache PipelineCacheFile::Create(void)
+{
+	std::vector<char> data;
+	if (FileUtils::ReadBinary(impl_->path_, data))
+	{
+		if (!impl_->IsValid(data))
+		{
+			// other gpu or driver update, the driver would reject it anyway
+			Log::Warning("Pipeline cache file is stale, discarded.");
+			data.clear();
+		}
+	}
+
+	auto cache_info = vk::PipelineCacheCreateInfo()
+		.setInitialDataSize(data.size())
+		.setPInitialData(data.empty() ? nullptr : data.data());
+
+	auto result = impl_->device_.createPipelineCache(&cache_info, nullptr, &impl_->cache_);
+	if (result != vk::Result::eSuccess && !data.empty())
+	{
+		Log::Warning("Pipeline cache file rejected, starting empty.");
+		cache_info = vk::PipelineCacheCreateInfo();
+		data.clear();
+		result = impl_->device_.createPipelineCache(&cache_info, nullptr, &impl_->cache_);
+	}
+
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Pipeline cache cannot created.");
+		return vk::PipelineCache();
+	}
+
+	VulkanStats::CountCreated();
+
+	impl_->saved_hash_ = Impl::Hash(data);
+
+	if (!data.empty())
+	{
+		Log::Info("Pipeline cache loaded %llu bytes.", static_cast<unsigned long long>(data.size()));
+	}
+
+	return impl_->cache_;
+}
+
+void PipelineCacheFile::Update(ThreadPool& thread_pool)
+{
+	auto now = std::chrono::steady_clock::now();
+	if (now - impl_->last_check_ < std::chrono::seconds(Settings::pipeline_cache_flush_seconds<int>)) return;
+
+	impl_->last_check_ = now;
+
+	// the worker reads and hashes the blob, nothing is written when it did not change
+	if (impl_->saving_.exchange(true)) return;
+
+	thread_pool.Push([this](uint32_t)
+	{
+		Save();
+		impl_->saving_.store(false);
+	});
+}
+
+bool PipelineCacheFile::Save(void)
+{
+	if (!impl_->cache_) return false;
+
+	std::lock_guard<std::mutex> lock(impl_->save_mutex_);
+
+	// the cache may still grow between the two calls, incomplete is retried
+	std::vector<char> data;
+	vk::Result result;
+	do
+	{
+		size_t size = impl_->GetDataSize();
+		data.resize(size);
+		result = impl_->device_.getPipelineCacheData(impl_->cache_, &size, data.data());
+		data.resize(size);
+	} while (result == vk::Result::eIncomplete);
+
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Pipeline cache data cannot read.");
+		return false;
+	}
+
+	const auto hash = Impl::Hash(data);
+	if (hash == impl_->saved_hash_) return true;
+
+	if (!FileUtils::WriteBinaryAtomic(impl_->path_, data.data(), data.size()))
+	{
+		Log::Error("Pipeline cache file cannot written.");
+		return false;
+	}
+
+	impl_->saved_hash_ = hash;
+
+	return true;
+}
+
+void PipelineCacheFile::Destroy(void)
+{
+	if (impl_->cache_) impl_->device_.destroyPipelineCache(impl_->cache_);
+	impl_->cache_ = vk::PipelineCache();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include<memory>
+#include<string>
+#include"VulkanCommon.h"
+
+class ThreadPool;
+
+// Keeps the vk::PipelineCache on disk between runs.
+// The blob is loaded only if its header matches this device and driver build,
+// saves go through a temporary file so a crash never leaves a torn cache.
+// Every gpu keeps its own file, switching with --gpu does not overwrite another's cache.
+class PipelineCacheFile
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	PipelineCacheFile() = delete;
+	PipelineCacheFile(vk::Device, const vk::PhysicalDeviceProperties&, const std::string& path);
+	~PipelineCacheFile();
+
+	// keyed by vendor id, device id and pipeline cache uuid
+	static std::string GetFileName(const vk::PhysicalDeviceProperties&);
+
+	// cache seeded from the file, empty if missing or stale
+	vk::PipelineCache Create(void);
+
+	// background save once the interval passed and the content changed
+	void Update(ThreadPool&);
+
+	// blocking, skipped when nothing changed since the last save
+	bool Save(void);
+
+	void Destroy(void);
+};
@@ -0,0 +1,234 @@
+#include<algorithm>
+#include<mutex>
+#include<atomic>
+#include<chrono>
+
+#include"PipelineCompiler.h"
+#include"../Utilities/ThreadPool.h"
+#include"../Utilities/Log.h"
+
+namespace
+{
+	struct StageStorage
+	{
+		vk::SpecializationInfo				specialization;
+		vk::PipelineShaderStageCreateInfo	info;
+	};
+
+	// points into the stage, which must stay alive and unmoved during the create call
+	StageStorage MakeStage(const PipelineCompiler::ShaderStage& stage)
+	{
+		StageStorage storage;
+
+		storage.specialization = vk::SpecializationInfo()
+			.setMapEntryCount(static_cast<uint32_t>(stage.specialization_entries.size()))
+			.setPMapEntries(stage.specialization_entries.data())
+			.setDataSize(stage.specialization_data.size())
+			.setPData(stage.specialization_data.data());
+
+		storage.info = vk::PipelineShaderStageCreateInfo()
+			.setStage(stage.stage)
+			.setModule(stage.module)
+			.setPName(stage.entry_point.c_str());
+
+		return storage;
+	}
+}
+
+class PipelineCompiler::Impl
+{
+public:
+	vk::Device					device_;
+	vk::PipelineCache			pipeline_cache_;
+	ThreadPool&					thread_pool_;
+	std::mutex					mutex_;
+	std::vector<vk::Pipeline>	pipelines_;
+	std::vector<std::shared_future<vk::Pipeline>>	pending_;
+	std::atomic<uint32_t>		pending_count_;
+
+	Impl(vk::Device device, vk::PipelineCache pipeline_cache, ThreadPool& thread_pool)
+		: device_(device)
+		, pipeline_cache_(pipeline_cache)
+		, thread_pool_(thread_pool)
+		, pending_count_(0) {}
+
+	vk::Pipeline Build(const GraphicsDesc& desc)
+	{
+		std::vector<StageStorage> stages;
+		for (auto& stage : desc.stages) stages.push_back(MakeStage(stage));
+
+		std::vector<vk::PipelineShaderStageCreateInfo> stage_infos;
+		for (auto& stage : stages)
+		{
+			stage.info.setPSpecializationInfo(stage.specialization.mapEntryCount ? &stage.specialization : nullptr);
+			stage_infos.push_back(stage.info);
+		}
+
+		auto const vertex_input = vk::PipelineVertexInputStateCreateInfo()
+			.setVertexBindingDescriptionCount(static_cast<uint32_t>(desc.vertex_bindings.size()))
+			.setPVertexBindingDescriptions(desc.vertex_bindings.data())
+			.setVertexAttributeDescriptionCount(static_cast<uint32_t>(desc.vertex_attributes.size()))
+			.setPVertexAttributeDescriptions(desc.vertex_attributes.data());
+
+		auto const input_assembly = vk::PipelineInputAssemblyStateCreateInfo()
+			.setTopology(desc.topology);
+
+		// viewport and scissor are dynamic by default
+		auto const viewport = vk::PipelineViewportStateCreateInfo()
+			.setViewportCount(1)
+			.setScissorCount(1);
+
+		auto const rasterization = vk::PipelineRasterizationStateCreateInfo()
+			.setPolygonMode(desc.polygon_mode)
+			.setCullMode(desc.cull_mode)
+			.setFrontFace(desc.front_face)
+			.setLineWidth(1.0f);
+
+		auto const multisample = vk::PipelineMultisampleStateCreateInfo()
+			.setRasterizationSamples(desc.samples);
+
+		auto const depth_stencil = vk::PipelineDepthStencilStateCreateInfo()
+			.setDepthTestEnable(desc.depth_test)
+			.setDepthWriteEnable(desc.depth_write)
+			.setDepthCompareOp(desc.depth_compare);
+
+		std::vector<vk::PipelineColorBlendAttachmentState> blend_attachments = desc.blend_attachments;
+		if (blend_attachments.empty())
+		{
+			blend_attachments.push_back(vk::PipelineColorBlendAttachmentState()
+				.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+					vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA));
+		}
+
+		auto const color_blend = vk::PipelineColorBlendStateCreateInfo()
+			.setAttachmentCount(static_cast<uint32_t>(blend_attachments.size()))
+			.setPAttachments(blend_attachments.data());
+
+		auto const dynamic = vk::PipelineDynamicStateCreateInfo()
+			.setDynamicStateCount(static_cast<uint32_t>(desc.dynamic_states.size()))
+			.setPDynamicStates(desc.dynamic_states.data());
+
+		auto const pipeline_info = vk::GraphicsPipelineCreateInfo()
+			.setStageCount(static_cast<uint32_t>(stage_infos.size()))
+			.setPStages(stage_infos.data())
+			.setPVertexInputState(&vertex_input)
+			.setPInputAssemblyState(&input_assembly)
+			.setPViewportState(&viewport)
+			.setPRasterizationState(&rasterization)
+			.setPMultisampleState(&multisample)
+			.setPDepthStencilState(&depth_stencil)
+			.setPColorBlendState(&color_blend)
+			.setPDynamicState(&dynamic)
+			.setLayout(desc.layout)
+			.setRenderPass(desc.render_pass)
+			.setSubpass(desc.subpass);
+
+		vk::Pipeline pipeline;
+		auto result = device_.createGraphicsPipelines(pipeline_cache_, 1, &pipeline_info, nullptr, &pipeline);
+		if (result != vk::Result::eSuccess)
+		{
+			Log::Error("Graphics pipeline " + desc.name + " cannot created.");
+			return vk::Pipeline();
+		}
+
+		return pipeline;
+	}
+
+	vk::Pipeline Build(const ComputeDesc& desc)
+	{
+		auto stage = MakeStage(desc.stage);
+		stage.info.setPSpecializationInfo(stage.specialization.mapEntryCount ? &stage.specialization : nullptr);
+
+		auto const pipeline_info = vk::ComputePipelineCreateInfo()
+			.setStage(stage.info)
+			.setLayout(desc.layout);
+
+		vk::Pipeline pipeline;
+		auto result = device_.createComputePipelines(pipeline_cache_, 1, &pipeline_info, nullptr, &pipeline);
+		if (result != vk::Result::eSuccess)
+		{
+			Log::Error("Compute pipeline " + desc.name + " cannot created.");
+			return vk::Pipeline();
+		}
+
+		return pipeline;
+	}
+
+	template<class Desc>
+	Handle Enqueue(Desc desc)
+	{
+		auto promise = std::make_shared<std::promise<vk::Pipeline>>();
+		std::shared_future<vk::Pipeline> future = promise->get_future().share();
+
+		++pending_count_;
+
+		// the cache is internally synchronized, workers compile against it concurrently
+		thread_pool_.Push([this, promise, desc = std::move(desc)](uint32_t)
+		{
+			auto pipeline = Build(desc);
+
+			if (pipeline)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				pipelines_.push_back(pipeline);
+				VulkanStats::CountCreated();
+			}
+
+			--pending_count_;
+			promise->set_value(pipeline);
+		});
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			// forget finished ones, keep the rest for Destroy()
+			pending_.erase(std::remove_if(pending_.begin(), pending_.end(),
+				[](const std::shared_future<vk::Pipeline>& f) { return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }),
+				pending_.end());
+			pending_.push_back(future);
+		}
+
+		return Handle(future);
+	}
+};
+
+PipelineCompiler::PipelineCompiler(vk::Device device, vk::PipelineCache pipeline_cache, ThreadPool& thread_pool)
+	: impl_(std::make_unique<Impl>(device, pipeline_cache, thread_pool)) {}
+
+PipelineCompiler::~PipelineCompiler() = default;
+
+PipelineCompiler::Handle PipelineCompiler::Compile(GraphicsDesc desc)
+{
+	return impl_->Enqueue(std::move(desc));
+}
+
+PipelineCompiler::Handle PipelineCompiler::Compile(ComputeDesc desc)
+{
+	return impl_->Enqueue(std::move(desc));
+}
+
+uint32_t PipelineCompiler::GetPendingCount(void) const
+{
+	return impl_->pending_count_.load();
+}
+
+void PipelineCompiler::Destroy(void)
+{
+	std::vector<std::shared_future<vk::Pipeline>> pending;
+	{
+		std::lock_guard<std::mutex> lock(impl_->mutex_);
+		pending.swap(impl_->pending_);
+	}
+
+	for (auto& future : pending)
+	{
+		future.wait();
+	}
+
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	for (auto& pipeline : impl_->pipelines_)
+	{
+		impl_->device_.destroyPipeline(pipeline);
+	}
+	impl_->pipelines_.clear();
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include<memory>
+#include<string>
+#include<vector>
+#include<future>
+#include"VulkanCommon.h"
+
+class ThreadPool;
+
+// Compiles pipelines on the worker threads against the shared pipeline cache.
+// Descriptions own their data so the caller's state may go away after Compile(),
+// the render thread polls the handle and never blocks on a driver compile.
+class PipelineCompiler
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	struct ShaderStage
+	{
+		vk::ShaderStageFlagBits					stage;
+		vk::ShaderModule						module;
+		std::string								entry_point = "main";
+		std::vector<vk::SpecializationMapEntry>	specialization_entries;
+		std::vector<uint8_t>					specialization_data;
+	};
+
+	struct GraphicsDesc
+	{
+		std::string										name;
+		std::vector<ShaderStage>						stages;
+		std::vector<vk::VertexInputBindingDescription>	vertex_bindings;
+		std::vector<vk::VertexInputAttributeDescription>	vertex_attributes;
+		vk::PrimitiveTopology							topology = vk::PrimitiveTopology::eTriangleList;
+		vk::PolygonMode									polygon_mode = vk::PolygonMode::eFill;
+		vk::CullModeFlags								cull_mode = vk::CullModeFlagBits::eBack;
+		vk::FrontFace									front_face = vk::FrontFace::eCounterClockwise;
+		vk::SampleCountFlagBits							samples = vk::SampleCountFlagBits::e1;
+		bool											depth_test = true;
+		bool											depth_write = true;
+		vk::CompareOp									depth_compare = vk::CompareOp::eLessOrEqual;
+		std::vector<vk::PipelineColorBlendAttachmentState>	blend_attachments;		// empty : one opaque attachment
+		std::vector<vk::DynamicState>					dynamic_states = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+		vk::PipelineLayout								layout;
+		vk::RenderPass									render_pass;
+		uint32_t										subpass = 0;
+	};
+
+	struct ComputeDesc
+	{
+		std::string			name;
+		ShaderStage			stage;
+		vk::PipelineLayout	layout;
+	};
+
+	// null pipeline after a failed compile
+	class Handle
+	{
+	private:
+		std::shared_future<vk::Pipeline> future_;
+
+	public:
+		Handle() = default;
+		Handle(std::shared_future<vk::Pipeline> future) : future_(std::move(future)) {}
+
+		bool IsValid(void) const { return future_.valid(); }
+
+		// non-blocking
+		bool IsReady(void) const
+		{
+			return future_.valid() && future_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		}
+
+		// null until ready
+		vk::Pipeline Get(void) const { return IsReady() ? future_.get() : vk::Pipeline(); }
+
+		// blocks, for load screens
+		vk::Pipeline Wait(void) const { return future_.valid() ? future_.get() : vk::Pipeline(); }
+	};
+
+	PipelineCompiler() = delete;
+	PipelineCompiler(vk::Device, vk::PipelineCache, ThreadPool&);
+	~PipelineCompiler();
+
+	Handle Compile(GraphicsDesc);
+	Handle Compile(ComputeDesc);
+
+	// compiles still queued or running
+	uint32_t GetPendingCount(void) const;
+
+	// waits for pending compiles, then destroys every pipeline it created
+	void Destroy(void);
+};
@@ -0,0 +1,205 @@
+#include<map>
+#include<mutex>
+#include<algorithm>
+
+#include"PipelineLayoutCache.h"
+#include"../Utilities/Log.h"
+
+class PipelineLayoutCache::Impl
+{
+public:
+	using Key = std::vector<uint64_t>;
+
+	vk::Device										device_;
+	mutable std::mutex								mutex_;
+	std::map<Key, vk::DescriptorSetLayout>			set_layouts_;
+	std::map<Key, vk::PipelineLayout>				pipeline_layouts_;
+
+	Impl(vk::Device device) : device_(device) {}
+
+	static uint64_t ToKey(vk::DescriptorSetLayout layout)
+	{
+		return reinterpret_cast<uint64_t>(static_cast<VkDescriptorSetLayout>(layout));
+	}
+
+	// one mask per pipeline type, a set used from other stages keeps the same layout
+	static vk::ShaderStageFlags NormalizeStages(vk::ShaderStageFlags stages)
+	{
+		if (stages & vk::ShaderStageFlagBits::eCompute) return vk::ShaderStageFlagBits::eCompute;
+		return vk::ShaderStageFlagBits::eAllGraphics;
+	}
+
+	bool GetSetLayouts(PipelineLayoutCache& cache, const std::vector<ShaderReflection::DescriptorBinding>& bindings, std::vector<vk::DescriptorSetLayout>& set_layouts)
+	{
+		uint32_t set_count = 0;
+		for (auto& binding : bindings)
+		{
+			set_count = std::max(set_count, binding.set + 1);
+		}
+
+		std::vector<std::vector<vk::DescriptorSetLayoutBinding>> sets(set_count);
+		for (auto& binding : bindings)
+		{
+			// runtime arrays need descriptor indexing, reflected layouts bind one
+			sets[binding.set].push_back(vk::DescriptorSetLayoutBinding()
+				.setBinding(binding.binding)
+				.setDescriptorType(binding.type)
+				.setDescriptorCount(std::max(binding.count, 1u))
+				.setStageFlags(NormalizeStages(binding.stages)));
+		}
+
+		set_layouts.clear();
+		for (auto& set : sets)
+		{
+			auto layout = cache.GetSetLayout(set);
+			if (!layout) return false;
+			set_layouts.push_back(layout);
+		}
+
+		return true;
+	}
+};
+
+PipelineLayoutCache::PipelineLayoutCache(vk::Device device) : impl_(std::make_unique<Impl>(device)) {}
+
+PipelineLayoutCache::~PipelineLayoutCache() = default;
+
+vk::DescriptorSetLayout PipelineLayoutCache::GetSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>& bindings)
+{
+	// immutable samplers are not part of the key, reflected layouts have none
+	auto sorted = bindings;
+	std::sort(sorted.begin(), sorted.end(), [](const vk::DescriptorSetLayoutBinding& a, const vk::DescriptorSetLayoutBinding& b)
+	{
+		return a.binding < b.binding;
+	});
+
+	Impl::Key key;
+	for (auto& binding : sorted)
+	{
+		key.push_back(binding.binding);
+		key.push_back(static_cast<uint64_t>(binding.descriptorType));
+		key.push_back(binding.descriptorCount);
+		key.push_back(static_cast<VkShaderStageFlags>(binding.stageFlags));
+	}
+
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	auto it = impl_->set_layouts_.find(key);
+	if (it != impl_->set_layouts_.end()) return it->second;
+
+	auto const layout_info = vk::DescriptorSetLayoutCreateInfo()
+		.setBindingCount(static_cast<uint32_t>(sorted.size()))
+		.setPBindings(sorted.data());
+
+	vk::DescriptorSetLayout layout;
+	auto result = impl_->device_.createDescriptorSetLayout(&layout_info, nullptr, &layout);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Descriptor set layout cannot created.");
+		return vk::DescriptorSetLayout();
+	}
+
+	VulkanStats::CountCreated();
+
+	impl_->set_layouts_.emplace(key, layout);
+
+	return layout;
+}
+
+vk::PipelineLayout PipelineLayoutCache::GetPipelineLayout(const std::vector<vk::DescriptorSetLayout>& set_layouts, const std::vector<vk::PushConstantRange>& push_constants)
+{
+	Impl::Key key;
+	key.push_back(set_layouts.size());
+	for (auto& layout : set_layouts)
+	{
+		key.push_back(Impl::ToKey(layout));
+	}
+	for (auto& range : push_constants)
+	{
+		key.push_back(static_cast<VkShaderStageFlags>(range.stageFlags));
+		key.push_back(range.offset);
+		key.push_back(range.size);
+	}
+
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	auto it = impl_->pipeline_layouts_.find(key);
+	if (it != impl_->pipeline_layouts_.end()) return it->second;
+
+	auto const layout_info = vk::PipelineLayoutCreateInfo()
+		.setSetLayoutCount(static_cast<uint32_t>(set_layouts.size()))
+		.setPSetLayouts(set_layouts.data())
+		.setPushConstantRangeCount(static_cast<uint32_t>(push_constants.size()))
+		.setPPushConstantRanges(push_constants.data());
+
+	vk::PipelineLayout layout;
+	auto result = impl_->device_.createPipelineLayout(&layout_info, nullptr, &layout);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Pipeline layout cannot created.");
+		return vk::PipelineLayout();
+	}
+
+	VulkanStats::CountCreated();
+
+	impl_->pipeline_layouts_.emplace(key, layout);
+
+	return layout;
+}
+
+bool PipelineLayoutCache::GetSetLayouts(const std::vector<const ShaderReflection::Module*>& modules, std::vector<vk::DescriptorSetLayout>& set_layouts)
+{
+	std::vector<ShaderReflection::DescriptorBinding> bindings;
+	std::vector<ShaderReflection::PushConstantRange> push_constants;
+	if (!ShaderReflection::Merge(modules, bindings, push_constants)) return false;
+
+	return impl_->GetSetLayouts(*this, bindings, set_layouts);
+}
+
+vk::PipelineLayout PipelineLayoutCache::GetPipelineLayout(const std::vector<const ShaderReflection::Module*>& modules)
+{
+	std::vector<ShaderReflection::DescriptorBinding> bindings;
+	std::vector<ShaderReflection::PushConstantRange> ranges;
+	if (!ShaderReflection::Merge(modules, bindings, ranges)) return vk::PipelineLayout();
+
+	std::vector<vk::DescriptorSetLayout> set_layouts;
+	if (!impl_->GetSetLayouts(*this, bindings, set_layouts)) return vk::PipelineLayout();
+
+	// pushes name the normalized stages too
+	std::vector<vk::PushConstantRange> push_constants;
+	for (auto& range : ranges)
+	{
+		push_constants.push_back(vk::PushConstantRange(Impl::NormalizeStages(range.stages), range.offset, range.size));
+	}
+
+	return GetPipelineLayout(set_layouts, push_constants);
+}
+
+uint32_t PipelineLayoutCache::GetSetLayoutCount(void) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	return static_cast<uint32_t>(impl_->set_layouts_.size());
+}
+
+uint32_t PipelineLayoutCache::GetPipelineLayoutCount(void) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	return static_cast<uint32_t>(impl_->pipeline_layouts_.size());
+}
+
+void PipelineLayoutCache::Destroy(void)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	for (auto& layout : impl_->pipeline_layouts_)
+	{
+		impl_->device_.destroyPipelineLayout(layout.second);
+	}
+	impl_->pipeline_layouts_.clear();
+
+	for (auto& layout : impl_->set_layouts_)
+	{
+		impl_->device_.destroyDescriptorSetLayout(layout.second);
+	}
+	impl_->set_layouts_.clear();
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include<memory>
+#include<vector>
+#include"VulkanCommon.h"
+#include"ShaderReflection.h"
+
+// Builds descriptor set and pipeline layouts from reflected shaders.
+// Layouts are keyed by content, shaders declaring the same interface get the same
+// handles so descriptor sets stay bound across pipeline switches.
+// Reflected stage flags are widened to every graphics stage (or compute), so the
+// stages a set is used from do not split its layout; pushConstants takes the same mask.
+class PipelineLayoutCache
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	PipelineLayoutCache() = delete;
+	PipelineLayoutCache(vk::Device);
+	~PipelineLayoutCache();
+
+	// thread safe, null on failure
+	vk::DescriptorSetLayout GetSetLayout(const std::vector<vk::DescriptorSetLayoutBinding>&);
+	vk::PipelineLayout GetPipelineLayout(const std::vector<vk::DescriptorSetLayout>&, const std::vector<vk::PushConstantRange>&);
+
+	// merges the stages, sets missing between used ones get an empty layout
+	vk::PipelineLayout GetPipelineLayout(const std::vector<const ShaderReflection::Module*>&);
+
+	// set layouts behind a layout from GetPipelineLayout(modules), for descriptor allocation
+	bool GetSetLayouts(const std::vector<const ShaderReflection::Module*>&, std::vector<vk::DescriptorSetLayout>&);
+
+	uint32_t GetSetLayoutCount(void) const;
+	uint32_t GetPipelineLayoutCount(void) const;
+
+	void Destroy(void);
+};
@@ -0,0 +1,279 @@
+#include<mutex>
+#include<vector>
+#include<utility>
+
+#include"PipelineStatistics.h"
+#include"GpuTimeline.h"
+#include"GpuProfiler.h"
+#include"../Utilities/Settings.h"
+#include"../Utilities/Log.h"
+
+namespace
+{
+	using Bit = vk::QueryPipelineStatisticFlagBits;
+
+	// results come back in bit order
+	const vk::QueryPipelineStatisticFlags statistic_flags =
+		Bit::eInputAssemblyVertices |
+		Bit::eInputAssemblyPrimitives |
+		Bit::eVertexShaderInvocations |
+		Bit::eClippingInvocations |
+		Bit::eClippingPrimitives |
+		Bit::eFragmentShaderInvocations |
+		Bit::eComputeShaderInvocations;
+
+	const uint32_t statistic_count = 7;
+}
+
+class PipelineStatistics::Impl
+{
+public:
+	struct Slot
+	{
+		uint64_t					submit_value;
+		bool						pending;
+		std::vector<std::string>	passes;		// query index is the position
+	};
+
+	vk::Device							device_;
+	GpuTimeline&						timeline_;
+	GpuProfiler*						profiler_;
+	uint32_t							frame_count_;
+	uint32_t							max_passes_;
+	bool								enabled_;
+	bool								precise_;
+	vk::QueryPool						statistics_pool_;
+	vk::QueryPool						occlusion_pool_;
+
+	std::vector<Slot>					slots_;
+	uint32_t							current_;
+	bool								active_;		// queries of the current pass were begun
+
+	mutable std::mutex					mutex_;
+	std::vector<Counters>				counters_;
+
+	Impl(vk::Device device, GpuTimeline& timeline, const vk::PhysicalDeviceFeatures& features, uint32_t frame_count, bool enabled)
+		: device_(device)
+		, timeline_(timeline)
+		, profiler_(nullptr)
+		, frame_count_(frame_count)
+		, max_passes_(Settings::pipeline_statistics_max_passes<uint32_t>)
+		, enabled_(enabled)
+		, precise_(features.occlusionQueryPrecise != VK_FALSE)
+		, current_(0)
+		, active_(false)
+	{
+		if (!enabled_) return;
+
+		// the draw pass executes secondaries, they can only run under inherited queries
+		if (!features.pipelineStatisticsQuery || !features.inheritedQueries)
+		{
+			Log::Warning("Pipeline statistics need pipelineStatisticsQuery and inheritedQueries, disabled.");
+			enabled_ = false;
+		}
+	}
+
+	uint32_t GetBase(uint32_t slot) const
+	{
+		return slot * max_passes_;
+	}
+
+	void Resolve(uint32_t slot_index)
+	{
+		auto& slot = slots_[slot_index];
+		const auto count = static_cast<uint32_t>(slot.passes.size());
+		if (count == 0) return;
+
+		std::vector<uint64_t> statistics(count * statistic_count);
+		auto result = device_.getQueryPoolResults(statistics_pool_, GetBase(slot_index), count,
+			statistics.size() * sizeof(uint64_t), statistics.data(), statistic_count * sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+		if (result != vk::Result::eSuccess) return;
+
+		std::vector<uint64_t> samples(count);
+		result = device_.getQueryPoolResults(occlusion_pool_, GetBase(slot_index), count,
+			samples.size() * sizeof(uint64_t), samples.data(), sizeof(uint64_t), vk::QueryResultFlagBits::e64);
+		if (result != vk::Result::eSuccess) return;
+
+		std::vector<Counters> counters(count);
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			const uint64_t* values = &statistics[i * statistic_count];
+
+			auto& pass = counters[i];
+			pass.name = slot.passes[i];
+			pass.input_assembly_vertices = values[0];
+			pass.input_assembly_primitives = values[1];
+			pass.vertex_invocations = values[2];
+			pass.clipping_invocations = values[3];
+			pass.clipping_primitives = values[4];
+			pass.fragment_invocations = values[5];
+			pass.compute_invocations = values[6];
+			pass.samples_passed = samples[i];
+
+			if (profiler_)
+			{
+				profiler_->SetCounters(pass.name, {
+					{ "ia_vertices", pass.input_assembly_vertices },
+					{ "ia_primitives", pass.input_assembly_primitives },
+					{ "vs_invocations", pass.vertex_invocations },
+					{ "clip_invocations", pass.clipping_invocations },
+					{ "clip_primitives", pass.clipping_primitives },
+					{ "fs_invocations", pass.fragment_invocations },
+					{ "cs_invocations", pass.compute_invocations },
+					{ "samples_passed", pass.samples_passed },
+				});
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		counters_ = std::move(counters);
+	}
+};
+
+PipelineStatistics::PipelineStatistics(vk::Device device, GpuTimeline& timeline, const vk::PhysicalDeviceFeatures& features, uint32_t frame_count, bool enabled)
+	: impl_(std::make_unique<Impl>(device, timeline, features, frame_count, enabled)) {}
+
+PipelineStatistics::~PipelineStatistics() = default;
+
+bool PipelineStatistics::Initialize(void)
+{
+	if (!impl_->enabled_) return true;
+
+	impl_->slots_.resize(impl_->frame_count_);
+	for (auto& slot : impl_->slots_)
+	{
+		slot.submit_value = 0;
+		slot.pending = false;
+	}
+
+	auto const statistics_info = vk::QueryPoolCreateInfo()
+		.setQueryType(vk::QueryType::ePipelineStatistics)
+		.setQueryCount(impl_->max_passes_ * impl_->frame_count_)
+		.setPipelineStatistics(statistic_flags);
+
+	auto result = impl_->device_.createQueryPool(&statistics_info, nullptr, &impl_->statistics_pool_);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Pipeline statistics query pool cannot created.");
+		return false;
+	}
+
+	VulkanStats::CountCreated();
+
+	auto const occlusion_info = vk::QueryPoolCreateInfo()
+		.setQueryType(vk::QueryType::eOcclusion)
+		.setQueryCount(impl_->max_passes_ * impl_->frame_count_);
+
+	result = impl_->device_.createQueryPool(&occlusion_info, nullptr, &impl_->occlusion_pool_);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Occlusion query pool cannot created.");
+		return false;
+	}
+
+	VulkanStats::CountCreated();
+
+	Log::Info("Pipeline statistics create done. (precise occlusion = %d)", impl_->precise_ ? 1 : 0);
+
+	return true;
+}
+
+void PipelineStatistics::Destroy(void)
+{
+	if (impl_->statistics_pool_) impl_->device_.destroyQueryPool(impl_->statistics_pool_);
+	if (impl_->occlusion_pool_) impl_->device_.destroyQueryPool(impl_->occlusion_pool_);
+
+	impl_->statistics_pool_ = vk::QueryPool();
+	impl_->occlusion_pool_ = vk::QueryPool();
+	impl_->enabled_ = false;
+}
+
+void PipelineStatistics::SetProfiler(GpuProfiler* profiler)
+{
+	impl_->profiler_ = profiler;
+}
+
+void PipelineStatistics::BeginFrame(uint32_t frame_index, vk::CommandBuffer cmd_buffer)
+{
+	if (!impl_->enabled_) return;
+
+	impl_->current_ = frame_index % impl_->frame_count_;
+
+	auto& slot = impl_->slots_[impl_->current_];
+	if (slot.pending && impl_->timeline_.IsCompleted(slot.submit_value))
+	{
+		impl_->Resolve(impl_->current_);
+	}
+
+	slot.pending = false;
+	slot.passes.clear();
+	impl_->active_ = false;
+
+	const auto base = impl_->GetBase(impl_->current_);
+	cmd_buffer.resetQueryPool(impl_->statistics_pool_, base, impl_->max_passes_);
+	cmd_buffer.resetQueryPool(impl_->occlusion_pool_, base, impl_->max_passes_);
+}
+
+void PipelineStatistics::EndFrame(uint64_t submit_value)
+{
+	if (!impl_->enabled_) return;
+
+	auto& slot = impl_->slots_[impl_->current_];
+	slot.submit_value = submit_value;
+	slot.pending = submit_value != 0;
+}
+
+void PipelineStatistics::BeginPass(vk::CommandBuffer cmd_buffer, const std::string& name)
+{
+	if (!impl_->enabled_) return;
+
+	auto& slot = impl_->slots_[impl_->current_];
+	if (impl_->active_ || slot.passes.size() >= impl_->max_passes_) return;
+
+	const auto query = impl_->GetBase(impl_->current_) + static_cast<uint32_t>(slot.passes.size());
+
+	cmd_buffer.beginQuery(impl_->statistics_pool_, query, vk::QueryControlFlags());
+	cmd_buffer.beginQuery(impl_->occlusion_pool_, query, GetOcclusionFlags());
+
+	slot.passes.push_back(name);
+	impl_->active_ = true;
+}
+
+void PipelineStatistics::EndPass(vk::CommandBuffer cmd_buffer)
+{
+	if (!impl_->enabled_ || !impl_->active_) return;
+
+	auto& slot = impl_->slots_[impl_->current_];
+	const auto query = impl_->GetBase(impl_->current_) + static_cast<uint32_t>(slot.passes.size()) - 1;
+
+	cmd_buffer.endQuery(impl_->occlusion_pool_, query);
+	cmd_buffer.endQuery(impl_->statistics_pool_, query);
+
+	impl_->active_ = false;
+}
+
+bool PipelineStatistics::IsEnabled(void) const
+{
+	return impl_->enabled_;
+}
+
+vk::QueryPipelineStatisticFlags PipelineStatistics::GetInheritedStatistics(void) const
+{
+	return impl_->enabled_ ? statistic_flags : vk::QueryPipelineStatisticFlags();
+}
+
+bool PipelineStatistics::IsOcclusionInherited(void) const
+{
+	return impl_->enabled_;
+}
+
+vk::QueryControlFlags PipelineStatistics::GetOcclusionFlags(void) const
+{
+	return impl_->precise_ ? vk::QueryControlFlags(vk::QueryControlFlagBits::ePrecise) : vk::QueryControlFlags();
+}
+
+std::vector<PipelineStatistics::Counters> PipelineStatistics::GetCounters(void) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	return impl_->counters_;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include<memory>
+#include<string>
+#include<vector>
+#include"VulkanCommon.h"
+
+class GpuTimeline;
+class GpuProfiler;
+
+// Opt-in pipeline statistics and occlusion queries around every render graph pass.
+// Queries of one type cannot nest, so only passes are covered, not profiler scopes.
+// Results are read without waiting once the frame's slot comes around, and are
+// handed to the profiler as counters of the pass's scope.
+class PipelineStatistics
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	struct Counters
+	{
+		std::string	name;
+		uint64_t	input_assembly_vertices;
+		uint64_t	input_assembly_primitives;
+		uint64_t	vertex_invocations;
+		uint64_t	clipping_invocations;
+		uint64_t	clipping_primitives;
+		uint64_t	fragment_invocations;
+		uint64_t	compute_invocations;
+		uint64_t	samples_passed;		// exact only with occlusionQueryPrecise
+	};
+
+	PipelineStatistics() = delete;
+	// enabled : the opt-in, ignored when the device lacks the query features
+	PipelineStatistics(vk::Device, GpuTimeline&, const vk::PhysicalDeviceFeatures&, uint32_t frame_count, bool enabled);
+	~PipelineStatistics();
+
+	bool Initialize(void);
+	void Destroy(void);
+
+	// counters go to the scope of the same name
+	void SetProfiler(GpuProfiler*);
+
+	// outside a render pass, collects the slot's previous results and resets its queries
+	void BeginFrame(uint32_t frame_index, vk::CommandBuffer);
+	void EndFrame(uint64_t submit_value);
+
+	// around a pass, outside its render pass
+	void BeginPass(vk::CommandBuffer, const std::string& name);
+	void EndPass(vk::CommandBuffer);
+
+	bool IsEnabled(void) const;
+
+	// secondary command buffers executed inside a pass must inherit the active queries
+	vk::QueryPipelineStatisticFlags GetInheritedStatistics(void) const;
+	bool IsOcclusionInherited(void) const;
+	vk::QueryControlFlags GetOcclusionFlags(void) const;
+
+	// passes of the latest resolved frame
+	std::vector<Counters> GetCounters(void) const;
+};
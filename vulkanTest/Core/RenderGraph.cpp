@@ -0,0 +1,530 @@
+#include<algorithm>
+
+#include"RenderGraph.h"
+#include"TransientAllocator.h"
+#include"GpuProfiler.h"
+#include"PipelineStatistics.h"
+#include"../Utilities/Log.h"
+
+namespace
+{
+	struct UsageInfo
+	{
+		vk::PipelineStageFlags	stage;
+		vk::AccessFlags			read_access;
+		vk::AccessFlags			write_access;
+		vk::ImageLayout			layout;
+	};
+
+	UsageInfo GetUsageInfo(RenderGraph::Usage usage)
+	{
+		using Usage = RenderGraph::Usage;
+		using Stage = vk::PipelineStageFlagBits;
+		using AccessBit = vk::AccessFlagBits;
+
+		switch (usage)
+		{
+		case Usage::TRANSFER_SRC:
+			return { Stage::eTransfer, AccessBit::eTransferRead, vk::AccessFlags(), vk::ImageLayout::eTransferSrcOptimal };
+		case Usage::TRANSFER_DST:
+			return { Stage::eTransfer, vk::AccessFlags(), AccessBit::eTransferWrite, vk::ImageLayout::eTransferDstOptimal };
+		case Usage::COLOR_ATTACHMENT:
+			return { Stage::eColorAttachmentOutput, AccessBit::eColorAttachmentRead, AccessBit::eColorAttachmentWrite, vk::ImageLayout::eColorAttachmentOptimal };
+		case Usage::DEPTH_ATTACHMENT:
+			return { Stage::eEarlyFragmentTests | Stage::eLateFragmentTests, AccessBit::eDepthStencilAttachmentRead, AccessBit::eDepthStencilAttachmentWrite, vk::ImageLayout::eDepthStencilAttachmentOptimal };
+		case Usage::SAMPLED_FRAGMENT:
+			return { Stage::eFragmentShader, AccessBit::eShaderRead, vk::AccessFlags(), vk::ImageLayout::eShaderReadOnlyOptimal };
+		case Usage::SAMPLED_COMPUTE:
+			return { Stage::eComputeShader, AccessBit::eShaderRead, vk::AccessFlags(), vk::ImageLayout::eShaderReadOnlyOptimal };
+		case Usage::STORAGE_COMPUTE:
+			return { Stage::eComputeShader, AccessBit::eShaderRead, AccessBit::eShaderWrite, vk::ImageLayout::eGeneral };
+		case Usage::PRESENT:
+			// presentation engine synchronizes through the semaphore, no access
+			return { Stage::eBottomOfPipe, vk::AccessFlags(), vk::AccessFlags(), vk::ImageLayout::ePresentSrcKHR };
+		}
+
+		return { Stage::eAllCommands, AccessBit::eMemoryRead, AccessBit::eMemoryWrite, vk::ImageLayout::eGeneral };
+	}
+}
+
+class RenderGraph::Impl
+{
+public:
+	struct Resource
+	{
+		std::string					name;
+		vk::Image					image;
+		vk::ImageSubresourceRange	range;
+		vk::ImageLayout				initial_layout;
+		vk::PipelineStageFlags		initial_stage;
+		vk::AccessFlags				initial_access;
+		bool						exported;
+		Usage						final_usage;
+		vk::PipelineStageFlags		first_stage;
+
+		// transient images only
+		bool						transient;
+		vk::ImageCreateInfo			create_info;
+		vk::ImageView				view;
+		std::vector<ResourceHandle>	alias_predecessors;
+
+		// state while building barriers
+		vk::ImageLayout				layout;
+		vk::PipelineStageFlags		write_stage;		// last writer or layout transition
+		vk::AccessFlags				write_access;
+		vk::PipelineStageFlags		synced_stages;		// stages the last write is visible to
+		vk::PipelineStageFlags		read_stages;		// readers since the last write
+	};
+
+	struct Pass
+	{
+		std::string				name;
+		std::vector<Access>		reads;
+		std::vector<Access>		writes;
+		ExecuteFunction			execute;
+		bool					side_effects;
+		bool					live;
+	};
+
+	// one vkCmdPipelineBarrier per pass
+	struct BarrierBatch
+	{
+		vk::PipelineStageFlags				src_stage;
+		vk::PipelineStageFlags				dst_stage;
+		std::vector<vk::ImageMemoryBarrier>	image_barriers;
+	};
+
+	std::vector<Resource>		resources_;
+	std::vector<Pass>			passes_;
+	std::vector<uint32_t>		order_;				// live passes
+	std::vector<BarrierBatch>	batches_;			// [order_ index], last one is the export batch
+	TransientAllocator*			transients_;
+	GpuProfiler*				profiler_;
+	PipelineStatistics*			statistics_;
+	std::vector<TransientAllocator::Request>	transient_requests_;
+	std::vector<ResourceHandle>	transient_handles_;
+	uint32_t					barrier_count_;
+	uint32_t					alias_barrier_count_;
+	bool						compiled_;
+
+	Impl() : transients_(nullptr), profiler_(nullptr), statistics_(nullptr), barrier_count_(0), alias_barrier_count_(0), compiled_(false) {}
+
+	// adds the barriers an access needs to the batch and updates the tracked state
+	void Transition(Resource& resource, const UsageInfo& info, bool write, BarrierBatch& batch)
+	{
+		if (!resource.first_stage)
+		{
+			resource.first_stage = info.stage;
+		}
+
+		const bool layout_change = resource.layout != info.layout;
+		const bool unsynced_read = !write && resource.write_stage && (resource.synced_stages & info.stage) != info.stage;
+		const bool write_hazard = write && (resource.write_stage || resource.read_stages);
+
+		if (layout_change || unsynced_read || write_hazard)
+		{
+			vk::PipelineStageFlags src_stage = resource.write_stage | resource.read_stages;
+			vk::AccessFlags src_access = resource.write_access;
+			if (!src_stage && !resource.alias_predecessors.empty())
+			{
+				// aliased memory, the previous occupants are finished and their writes made available
+				for (auto predecessor : resource.alias_predecessors)
+				{
+					auto& previous = resources_[predecessor];
+					src_stage |= previous.write_stage | previous.read_stages;
+					src_access |= previous.write_access;
+				}
+				++alias_barrier_count_;
+			}
+			if (!src_stage)
+			{
+				// first use, chain to the acquire semaphore or the imported stage and access
+				src_stage = resource.initial_stage ? resource.initial_stage : info.stage;
+				src_access = resource.initial_access;
+			}
+
+			batch.src_stage |= src_stage;
+			batch.dst_stage |= info.stage;
+
+			// write after read only needs the execution dependency
+			const bool write_after_read_only = write_hazard && !layout_change && !resource.write_stage;
+
+			if (!write_after_read_only)
+			{
+				batch.image_barriers.push_back(vk::ImageMemoryBarrier()
+					.setSrcAccessMask(src_access)
+					.setDstAccessMask(write ? info.read_access | info.write_access : info.read_access)
+					.setOldLayout(resource.layout)
+					.setNewLayout(info.layout)
+					.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+					.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+					.setImage(resource.image)
+					.setSubresourceRange(resource.range));
+			}
+		}
+
+		if (write)
+		{
+			resource.write_stage = info.stage;
+			resource.write_access = info.write_access;
+			resource.synced_stages = vk::PipelineStageFlags();
+			resource.read_stages = vk::PipelineStageFlags();
+		}
+		else if (layout_change)
+		{
+			// the transition acts as a write later readers chain to
+			resource.write_stage = info.stage;
+			resource.write_access = vk::AccessFlags();
+			resource.synced_stages = info.stage;
+			resource.read_stages = info.stage;
+		}
+		else
+		{
+			if (unsynced_read) resource.synced_stages |= info.stage;
+			resource.read_stages |= info.stage;
+		}
+
+		resource.layout = info.layout;
+	}
+
+	void Cull(void)
+	{
+		std::vector<bool> needed(resources_.size(), false);
+		for (size_t i = 0; i < resources_.size(); ++i)
+		{
+			needed[i] = resources_[i].exported;
+		}
+
+		// walk back, a pass lives if it writes something a live pass or the output needs
+		for (size_t i = passes_.size(); i-- > 0;)
+		{
+			auto& pass = passes_[i];
+
+			pass.live = pass.side_effects;
+			for (auto& write : pass.writes)
+			{
+				if (needed[write.resource]) pass.live = true;
+			}
+
+			if (!pass.live) continue;
+
+			for (auto& read : pass.reads)
+			{
+				needed[read.resource] = true;
+			}
+		}
+	}
+
+	// lifetimes over the live order, then images from the allocator
+	bool PlaceTransients(void)
+	{
+		transient_requests_.clear();
+		transient_handles_.clear();
+
+		std::vector<uint32_t> request_index(resources_.size(), TransientAllocator::no_predecessor);
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(order_.size()); ++i)
+		{
+			auto& pass = passes_[order_[i]];
+
+			auto touch = [&](const Access& access)
+			{
+				if (!resources_[access.resource].transient) return;
+
+				auto& index = request_index[access.resource];
+				if (index == TransientAllocator::no_predecessor)
+				{
+					index = static_cast<uint32_t>(transient_requests_.size());
+					transient_requests_.push_back({ resources_[access.resource].create_info, i, i });
+					transient_handles_.push_back(access.resource);
+				}
+				transient_requests_[index].last_pass = i;
+			};
+
+			for (auto& read : pass.reads) touch(read);
+			for (auto& write : pass.writes) touch(write);
+		}
+
+		for (auto& resource : resources_)
+		{
+			resource.alias_predecessors.clear();
+			if (resource.transient)
+			{
+				resource.image = vk::Image();
+				resource.view = vk::ImageView();
+			}
+		}
+
+		if (transient_requests_.empty()) return true;
+
+		if (!transients_)
+		{
+			Log::Error("Render graph has transient images but no allocator.");
+			return false;
+		}
+
+		if (!transients_->Realize(transient_requests_)) return false;
+
+		for (uint32_t i = 0; i < static_cast<uint32_t>(transient_handles_.size()); ++i)
+		{
+			auto& resource = resources_[transient_handles_[i]];
+			resource.image = transients_->GetImage(i);
+			resource.view = transients_->GetImageView(i);
+
+			for (auto predecessor : transients_->GetAliasPredecessors(i))
+			{
+				resource.alias_predecessors.push_back(transient_handles_[predecessor]);
+			}
+		}
+
+		return true;
+	}
+};
+
+RenderGraph::RenderGraph() : impl_(std::make_unique<Impl>()) {}
+
+RenderGraph::~RenderGraph() = default;
+
+void RenderGraph::Reset(void)
+{
+	impl_->resources_.clear();
+	impl_->passes_.clear();
+	impl_->order_.clear();
+	impl_->barrier_count_ = 0;
+	impl_->compiled_ = false;
+}
+
+RenderGraph::ResourceHandle RenderGraph::ImportImage(
+	const std::string& name,
+	vk::Image image,
+	vk::ImageSubresourceRange range,
+	vk::ImageLayout initial_layout,
+	vk::PipelineStageFlags initial_stage,
+	vk::AccessFlags initial_access,
+	bool exported,
+	Usage final_usage)
+{
+	Impl::Resource resource;
+	resource.name = name;
+	resource.image = image;
+	resource.range = range;
+	resource.initial_layout = initial_layout;
+	resource.initial_stage = initial_stage;
+	resource.initial_access = initial_access;
+	resource.exported = exported;
+	resource.final_usage = final_usage;
+	resource.transient = false;
+
+	impl_->resources_.push_back(resource);
+
+	return static_cast<ResourceHandle>(impl_->resources_.size() - 1);
+}
+
+void RenderGraph::AddPass(
+	const std::string& name,
+	std::vector<Access> reads,
+	std::vector<Access> writes,
+	ExecuteFunction execute,
+	bool side_effects)
+{
+	impl_->passes_.push_back({ name, std::move(reads), std::move(writes), std::move(execute), side_effects, false });
+}
+
+RenderGraph::ResourceHandle RenderGraph::CreateImage(const std::string& name, const vk::ImageCreateInfo& info)
+{
+	Impl::Resource resource;
+	resource.name = name;
+	resource.range = vk::ImageSubresourceRange(TransientAllocator::GetAspect(info.format), 0, info.mipLevels, 0, info.arrayLayers);
+	resource.initial_layout = vk::ImageLayout::eUndefined;
+	resource.exported = false;
+	resource.final_usage = Usage::PRESENT;
+	resource.transient = true;
+	resource.create_info = info;
+	resource.create_info.initialLayout = vk::ImageLayout::eUndefined;
+
+	impl_->resources_.push_back(resource);
+
+	return static_cast<ResourceHandle>(impl_->resources_.size() - 1);
+}
+
+void RenderGraph::SetTransientAllocator(TransientAllocator* allocator)
+{
+	impl_->transients_ = allocator;
+}
+
+void RenderGraph::SetProfiler(GpuProfiler* profiler)
+{
+	impl_->profiler_ = profiler;
+}
+
+void RenderGraph::SetPipelineStatistics(PipelineStatistics* statistics)
+{
+	impl_->statistics_ = statistics;
+}
+
+bool RenderGraph::Compile(void)
+{
+	// culling indexes by handle
+	for (auto& pass : impl_->passes_)
+	{
+		for (auto& read : pass.reads)
+		{
+			if (read.resource >= impl_->resources_.size())
+			{
+				Log::Error("Render graph pass " + pass.name + " reads an unknown resource.");
+				return false;
+			}
+		}
+
+		for (auto& write : pass.writes)
+		{
+			if (write.resource >= impl_->resources_.size())
+			{
+				Log::Error("Render graph pass " + pass.name + " writes an unknown resource.");
+				return false;
+			}
+		}
+	}
+
+	impl_->Cull();
+
+	// a pass can only read what an earlier pass wrote, declaration order is already dependency order
+	impl_->order_.clear();
+	for (uint32_t i = 0; i < static_cast<uint32_t>(impl_->passes_.size()); ++i)
+	{
+		if (impl_->passes_[i].live) impl_->order_.push_back(i);
+	}
+
+	if (!impl_->PlaceTransients()) return false;
+
+	for (auto& resource : impl_->resources_)
+	{
+		resource.layout = resource.initial_layout;
+		resource.write_stage = vk::PipelineStageFlags();
+		resource.write_access = vk::AccessFlags();
+		resource.synced_stages = vk::PipelineStageFlags();
+		resource.read_stages = vk::PipelineStageFlags();
+		resource.first_stage = vk::PipelineStageFlags();
+	}
+
+	impl_->alias_barrier_count_ = 0;
+	impl_->batches_.resize(impl_->order_.size() + 1);
+	for (auto& batch : impl_->batches_)
+	{
+		batch.src_stage = vk::PipelineStageFlags();
+		batch.dst_stage = vk::PipelineStageFlags();
+		batch.image_barriers.clear();
+	}
+
+	for (size_t i = 0; i < impl_->order_.size(); ++i)
+	{
+		auto& pass = impl_->passes_[impl_->order_[i]];
+		auto& batch = impl_->batches_[i];
+
+		for (auto& read : pass.reads)
+		{
+			impl_->Transition(impl_->resources_[read.resource], GetUsageInfo(read.usage), false, batch);
+		}
+
+		for (auto& write : pass.writes)
+		{
+			impl_->Transition(impl_->resources_[write.resource], GetUsageInfo(write.usage), true, batch);
+		}
+	}
+
+	// exported images leave in their final layout
+	auto& export_batch = impl_->batches_.back();
+	for (auto& resource : impl_->resources_)
+	{
+		if (!resource.exported) continue;
+
+		auto info = GetUsageInfo(resource.final_usage);
+		impl_->Transition(resource, info, false, export_batch);
+	}
+
+	impl_->barrier_count_ = 0;
+	for (auto& batch : impl_->batches_)
+	{
+		impl_->barrier_count_ += static_cast<uint32_t>(batch.image_barriers.size());
+	}
+
+	impl_->compiled_ = true;
+
+	return true;
+}
+
+void RenderGraph::Execute(vk::CommandBuffer cmd_buffer)
+{
+	if (!impl_->compiled_ && !Compile()) return;
+
+	auto flush = [&](const Impl::BarrierBatch& batch)
+	{
+		if (!batch.src_stage) return;
+
+		cmd_buffer.pipelineBarrier(
+			batch.src_stage,
+			batch.dst_stage,
+			vk::DependencyFlags(),
+			nullptr, nullptr, batch.image_barriers);
+	};
+
+	for (size_t i = 0; i < impl_->order_.size(); ++i)
+	{
+		flush(impl_->batches_[i]);
+
+		auto& pass = impl_->passes_[impl_->order_[i]];
+
+		GpuProfiler::Scope scope(impl_->profiler_, cmd_buffer, pass.name);
+		if (impl_->statistics_) impl_->statistics_->BeginPass(cmd_buffer, pass.name);
+
+		if (pass.execute) pass.execute(cmd_buffer);
+
+		if (impl_->statistics_) impl_->statistics_->EndPass(cmd_buffer);
+	}
+
+	flush(impl_->batches_.back());
+}
+
+vk::PipelineStageFlags RenderGraph::GetFirstStage(ResourceHandle handle) const
+{
+	if (handle >= impl_->resources_.size() || !impl_->resources_[handle].first_stage)
+	{
+		return vk::PipelineStageFlagBits::eTopOfPipe;
+	}
+
+	return impl_->resources_[handle].first_stage;
+}
+
+vk::Image RenderGraph::GetImage(ResourceHandle handle) const
+{
+	if (handle >= impl_->resources_.size()) return vk::Image();
+
+	return impl_->resources_[handle].image;
+}
+
+vk::ImageView RenderGraph::GetImageView(ResourceHandle handle) const
+{
+	if (handle >= impl_->resources_.size()) return vk::ImageView();
+
+	return impl_->resources_[handle].view;
+}
+
+uint32_t RenderGraph::GetPassCount(void) const
+{
+	return static_cast<uint32_t>(impl_->order_.size());
+}
+
+uint32_t RenderGraph::GetCulledPassCount(void) const
+{
+	return static_cast<uint32_t>(impl_->passes_.size() - impl_->order_.size());
+}
+
+uint32_t RenderGraph::GetBarrierCount(void) const
+{
+	return impl_->barrier_count_;
+}
+
+uint32_t RenderGraph::GetAliasBarrierCount(void) const
+{
+	return impl_->alias_barrier_count_;
+}
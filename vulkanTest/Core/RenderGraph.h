@@ -0,0 +1,100 @@
+#pragma once
+
+#include<memory>
+#include<string>
+#include<vector>
+#include<functional>
+#include"VulkanCommon.h"
+
+class TransientAllocator;
+class GpuProfiler;
+class PipelineStatistics;
+
+// Frame graph built every frame.
+// Passes declare the images they read and write, Compile() culls passes that
+// do not reach an exported image and derives batched barriers with exact stage,
+// access and layout from the declared usages.
+// Images created by the graph are transient, their memory is aliased between
+// passes whose lifetimes do not overlap.
+class RenderGraph
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	enum class Usage
+	{
+		TRANSFER_SRC,
+		TRANSFER_DST,
+		COLOR_ATTACHMENT,
+		DEPTH_ATTACHMENT,
+		SAMPLED_FRAGMENT,
+		SAMPLED_COMPUTE,
+		STORAGE_COMPUTE,
+		PRESENT,
+	};
+
+	using ResourceHandle = uint32_t;
+	using ExecuteFunction = std::function<void(vk::CommandBuffer)>;
+
+	struct Access
+	{
+		ResourceHandle	resource;
+		Usage			usage;
+	};
+
+	RenderGraph();
+	~RenderGraph();
+
+	// clears passes and resources, keeps the storage
+	void Reset(void);
+
+	// initial_stage empty : first barrier chains to a semaphore waited at GetFirstStage()
+	// initial_access : writes of earlier frames the first barrier makes available, for images kept across frames
+	// exported images are transitioned to final_usage at the end, others keep their last layout
+	ResourceHandle ImportImage(
+		const std::string& name,
+		vk::Image image,
+		vk::ImageSubresourceRange range,
+		vk::ImageLayout initial_layout,
+		vk::PipelineStageFlags initial_stage,
+		vk::AccessFlags initial_access,
+		bool exported,
+		Usage final_usage = Usage::PRESENT);
+
+	// lives only inside the frame, contents start undefined at the first use
+	// image and view are valid after Compile()
+	ResourceHandle CreateImage(const std::string& name, const vk::ImageCreateInfo& info);
+
+	// side_effects keeps the pass even if nothing exported depends on it
+	void AddPass(
+		const std::string& name,
+		std::vector<Access> reads,
+		std::vector<Access> writes,
+		ExecuteFunction execute,
+		bool side_effects = false);
+
+	// places transient images, must be set before compiling a graph that creates any
+	void SetTransientAllocator(TransientAllocator*);
+
+	// times every executed pass under its name, null : off
+	void SetProfiler(GpuProfiler*);
+
+	// pipeline statistics and occlusion queries around every executed pass, null : off
+	void SetPipelineStatistics(PipelineStatistics*);
+
+	bool Compile(void);
+	void Execute(vk::CommandBuffer);
+
+	vk::Image GetImage(ResourceHandle) const;
+	vk::ImageView GetImageView(ResourceHandle) const;
+
+	// stage of the first access, for the semaphore wait of an imported image
+	vk::PipelineStageFlags GetFirstStage(ResourceHandle) const;
+
+	uint32_t GetPassCount(void) const;
+	uint32_t GetCulledPassCount(void) const;
+	uint32_t GetBarrierCount(void) const;
+	uint32_t GetAliasBarrierCount(void) const;
+};
@@ -0,0 +1,212 @@
+#include<map>
+#include<mutex>
+#include<vector>
+#include<cstring>
+#include<cstdlib>
+#include<sstream>
+#include<unordered_map>
+
+#include"ShaderModuleCache.h"
+#include"../Utilities/Utils.h"
+#include"../Utilities/Log.h"
+
+class ShaderModuleCache::Impl
+{
+public:
+	struct Entry
+	{
+		vk::ShaderModule			module;
+		std::vector<uint32_t>		code;			// kept to rule out hash collisions
+		ShaderReflection::Module	reflection;
+		bool						reflected;
+		uint32_t					reference_count;
+	};
+
+	vk::Device									device_;
+	std::string									index_path_;
+	mutable std::mutex							mutex_;
+	std::unordered_map<uint64_t, Entry>			entries_;
+	std::map<uint64_t, std::string>				index_;			// hash -> source, includes earlier runs
+	uint32_t									deduplicated_count_;
+
+	Impl(vk::Device device, const std::string& index_path)
+		: device_(device)
+		, index_path_(index_path)
+		, deduplicated_count_(0)
+	{
+		LoadIndex();
+	}
+
+	// "hash size source" per line
+	void LoadIndex(void)
+	{
+		std::vector<char> data;
+		if (!FileUtils::ReadBinary(index_path_, data)) return;
+
+		std::istringstream stream(std::string(data.begin(), data.end()));
+		std::string line;
+		while (std::getline(stream, line))
+		{
+			auto separator = line.find(' ');
+			if (separator == std::string::npos) continue;
+
+			uint64_t hash = std::strtoull(line.substr(0, separator).c_str(), nullptr, 16);
+			if (hash) index_[hash] = line.substr(separator + 1);
+		}
+	}
+};
+
+ShaderModuleCache::ShaderModuleCache(vk::Device device, const std::string& index_path)
+	: impl_(std::make_unique<Impl>(device, index_path)) {}
+
+ShaderModuleCache::~ShaderModuleCache() = default;
+
+vk::ShaderModule ShaderModuleCache::Acquire(const uint32_t* code, size_t size, const std::string& source, uint64_t* hash)
+{
+	if (!code || size < 4 || size % 4 != 0)
+	{
+		Log::Error("Shader " + source + " is not SPIR-V.");
+		return vk::ShaderModule();
+	}
+
+	const uint64_t key = HashUtils::Hash64(code, size);
+	if (hash) *hash = key;
+
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	auto it = impl_->entries_.find(key);
+	if (it != impl_->entries_.end())
+	{
+		auto& entry = it->second;
+		if (entry.code.size() * 4 != size || std::memcmp(entry.code.data(), code, size) != 0)
+		{
+			Log::Error("Shader " + source + " hash collides with another module.");
+			return vk::ShaderModule();
+		}
+
+		++entry.reference_count;
+		++impl_->deduplicated_count_;
+		return entry.module;
+	}
+
+	auto const module_info = vk::ShaderModuleCreateInfo()
+		.setCodeSize(size)
+		.setPCode(code);
+
+	Impl::Entry entry;
+	auto result = impl_->device_.createShaderModule(&module_info, nullptr, &entry.module);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Shader module " + source + " cannot created.");
+		return vk::ShaderModule();
+	}
+
+	VulkanStats::CountCreated();
+
+	entry.code.assign(code, code + size / 4);
+	entry.reflected = false;
+	entry.reference_count = 1;
+
+	auto module = entry.module;
+	impl_->entries_.emplace(key, std::move(entry));
+
+	std::ostringstream description;
+	description << size << " " << source;
+	impl_->index_[key] = description.str();
+
+	return module;
+}
+
+vk::ShaderModule ShaderModuleCache::AcquireFile(const std::string& path, uint64_t* hash)
+{
+	std::vector<char> data;
+	if (!FileUtils::ReadBinary(path, data))
+	{
+		Log::Error("Shader file " + path + " cannot read.");
+		return vk::ShaderModule();
+	}
+
+	// vector storage is suitably aligned for words
+	std::vector<uint32_t> code((data.size() + 3) / 4);
+	std::memcpy(code.data(), data.data(), data.size());
+
+	return Acquire(code.data(), data.size(), path, hash);
+}
+
+void ShaderModuleCache::Release(uint64_t hash)
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	auto it = impl_->entries_.find(hash);
+	if (it == impl_->entries_.end()) return;
+
+	if (--it->second.reference_count > 0) return;
+
+	impl_->device_.destroyShaderModule(it->second.module);
+	impl_->entries_.erase(it);
+}
+
+const ShaderReflection::Module* ShaderModuleCache::GetReflection(uint64_t hash) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	auto it = impl_->entries_.find(hash);
+	if (it == impl_->entries_.end()) return nullptr;
+
+	auto& entry = it->second;
+	if (!entry.reflected)
+	{
+		if (!ShaderReflection::Reflect(entry.code.data(), entry.code.size(), entry.reflection)) return nullptr;
+		entry.reflected = true;
+	}
+
+	return &entry.reflection;
+}
+
+uint32_t ShaderModuleCache::GetModuleCount(void) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	return static_cast<uint32_t>(impl_->entries_.size());
+}
+
+uint32_t ShaderModuleCache::GetDeduplicatedCount(void) const
+{
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+	return impl_->deduplicated_count_;
+}
+
+bool ShaderModuleCache::SaveIndex(void) const
+{
+	std::ostringstream stream;
+	{
+		std::lock_guard<std::mutex> lock(impl_->mutex_);
+		if (impl_->index_.empty()) return true;
+
+		for (auto& entry : impl_->index_)
+		{
+			stream << std::hex << entry.first << std::dec << " " << entry.second << "\n";
+		}
+	}
+
+	auto data = stream.str();
+	if (!FileUtils::WriteBinaryAtomic(impl_->index_path_, data.data(), data.size()))
+	{
+		Log::Error("Shader index cannot written.");
+		return false;
+	}
+
+	return true;
+}
+
+void ShaderModuleCache::Destroy(void)
+{
+	SaveIndex();
+
+	std::lock_guard<std::mutex> lock(impl_->mutex_);
+
+	for (auto& entry : impl_->entries_)
+	{
+		impl_->device_.destroyShaderModule(entry.second.module);
+	}
+	impl_->entries_.clear();
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include<memory>
+#include<string>
+#include"VulkanCommon.h"
+#include"ShaderReflection.h"
+
+// Content addressed vk::ShaderModule registry.
+// Byte-identical SPIR-V is created once and reference counted, the hash to source
+// index is kept on disk for tooling and merged across runs.
+class ShaderModuleCache
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	ShaderModuleCache() = delete;
+	ShaderModuleCache(vk::Device, const std::string& index_path);
+	~ShaderModuleCache();
+
+	// thread safe, adds a reference, null on failure
+	vk::ShaderModule Acquire(const uint32_t* code, size_t size, const std::string& source, uint64_t* hash = nullptr);
+	vk::ShaderModule AcquireFile(const std::string& path, uint64_t* hash = nullptr);
+
+	// destroyed with the last reference, pipelines using it must already be created
+	void Release(uint64_t hash);
+
+	// reflected once per unique module, valid while referenced
+	const ShaderReflection::Module* GetReflection(uint64_t hash) const;
+
+	uint32_t GetModuleCount(void) const;
+	uint32_t GetDeduplicatedCount(void) const;		// acquires served without a new module
+
+	bool SaveIndex(void) const;
+	void Destroy(void);
+};
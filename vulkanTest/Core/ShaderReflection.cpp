@@ -0,0 +1,503 @@
+#include<map>
+#include<cstring>
+#include<algorithm>
+#include<unordered_map>
+
+#include<vulkan/spirv.hpp>
+
+#include"ShaderReflection.h"
+#include"../Utilities/Log.h"
+
+namespace
+{
+	struct TypeInfo
+	{
+		spv::Op					op = spv::OpNop;
+		uint32_t				width = 0;			// int, float
+		bool					is_signed = false;
+		uint32_t				element = 0;		// vector, matrix, array, pointer, sampled image
+		uint32_t				count = 0;			// vector components, matrix columns, array length (0 runtime)
+		uint32_t				dim = 0;			// image
+		uint32_t				sampled = 0;		// image, 1 sampled 2 storage
+		uint32_t				storage_class = 0;	// pointer
+		std::vector<uint32_t>	members;			// struct
+	};
+
+	struct Decorations
+	{
+		uint32_t	set = 0;
+		uint32_t	binding = 0;
+		uint32_t	location = 0;
+		uint32_t	spec_id = 0;
+		uint32_t	array_stride = 0;
+		bool		has_location = false;
+		bool		has_spec_id = false;
+		bool		built_in = false;
+		bool		block = false;
+		bool		buffer_block = false;
+		std::vector<uint32_t>	member_offsets;
+		std::vector<uint32_t>	member_matrix_strides;
+	};
+
+	struct Variable
+	{
+		uint32_t	id;
+		uint32_t	type;
+		uint32_t	storage_class;
+	};
+
+	class Parser
+	{
+	public:
+		std::unordered_map<uint32_t, TypeInfo>		types_;
+		std::unordered_map<uint32_t, Decorations>	decorations_;
+		std::unordered_map<uint32_t, std::string>	names_;
+		std::unordered_map<uint32_t, uint32_t>		constants_;		// id -> low word
+		std::vector<Variable>						variables_;
+		std::vector<std::pair<uint32_t, uint32_t>>	spec_constants_;	// id, type
+
+		static std::string ReadString(const uint32_t* words, uint32_t word_count)
+		{
+			auto chars = reinterpret_cast<const char*>(words);
+			return std::string(chars, strnlen(chars, word_count * 4));
+		}
+
+		uint32_t GetSize(uint32_t type_id, uint32_t matrix_stride = 0) const
+		{
+			auto it = types_.find(type_id);
+			if (it == types_.end()) return 0;
+
+			auto& type = it->second;
+			switch (type.op)
+			{
+			case spv::OpTypeBool:
+				return 4;
+			case spv::OpTypeInt:
+			case spv::OpTypeFloat:
+				return type.width / 8;
+			case spv::OpTypeVector:
+				return GetSize(type.element) * type.count;
+			case spv::OpTypeMatrix:
+				return matrix_stride ? matrix_stride * type.count : GetSize(type.element) * type.count;
+			case spv::OpTypeArray:
+			{
+				auto decoration = decorations_.find(type_id);
+				auto stride = decoration != decorations_.end() && decoration->second.array_stride ? decoration->second.array_stride : GetSize(type.element);
+				return stride * type.count;
+			}
+			case spv::OpTypeStruct:
+			{
+				auto decoration = decorations_.find(type_id);
+				uint32_t size = 0;
+				for (uint32_t i = 0; i < type.members.size(); ++i)
+				{
+					uint32_t offset = 0;
+					uint32_t stride = 0;
+					if (decoration != decorations_.end())
+					{
+						if (i < decoration->second.member_offsets.size()) offset = decoration->second.member_offsets[i];
+						if (i < decoration->second.member_matrix_strides.size()) stride = decoration->second.member_matrix_strides[i];
+					}
+					size = std::max(size, offset + GetSize(type.members[i], stride));
+				}
+				return size;
+			}
+			default:
+				return 0;
+			}
+		}
+
+		vk::Format GetFormat(uint32_t type_id) const
+		{
+			auto it = types_.find(type_id);
+			if (it == types_.end()) return vk::Format::eUndefined;
+
+			auto& type = it->second;
+			uint32_t components = 1;
+			const TypeInfo* scalar = &type;
+
+			if (type.op == spv::OpTypeVector)
+			{
+				components = type.count;
+				auto element = types_.find(type.element);
+				if (element == types_.end()) return vk::Format::eUndefined;
+				scalar = &element->second;
+			}
+
+			if (scalar->width != 32) return vk::Format::eUndefined;
+
+			static const vk::Format float_formats[] = { vk::Format::eR32Sfloat, vk::Format::eR32G32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32A32Sfloat };
+			static const vk::Format sint_formats[] = { vk::Format::eR32Sint, vk::Format::eR32G32Sint, vk::Format::eR32G32B32Sint, vk::Format::eR32G32B32A32Sint };
+			static const vk::Format uint_formats[] = { vk::Format::eR32Uint, vk::Format::eR32G32Uint, vk::Format::eR32G32B32Uint, vk::Format::eR32G32B32A32Uint };
+
+			if (components < 1 || components > 4) return vk::Format::eUndefined;
+
+			if (scalar->op == spv::OpTypeFloat) return float_formats[components - 1];
+			if (scalar->op == spv::OpTypeInt) return scalar->is_signed ? sint_formats[components - 1] : uint_formats[components - 1];
+
+			return vk::Format::eUndefined;
+		}
+
+		// descriptor type of the pointee, arrays give the count
+		bool GetDescriptor(const Variable& variable, vk::DescriptorType& descriptor_type, uint32_t& count) const
+		{
+			auto pointer = types_.find(variable.type);
+			if (pointer == types_.end()) return false;
+
+			uint32_t type_id = pointer->second.element;
+			count = 1;
+
+			auto type = types_.find(type_id);
+			while (type != types_.end() && (type->second.op == spv::OpTypeArray || type->second.op == spv::OpTypeRuntimeArray))
+			{
+				count = type->second.op == spv::OpTypeArray ? count * type->second.count : 0;
+				type_id = type->second.element;
+				type = types_.find(type_id);
+			}
+			if (type == types_.end()) return false;
+
+			auto& info = type->second;
+			switch (info.op)
+			{
+			case spv::OpTypeSampler:
+				descriptor_type = vk::DescriptorType::eSampler;
+				return true;
+			case spv::OpTypeSampledImage:
+				descriptor_type = vk::DescriptorType::eCombinedImageSampler;
+				return true;
+			case spv::OpTypeImage:
+				if (info.dim == spv::DimBuffer)
+				{
+					descriptor_type = info.sampled == 2 ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eUniformTexelBuffer;
+				}
+				else if (info.dim == spv::DimSubpassData)
+				{
+					descriptor_type = vk::DescriptorType::eInputAttachment;
+				}
+				else
+				{
+					descriptor_type = info.sampled == 2 ? vk::DescriptorType::eStorageImage : vk::DescriptorType::eSampledImage;
+				}
+				return true;
+			case spv::OpTypeStruct:
+			{
+				auto decoration = decorations_.find(type_id);
+				const bool buffer_block = decoration != decorations_.end() && decoration->second.buffer_block;
+
+				if (variable.storage_class == spv::StorageClassStorageBuffer || buffer_block)
+				{
+					descriptor_type = vk::DescriptorType::eStorageBuffer;
+				}
+				else
+				{
+					descriptor_type = vk::DescriptorType::eUniformBuffer;
+				}
+				return true;
+			}
+			default:
+				return false;
+			}
+		}
+	};
+
+	vk::ShaderStageFlagBits GetStage(uint32_t execution_model)
+	{
+		switch (execution_model)
+		{
+		case spv::ExecutionModelVertex:					return vk::ShaderStageFlagBits::eVertex;
+		case spv::ExecutionModelTessellationControl:	return vk::ShaderStageFlagBits::eTessellationControl;
+		case spv::ExecutionModelTessellationEvaluation:	return vk::ShaderStageFlagBits::eTessellationEvaluation;
+		case spv::ExecutionModelGeometry:				return vk::ShaderStageFlagBits::eGeometry;
+		case spv::ExecutionModelFragment:				return vk::ShaderStageFlagBits::eFragment;
+		case spv::ExecutionModelGLCompute:				return vk::ShaderStageFlagBits::eCompute;
+		default:										return vk::ShaderStageFlagBits::eAll;
+		}
+	}
+}
+
+bool ShaderReflection::Reflect(const uint32_t* code, size_t word_count, Module& module)
+{
+	module = Module();
+
+	if (word_count < 5 || code[0] != spv::MagicNumber)
+	{
+		Log::Error("Shader module is not SPIR-V.");
+		return false;
+	}
+
+	Parser parser;
+	uint32_t execution_model = 0xffffffff;
+
+	for (size_t offset = 5; offset < word_count;)
+	{
+		const uint32_t op_word_count = code[offset] >> spv::WordCountShift;
+		const auto op = static_cast<spv::Op>(code[offset] & spv::OpCodeMask);
+		const uint32_t* args = code + offset + 1;
+
+		if (op_word_count == 0 || offset + op_word_count > word_count)
+		{
+			Log::Error("Shader module is truncated.");
+			return false;
+		}
+
+		switch (op)
+		{
+		case spv::OpEntryPoint:
+			// first entry point only
+			if (execution_model == 0xffffffff)
+			{
+				execution_model = args[0];
+				module.entry_point = Parser::ReadString(args + 2, op_word_count - 3);
+			}
+			break;
+		case spv::OpName:
+			parser.names_[args[0]] = Parser::ReadString(args + 1, op_word_count - 2);
+			break;
+		case spv::OpDecorate:
+		{
+			auto& decoration = parser.decorations_[args[0]];
+			switch (args[1])
+			{
+			case spv::DecorationDescriptorSet:	decoration.set = args[2]; break;
+			case spv::DecorationBinding:		decoration.binding = args[2]; break;
+			case spv::DecorationLocation:		decoration.location = args[2]; decoration.has_location = true; break;
+			case spv::DecorationSpecId:			decoration.spec_id = args[2]; decoration.has_spec_id = true; break;
+			case spv::DecorationArrayStride:	decoration.array_stride = args[2]; break;
+			case spv::DecorationBuiltIn:		decoration.built_in = true; break;
+			case spv::DecorationBlock:			decoration.block = true; break;
+			case spv::DecorationBufferBlock:	decoration.buffer_block = true; break;
+			default: break;
+			}
+			break;
+		}
+		case spv::OpMemberDecorate:
+		{
+			auto& decoration = parser.decorations_[args[0]];
+			const uint32_t member = args[1];
+			if (args[2] == spv::DecorationOffset)
+			{
+				if (decoration.member_offsets.size() <= member) decoration.member_offsets.resize(member + 1, 0);
+				decoration.member_offsets[member] = args[3];
+			}
+			else if (args[2] == spv::DecorationMatrixStride)
+			{
+				if (decoration.member_matrix_strides.size() <= member) decoration.member_matrix_strides.resize(member + 1, 0);
+				decoration.member_matrix_strides[member] = args[3];
+			}
+			else if (args[2] == spv::DecorationBuiltIn)
+			{
+				decoration.built_in = true;
+			}
+			break;
+		}
+		case spv::OpTypeBool:
+		case spv::OpTypeSampler:
+			parser.types_[args[0]].op = op;
+			break;
+		case spv::OpTypeInt:
+		{
+			auto& type = parser.types_[args[0]];
+			type.op = op;
+			type.width = args[1];
+			type.is_signed = args[2] != 0;
+			break;
+		}
+		case spv::OpTypeFloat:
+		{
+			auto& type = parser.types_[args[0]];
+			type.op = op;
+			type.width = args[1];
+			break;
+		}
+		case spv::OpTypeVector:
+		case spv::OpTypeMatrix:
+		{
+			auto& type = parser.types_[args[0]];
+			type.op = op;
+			type.element = args[1];
+			type.count = args[2];
+			break;
+		}
+		case spv::OpTypeImage:
+		{
+			auto& type = parser.types_[args[0]];
+			type.op = op;
+			type.dim = args[2];
+			type.sampled = args[6];
+			break;
+		}
+		case spv::OpTypeSampledImage:
+		case spv::OpTypeRuntimeArray:
+		{
+			auto& type = parser.types_[args[0]];
+			type.op = op;
+			type.element = args[1];
+			break;
+		}
+		case spv::OpTypeArray:
+		{
+			auto& type = parser.types_[args[0]];
+			type.op = op;
+			type.element = args[1];
+			auto length = parser.constants_.find(args[2]);
+			type.count = length != parser.constants_.end() ? length->second : 1;
+			break;
+		}
+		case spv::OpTypeStruct:
+		{
+			auto& type = parser.types_[args[0]];
+			type.op = op;
+			type.members.assign(args + 1, args + op_word_count - 1);
+			break;
+		}
+		case spv::OpTypePointer:
+		{
+			auto& type = parser.types_[args[0]];
+			type.op = op;
+			type.storage_class = args[1];
+			type.element = args[2];
+			break;
+		}
+		case spv::OpConstant:
+			parser.constants_[args[1]] = args[2];
+			break;
+		case spv::OpSpecConstant:
+			// default value stands in for array lengths
+			parser.constants_[args[1]] = args[2];
+			parser.spec_constants_.push_back({ args[1], args[0] });
+			break;
+		case spv::OpSpecConstantTrue:
+		case spv::OpSpecConstantFalse:
+			parser.spec_constants_.push_back({ args[1], args[0] });
+			break;
+		case spv::OpVariable:
+			parser.variables_.push_back({ args[1], args[0], args[2] });
+			break;
+		default:
+			break;
+		}
+
+		offset += op_word_count;
+	}
+
+	if (execution_model == 0xffffffff)
+	{
+		Log::Error("Shader module has no entry point.");
+		return false;
+	}
+
+	module.stage = GetStage(execution_model);
+
+	for (auto& variable : parser.variables_)
+	{
+		auto& decoration = parser.decorations_[variable.id];
+		auto name = parser.names_[variable.id];
+
+		switch (variable.storage_class)
+		{
+		case spv::StorageClassUniformConstant:
+		case spv::StorageClassUniform:
+		case spv::StorageClassStorageBuffer:
+		{
+			DescriptorBinding binding;
+			if (!parser.GetDescriptor(variable, binding.type, binding.count)) break;
+
+			binding.set = decoration.set;
+			binding.binding = decoration.binding;
+			binding.stages = module.stage;
+			binding.name = name;
+			module.bindings.push_back(binding);
+			break;
+		}
+		case spv::StorageClassPushConstant:
+		{
+			auto pointer = parser.types_.find(variable.type);
+			if (pointer == parser.types_.end()) break;
+
+			module.push_constants.push_back({ module.stage, 0, parser.GetSize(pointer->second.element) });
+			break;
+		}
+		case spv::StorageClassInput:
+		{
+			if (module.stage != vk::ShaderStageFlagBits::eVertex || decoration.built_in || !decoration.has_location) break;
+
+			auto pointer = parser.types_.find(variable.type);
+			if (pointer == parser.types_.end()) break;
+
+			// built-in blocks carry the decoration on the struct
+			auto pointee = parser.decorations_.find(pointer->second.element);
+			if (pointee != parser.decorations_.end() && pointee->second.built_in) break;
+
+			module.vertex_inputs.push_back({ decoration.location, parser.GetFormat(pointer->second.element), name });
+			break;
+		}
+		default:
+			break;
+		}
+	}
+
+	for (auto& constant : parser.spec_constants_)
+	{
+		auto& decoration = parser.decorations_[constant.first];
+		if (!decoration.has_spec_id) continue;
+
+		module.specialization_constants.push_back({ decoration.spec_id, parser.GetSize(constant.second), parser.names_[constant.first] });
+	}
+
+	std::sort(module.bindings.begin(), module.bindings.end(), [](const DescriptorBinding& a, const DescriptorBinding& b)
+	{
+		return a.set != b.set ? a.set < b.set : a.binding < b.binding;
+	});
+	std::sort(module.vertex_inputs.begin(), module.vertex_inputs.end(), [](const VertexInput& a, const VertexInput& b)
+	{
+		return a.location < b.location;
+	});
+
+	return true;
+}
+
+bool ShaderReflection::Merge(const std::vector<const Module*>& modules, std::vector<DescriptorBinding>& bindings, std::vector<PushConstantRange>& push_constants)
+{
+	std::map<std::pair<uint32_t, uint32_t>, DescriptorBinding> merged;
+	PushConstantRange push_range = { vk::ShaderStageFlags(), 0, 0 };
+
+	for (auto module : modules)
+	{
+		for (auto& binding : module->bindings)
+		{
+			auto key = std::make_pair(binding.set, binding.binding);
+			auto it = merged.find(key);
+			if (it == merged.end())
+			{
+				merged.emplace(key, binding);
+				continue;
+			}
+
+			if (it->second.type != binding.type || it->second.count != binding.count)
+			{
+				Log::Error("Descriptor set %u binding %u declared differently across stages.", binding.set, binding.binding);
+				return false;
+			}
+
+			it->second.stages |= binding.stages;
+		}
+
+		// a stage may appear in one range only, all stages share one
+		for (auto& range : module->push_constants)
+		{
+			push_range.stages |= range.stages;
+			push_range.size = std::max(push_range.size, range.offset + range.size);
+		}
+	}
+
+	bindings.clear();
+	for (auto& binding : merged)
+	{
+		bindings.push_back(binding.second);
+	}
+
+	push_constants.clear();
+	if (push_range.size) push_constants.push_back(push_range);
+
+	return true;
+}
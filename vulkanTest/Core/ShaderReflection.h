@@ -0,0 +1,57 @@
+#pragma once
+
+#include<string>
+#include<vector>
+#include"VulkanCommon.h"
+
+// Reads the resource interface of a SPIR-V module.
+// Descriptor bindings, push constants, vertex inputs and specialization constants
+// are taken from the decorations, no shader compiler runtime is needed.
+namespace ShaderReflection
+{
+	struct DescriptorBinding
+	{
+		uint32_t				set;
+		uint32_t				binding;
+		vk::DescriptorType		type;
+		uint32_t				count;		// 0 : runtime sized array
+		vk::ShaderStageFlags	stages;
+		std::string				name;
+	};
+
+	struct PushConstantRange
+	{
+		vk::ShaderStageFlags	stages;
+		uint32_t				offset;
+		uint32_t				size;
+	};
+
+	struct VertexInput
+	{
+		uint32_t				location;
+		vk::Format				format;
+		std::string				name;
+	};
+
+	struct SpecializationConstant
+	{
+		uint32_t				constant_id;
+		uint32_t				size;
+		std::string				name;
+	};
+
+	struct Module
+	{
+		vk::ShaderStageFlagBits				stage;
+		std::string							entry_point;
+		std::vector<DescriptorBinding>		bindings;		// sorted by set, binding
+		std::vector<PushConstantRange>		push_constants;
+		std::vector<VertexInput>			vertex_inputs;	// vertex stage only, sorted by location
+		std::vector<SpecializationConstant>	specialization_constants;
+	};
+
+	bool Reflect(const uint32_t* code, size_t word_count, Module&);
+
+	// bindings of all stages of one pipeline, false on conflicting declarations
+	bool Merge(const std::vector<const Module*>&, std::vector<DescriptorBinding>&, std::vector<PushConstantRange>&);
+}
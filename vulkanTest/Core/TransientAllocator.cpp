@@ -0,0 +1,402 @@
+#include<algorithm>
+#include<map>
+
+#include"TransientAllocator.h"
+#include"GpuTimeline.h"
+#include"../Utilities/Log.h"
+
+class TransientAllocator::Impl
+{
+public:
+	struct Placement
+	{
+		uint32_t				memory_type;
+		vk::DeviceSize			offset;
+		vk::DeviceSize			size;
+		vk::Image				image;
+		vk::ImageView			view;
+		std::vector<uint32_t>	predecessors;
+	};
+
+	// one realized set of images and the memory under them
+	struct ImageSet
+	{
+		std::vector<Request>			requests;
+		std::vector<Placement>			placements;
+		std::vector<MemoryAllocator::Allocation>	memories;
+		uint64_t						retire_value;
+	};
+
+	vk::Device					device_;
+	GpuTimeline&				timeline_;
+	MemoryAllocator&			memory_;
+	bool						aliasing_enabled_;
+	std::vector<ImageSet>		sets_;			// per frame in flight
+	uint32_t					frame_index_;
+	std::vector<ImageSet>		retired_;
+	Statistics					statistics_;
+
+	Impl(vk::Device device, GpuTimeline& timeline, MemoryAllocator& memory, uint32_t frame_count)
+		: device_(device)
+		, timeline_(timeline)
+		, memory_(memory)
+		, aliasing_enabled_(true)
+		, sets_(std::max(frame_count, 1u))
+		, frame_index_(0)
+		, statistics_() {}
+
+	ImageSet& Current(void)
+	{
+		return sets_[frame_index_];
+	}
+
+	static bool Overlaps(const Request& a, const Request& b)
+	{
+		return a.first_pass <= b.last_pass && b.first_pass <= a.last_pass;
+	}
+
+	static bool SameRequests(const std::vector<Request>& a, const std::vector<Request>& b)
+	{
+		if (a.size() != b.size()) return false;
+
+		for (size_t i = 0; i < a.size(); ++i)
+		{
+			if (a[i].info != b[i].info || a[i].first_pass != b[i].first_pass || a[i].last_pass != b[i].last_pass) return false;
+		}
+
+		return true;
+	}
+
+	void DestroySet(ImageSet& set)
+	{
+		for (auto& placement : set.placements)
+		{
+			if (placement.view) device_.destroyImageView(placement.view);
+			if (placement.image) device_.destroyImage(placement.image);
+		}
+		for (auto& memory : set.memories)
+		{
+			memory_.Free(memory);
+		}
+
+		set.placements.clear();
+		set.memories.clear();
+		set.requests.clear();
+	}
+
+	// greedy interval packing, largest first at the lowest offset free during its lifetime
+	void Place(std::vector<Placement>& placements, const std::vector<Request>& requests, const std::vector<vk::MemoryRequirements>& reqs)
+	{
+		std::vector<uint32_t> order(requests.size());
+		for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+
+		std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return reqs[a].size > reqs[b].size; });
+
+		std::vector<uint32_t> placed;
+
+		for (auto index : order)
+		{
+			auto& placement = placements[index];
+			const auto alignment = std::max<vk::DeviceSize>(reqs[index].alignment, 1);
+
+			vk::DeviceSize offset = 0;
+
+			if (aliasing_enabled_)
+			{
+				// candidate offsets are 0 and the ends of conflicting neighbours
+				std::vector<vk::DeviceSize> candidates = { 0 };
+				for (auto other : placed)
+				{
+					if (placements[other].memory_type != placement.memory_type) continue;
+					candidates.push_back(placements[other].offset + placements[other].size);
+				}
+				std::sort(candidates.begin(), candidates.end());
+
+				for (auto candidate : candidates)
+				{
+					offset = (candidate + alignment - 1) / alignment * alignment;
+
+					bool fits = true;
+					for (auto other : placed)
+					{
+						auto& o = placements[other];
+						if (o.memory_type != placement.memory_type) continue;
+
+						const bool memory_overlap = offset < o.offset + o.size && o.offset < offset + placement.size;
+						if (memory_overlap && Overlaps(requests[index], requests[other]))
+						{
+							fits = false;
+							break;
+						}
+					}
+
+					if (fits) break;
+				}
+			}
+			else
+			{
+				for (auto other : placed)
+				{
+					auto& o = placements[other];
+					if (o.memory_type == placement.memory_type) offset = std::max(offset, o.offset + o.size);
+				}
+				offset = (offset + alignment - 1) / alignment * alignment;
+			}
+
+			placement.offset = offset;
+			placed.push_back(index);
+		}
+
+		// the latest earlier occupant of an overlapping range must be done before first use
+		for (uint32_t i = 0; i < placements.size(); ++i)
+		{
+			for (uint32_t j = 0; j < placements.size(); ++j)
+			{
+				if (i == j || placements[i].memory_type != placements[j].memory_type) continue;
+
+				auto& a = placements[i];
+				auto& b = placements[j];
+				const bool memory_overlap = a.offset < b.offset + b.size && b.offset < a.offset + a.size;
+
+				if (memory_overlap && requests[j].last_pass < requests[i].first_pass)
+				{
+					a.predecessors.push_back(j);
+				}
+			}
+		}
+	}
+};
+
+TransientAllocator::TransientAllocator(vk::Device device, GpuTimeline& timeline, MemoryAllocator& memory, uint32_t frame_count)
+	: impl_(std::make_unique<Impl>(device, timeline, memory, frame_count)) {}
+
+TransientAllocator::~TransientAllocator() = default;
+
+void TransientAllocator::BeginFrame(uint32_t frame_index)
+{
+	impl_->frame_index_ = frame_index % static_cast<uint32_t>(impl_->sets_.size());
+}
+
+bool TransientAllocator::Realize(const std::vector<Request>& requests)
+{
+	auto& set = impl_->Current();
+
+	if (Impl::SameRequests(requests, set.requests) && requests.size() == set.placements.size())
+	{
+		return true;
+	}
+
+	// frames in flight may still use the old images
+	if (!set.placements.empty())
+	{
+		set.retire_value = impl_->timeline_.GetSubmittedValue();
+		impl_->retired_.push_back(std::move(set));
+		set = Impl::ImageSet();
+	}
+
+	set.requests = requests;
+	set.placements.resize(requests.size());
+
+	std::vector<vk::MemoryRequirements> reqs(requests.size());
+
+	for (uint32_t i = 0; i < requests.size(); ++i)
+	{
+		auto& placement = set.placements[i];
+
+		auto result = impl_->device_.createImage(&requests[i].info, nullptr, &placement.image);
+		if (result != vk::Result::eSuccess)
+		{
+			// a partial set must not match the next frame's requests, nothing used it yet
+			Log::Error("Transient image cannot created.");
+			impl_->DestroySet(set);
+			return false;
+		}
+
+		VulkanStats::CountCreated();
+
+		impl_->device_.getImageMemoryRequirements(placement.image, &reqs[i]);
+
+		placement.memory_type = impl_->memory_.FindMemoryTypeIndex(reqs[i].memoryTypeBits, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		if (placement.memory_type == 0xffffffff)
+		{
+			Log::Error("Transient memory type do not supported.");
+			impl_->DestroySet(set);
+			return false;
+		}
+
+		placement.size = reqs[i].size;
+	}
+
+	impl_->Place(set.placements, requests, reqs);
+
+	// one range per memory type, sized by the furthest placement
+	std::map<uint32_t, vk::MemoryRequirements> heap_reqs;
+	for (uint32_t i = 0; i < requests.size(); ++i)
+	{
+		auto& placement = set.placements[i];
+		auto& heap = heap_reqs[placement.memory_type];
+		heap.size = std::max(heap.size, placement.offset + placement.size);
+		heap.alignment = std::max(heap.alignment, reqs[i].alignment);
+		heap.memoryTypeBits = 1u << placement.memory_type;
+	}
+
+	std::map<uint32_t, MemoryAllocator::Allocation> memories;
+	for (auto& heap : heap_reqs)
+	{
+		auto memory = impl_->memory_.Allocate(heap.second, vk::MemoryPropertyFlagBits::eDeviceLocal, MemoryAllocator::Kind::OPTIMAL);
+		if (!memory)
+		{
+			Log::Error("Transient memory cannot allocated.");
+			impl_->DestroySet(set);
+			return false;
+		}
+
+		memories[heap.first] = memory;
+		set.memories.push_back(memory);
+	}
+
+	for (uint32_t i = 0; i < requests.size(); ++i)
+	{
+		auto& placement = set.placements[i];
+
+		auto& memory = memories[placement.memory_type];
+		auto result = impl_->device_.bindImageMemory(placement.image, memory.memory, memory.offset + placement.offset);
+		if (result != vk::Result::eSuccess)
+		{
+			Log::Error("Transient image memory cannot binded.");
+			impl_->DestroySet(set);
+			return false;
+		}
+
+		auto const& info = requests[i].info;
+		auto const view_info = vk::ImageViewCreateInfo()
+			.setImage(placement.image)
+			.setViewType(info.arrayLayers > 1 ? vk::ImageViewType::e2DArray : vk::ImageViewType::e2D)
+			.setFormat(info.format)
+			.setSubresourceRange(vk::ImageSubresourceRange(GetAspect(info.format), 0, info.mipLevels, 0, info.arrayLayers));
+
+		result = impl_->device_.createImageView(&view_info, nullptr, &placement.view);
+		if (result != vk::Result::eSuccess)
+		{
+			Log::Error("Transient image view cannot created.");
+			impl_->DestroySet(set);
+			return false;
+		}
+
+		VulkanStats::CountCreated();
+	}
+
+	/*statistics*/ {
+		auto& stats = impl_->statistics_;
+		stats = Statistics();
+		stats.image_count = static_cast<uint32_t>(requests.size());
+		stats.memory_count = static_cast<uint32_t>(set.memories.size());
+
+		uint32_t last_pass = 0;
+		for (uint32_t i = 0; i < requests.size(); ++i)
+		{
+			stats.unaliased_bytes += reqs[i].size;
+			last_pass = std::max(last_pass, requests[i].last_pass);
+		}
+		for (auto& heap : heap_reqs)
+		{
+			stats.aliased_bytes += heap.second.size;
+		}
+		for (uint32_t pass = 0; pass <= last_pass && !requests.empty(); ++pass)
+		{
+			uint64_t live = 0;
+			for (uint32_t i = 0; i < requests.size(); ++i)
+			{
+				if (requests[i].first_pass <= pass && pass <= requests[i].last_pass) live += reqs[i].size;
+			}
+			stats.peak_live_bytes = std::max(stats.peak_live_bytes, live);
+		}
+
+		Log::Info("Transient memory %llu KB (unaliased %llu KB, live peak %llu KB)",
+			stats.aliased_bytes / 1024, stats.unaliased_bytes / 1024, stats.peak_live_bytes / 1024);
+	}
+
+	return true;
+}
+
+vk::Image TransientAllocator::GetImage(uint32_t index) const
+{
+	return impl_->sets_[impl_->frame_index_].placements[index].image;
+}
+
+vk::ImageView TransientAllocator::GetImageView(uint32_t index) const
+{
+	return impl_->sets_[impl_->frame_index_].placements[index].view;
+}
+
+const std::vector<uint32_t>& TransientAllocator::GetAliasPredecessors(uint32_t index) const
+{
+	return impl_->sets_[impl_->frame_index_].placements[index].predecessors;
+}
+
+void TransientAllocator::SetAliasingEnabled(bool enabled)
+{
+	if (impl_->aliasing_enabled_ == enabled) return;
+
+	impl_->aliasing_enabled_ = enabled;
+
+	// force a rebuild on the next Realize() of every slot
+	for (auto& set : impl_->sets_)
+	{
+		set.requests.clear();
+	}
+}
+
+vk::ImageAspectFlags TransientAllocator::GetAspect(vk::Format format)
+{
+	switch (format)
+	{
+	case vk::Format::eD16Unorm:
+	case vk::Format::eX8D24UnormPack32:
+	case vk::Format::eD32Sfloat:
+		return vk::ImageAspectFlagBits::eDepth;
+	case vk::Format::eS8Uint:
+		return vk::ImageAspectFlagBits::eStencil;
+	case vk::Format::eD16UnormS8Uint:
+	case vk::Format::eD24UnormS8Uint:
+	case vk::Format::eD32SfloatS8Uint:
+		return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+	default:
+		return vk::ImageAspectFlagBits::eColor;
+	}
+}
+
+const TransientAllocator::Statistics& TransientAllocator::GetStatistics(void) const
+{
+	return impl_->statistics_;
+}
+
+void TransientAllocator::Update(void)
+{
+	auto it = impl_->retired_.begin();
+	while (it != impl_->retired_.end())
+	{
+		if (!impl_->timeline_.IsCompleted(it->retire_value))
+		{
+			++it;
+			continue;
+		}
+
+		impl_->DestroySet(*it);
+		it = impl_->retired_.erase(it);
+	}
+}
+
+void TransientAllocator::Destroy(void)
+{
+	for (auto& set : impl_->retired_)
+	{
+		impl_->DestroySet(set);
+	}
+	impl_->retired_.clear();
+
+	for (auto& set : impl_->sets_)
+	{
+		impl_->DestroySet(set);
+	}
+}
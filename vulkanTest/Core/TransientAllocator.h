@@ -0,0 +1,62 @@
+#pragma once
+
+#include<memory>
+#include<vector>
+#include"VulkanCommon.h"
+#include"MemoryAllocator.h"
+
+class GpuTimeline;
+
+// Places render graph intermediates that live for part of a frame.
+// Images whose pass lifetimes do not overlap share device memory ranges,
+// the set is rebuilt only when the requested images or lifetimes change.
+// Each frame in flight owns its set, a frame never writes memory an earlier one still uses.
+class TransientAllocator
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	struct Request
+	{
+		vk::ImageCreateInfo	info;
+		uint32_t			first_pass;		// execution order, inclusive
+		uint32_t			last_pass;
+	};
+
+	struct Statistics
+	{
+		uint64_t	unaliased_bytes;	// every image in its own range
+		uint64_t	aliased_bytes;		// memory actually sub-allocated
+		uint64_t	peak_live_bytes;	// largest sum of images alive in one pass, the lower bound
+		uint32_t	image_count;
+		uint32_t	memory_count;
+	};
+
+	static constexpr uint32_t no_predecessor = 0xffffffff;
+
+	TransientAllocator() = delete;
+	TransientAllocator(vk::Device, GpuTimeline&, MemoryAllocator&, uint32_t frame_count);
+	~TransientAllocator();
+
+	// the slot's previous frame must have completed, Realize and the getters use its set
+	void BeginFrame(uint32_t frame_index);
+
+	// images for the requests by index, false if creation failed
+	bool Realize(const std::vector<Request>&);
+
+	vk::Image GetImage(uint32_t index) const;
+	vk::ImageView GetImageView(uint32_t index) const;
+
+	// request whose memory this one takes over, its last use must finish first
+	const std::vector<uint32_t>& GetAliasPredecessors(uint32_t index) const;
+
+	void SetAliasingEnabled(bool);
+	static vk::ImageAspectFlags GetAspect(vk::Format);
+	const Statistics& GetStatistics(void) const;
+
+	// frees sets retired earlier once the gpu is done with them
+	void Update(void);
+	void Destroy(void);
+};
@@ -0,0 +1,140 @@
+#include<atomic>
+#include<algorithm>
+
+#include"UploadRing.h"
+#include"../Utilities/Log.h"
+
+class UploadRing::Impl
+{
+public:
+	vk::Device						device_;
+	MemoryAllocator&				memory_;
+	vk::DeviceSize					min_alignment_;
+	uint32_t						frame_count_;
+	vk::DeviceSize					frame_size_;
+	vk::Buffer						buffer_;
+	MemoryAllocator::Allocation		allocation_;
+	vk::DeviceSize					frame_begin_;		// partition of the current frame
+	std::atomic<vk::DeviceSize>		head_;				// bytes used in the partition
+	vk::DeviceSize					peak_;
+	std::atomic<bool>				overflow_reported_;	// Allocate runs on several threads
+
+	Impl(vk::Device device, MemoryAllocator& memory, const vk::PhysicalDeviceLimits& limits, uint32_t frame_count, vk::DeviceSize frame_size)
+		: device_(device)
+		, memory_(memory)
+		, min_alignment_(std::max<vk::DeviceSize>({ limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment, 16 }))
+		, frame_count_(frame_count)
+		, frame_size_(frame_size)
+		, allocation_()
+		, frame_begin_(0)
+		, head_(0)
+		, peak_(0)
+		, overflow_reported_(false)
+	{
+		// every partition starts aligned
+		frame_size_ = (frame_size_ + min_alignment_ - 1) / min_alignment_ * min_alignment_;
+	}
+};
+
+UploadRing::UploadRing(vk::Device device, MemoryAllocator& memory, const vk::PhysicalDeviceLimits& limits, uint32_t frame_count, vk::DeviceSize frame_size)
+	: impl_(std::make_unique<Impl>(device, memory, limits, frame_count, frame_size)) {}
+
+UploadRing::~UploadRing() = default;
+
+bool UploadRing::Initialize(void)
+{
+	auto const buffer_info = vk::BufferCreateInfo()
+		.setSize(impl_->frame_size_ * impl_->frame_count_)
+		.setUsage(vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer |
+			vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer |
+			vk::BufferUsageFlagBits::eTransferSrc)
+		.setSharingMode(vk::SharingMode::eExclusive);
+
+	auto result = impl_->device_.createBuffer(&buffer_info, nullptr, &impl_->buffer_);
+	if (result != vk::Result::eSuccess)
+	{
+		Log::Error("Upload ring buffer cannot created.");
+		return false;
+	}
+
+	VulkanStats::CountCreated();
+
+	// coherent, writes need no flush before the submit
+	impl_->allocation_ = impl_->memory_.AllocateBuffer(impl_->buffer_,
+		vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+	if (!impl_->allocation_ || !impl_->allocation_.mapped)
+	{
+		Log::Error("Upload ring memory cannot allocated.");
+		return false;
+	}
+
+	Log::Info("Upload ring create done.");
+
+	return true;
+}
+
+void UploadRing::Destroy(void)
+{
+	impl_->memory_.Free(impl_->allocation_);
+
+	if (impl_->buffer_) impl_->device_.destroyBuffer(impl_->buffer_);
+	impl_->buffer_ = vk::Buffer();
+}
+
+void UploadRing::BeginFrame(uint32_t frame_index)
+{
+	impl_->peak_ = std::max(impl_->peak_, impl_->head_.load(std::memory_order_relaxed));
+
+	impl_->frame_begin_ = impl_->frame_size_ * (frame_index % impl_->frame_count_);
+	impl_->head_.store(0, std::memory_order_relaxed);
+	impl_->overflow_reported_.store(false, std::memory_order_relaxed);
+}
+
+UploadRing::Allocation UploadRing::Allocate(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+	if (!alignment) alignment = impl_->min_alignment_;
+
+	auto head = impl_->head_.load(std::memory_order_relaxed);
+	vk::DeviceSize offset;
+
+	do
+	{
+		offset = (head + alignment - 1) / alignment * alignment;
+		if (offset + size > impl_->frame_size_)
+		{
+			if (!impl_->overflow_reported_.exchange(true, std::memory_order_relaxed))
+			{
+				Log::Warning("Upload ring frame partition is full.");
+			}
+			return Allocation();
+		}
+	} while (!impl_->head_.compare_exchange_weak(head, offset + size, std::memory_order_relaxed));
+
+	Allocation allocation;
+	allocation.buffer = impl_->buffer_;
+	allocation.offset = impl_->frame_begin_ + offset;
+	allocation.size = size;
+	allocation.data = static_cast<char*>(impl_->allocation_.mapped) + allocation.offset;
+
+	return allocation;
+}
+
+vk::Buffer UploadRing::GetBuffer(void) const
+{
+	return impl_->buffer_;
+}
+
+vk::DeviceSize UploadRing::GetFrameSize(void) const
+{
+	return impl_->frame_size_;
+}
+
+vk::DeviceSize UploadRing::GetUsedSize(void) const
+{
+	return impl_->head_.load(std::memory_order_relaxed);
+}
+
+vk::DeviceSize UploadRing::GetPeakSize(void) const
+{
+	return std::max(impl_->peak_, impl_->head_.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include<memory>
+#include"VulkanCommon.h"
+#include"MemoryAllocator.h"
+
+// Persistently mapped buffer for per-frame dynamic data.
+// The buffer is split into one partition per frame in flight, allocations are a
+// lock-free bump inside the current partition and die when the slot comes around.
+class UploadRing
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	struct Allocation
+	{
+		vk::Buffer		buffer;
+		vk::DeviceSize	offset;		// dynamic offset
+		vk::DeviceSize	size;
+		void*			data;		// write only, coherent
+
+		explicit operator bool(void) const { return data != nullptr; }
+	};
+
+	UploadRing() = delete;
+	UploadRing(vk::Device, MemoryAllocator&, const vk::PhysicalDeviceLimits&, uint32_t frame_count, vk::DeviceSize frame_size);
+	~UploadRing();
+
+	bool Initialize(void);
+	void Destroy(void);
+
+	// the frame's previous work must have completed
+	void BeginFrame(uint32_t frame_index);
+
+	// thread safe, alignment 0 : minUniformBufferOffsetAlignment
+	// empty allocation when the frame partition is full
+	Allocation Allocate(vk::DeviceSize size, vk::DeviceSize alignment = 0);
+
+	template<class T>
+	Allocation Push(const T& value)
+	{
+		auto allocation = Allocate(sizeof(T));
+		if (allocation) *static_cast<T*>(allocation.data) = value;
+		return allocation;
+	}
+
+	vk::Buffer GetBuffer(void) const;
+	vk::DeviceSize GetFrameSize(void) const;
+
+	// bytes used in the current frame, high water mark since start
+	vk::DeviceSize GetUsedSize(void) const;
+	vk::DeviceSize GetPeakSize(void) const;
+};
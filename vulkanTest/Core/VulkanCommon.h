@@ -0,0 +1,27 @@
+#pragma once
+
+#include<atomic>
+#include<cstdint>
+
+#if defined(_WIN32)
+#define VK_USE_PLATFORM_WIN32_KHR
+#endif
+#define VULKAN_HPP_NO_SMART_HANDLE
+#define VULKAN_HPP_NO_EXCEPTIONS
+#include<vulkan/vulkan.hpp>
+
+namespace VulkanStats
+{
+	// vk objects and device memory created so far, steady state frames must not add any
+	inline std::atomic<uint64_t> created_object_count{ 0 };
+
+	inline void CountCreated(uint64_t count = 1)
+	{
+		created_object_count.fetch_add(count, std::memory_order_relaxed);
+	}
+
+	inline uint64_t GetCreatedCount(void)
+	{
+		return created_object_count.load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,68 @@
+#include<map>
+#include<vector>
+#include<sstream>
+#include<cstdlib>
+
+#include"CommandLine.h"
+
+namespace
+{
+	std::map<std::string, std::string> options;
+}
+
+void CommandLine::Initialize(const std::string& command_line)
+{
+	options.clear();
+
+	std::vector<std::string> tokens;
+	std::istringstream stream(command_line);
+	for (std::string token; stream >> token;)
+	{
+		tokens.push_back(token);
+	}
+
+	for (size_t i = 0; i < tokens.size(); ++i)
+	{
+		auto& token = tokens[i];
+		if (token.compare(0, 2, "--") != 0) continue;
+
+		auto separator = token.find('=');
+		if (separator != std::string::npos)
+		{
+			options[token.substr(2, separator - 2)] = token.substr(separator + 1);
+			continue;
+		}
+
+		// the next token is the value unless it is another option
+		std::string value;
+		if (i + 1 < tokens.size() && tokens[i + 1].compare(0, 2, "--") != 0)
+		{
+			value = tokens[++i];
+		}
+		options[token.substr(2)] = value;
+	}
+}
+
+bool CommandLine::HasOption(const std::string& name)
+{
+	return options.find(name) != options.end();
+}
+
+std::string CommandLine::GetValue(const std::string& name, const std::string& default_value)
+{
+	auto found = options.find(name);
+	if (found == options.end() || found->second.empty()) return default_value;
+
+	return found->second;
+}
+
+int CommandLine::GetInt(const std::string& name, int default_value)
+{
+	auto value = GetValue(name);
+	if (value.empty()) return default_value;
+
+	char* end = nullptr;
+	auto number = std::strtol(value.c_str(), &end, 10);
+
+	return (end && *end == '\0') ? static_cast<int>(number) : default_value;
+}
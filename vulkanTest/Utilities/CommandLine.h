@@ -0,0 +1,15 @@
+#pragma once
+
+#include<string>
+
+// options as "--name", "--name value" or "--name=value"
+namespace CommandLine
+{
+	// arguments without the program name, as WinMain receives them
+	void Initialize(const std::string& command_line);
+
+	bool HasOption(const std::string& name);
+
+	std::string GetValue(const std::string& name, const std::string& default_value = "");
+	int GetInt(const std::string& name, int default_value);
+}
@@ -0,0 +1,274 @@
+#include<mutex>
+#include<atomic>
+#include<chrono>
+#include<memory>
+#include<vector>
+#include<cstdio>
+#include<algorithm>
+
+#include"CpuProfiler.h"
+#include"Settings.h"
+#include"Utils.h"
+#include"Log.h"
+#include"../Application/BaseSystem/BaseSystem.h"
+
+namespace
+{
+	enum class EventType : uint32_t
+	{
+		BEGIN,
+		END,
+		COUNTER,
+		FRAME,
+	};
+
+	struct Event
+	{
+		const char*	name;
+		int64_t		value;		// counter value or frame index
+		uint64_t	time_ns;
+		EventType	type;
+	};
+
+	// written only by its thread, a dump copies it while the thread keeps going
+	struct ThreadBuffer
+	{
+		std::unique_ptr<Event[]>	events;
+		std::atomic<uint64_t>		write;
+		uint32_t					thread_id;
+		std::string					name;		// registry mutex held
+	};
+
+	const uint64_t ring_size = Settings::cpu_profiler_ring_size<uint64_t>;
+	const uint64_t ring_mask = ring_size - 1;
+	static_assert((Settings::cpu_profiler_ring_size<uint64_t> & (Settings::cpu_profiler_ring_size<uint64_t> - 1)) == 0, "ring size must be a power of two");
+
+	const auto epoch = std::chrono::steady_clock::now();
+
+	// buffers stay after their thread exits, its zones can still be dumped
+	std::mutex registry_mutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> registry;
+
+	thread_local ThreadBuffer* local_buffer = nullptr;
+
+	// main thread only
+	std::vector<uint64_t> frame_starts(Settings::cpu_profiler_frame_history<size_t>);
+	uint64_t frame_index = 0;
+
+	std::atomic<uint32_t> requested_frames(0);
+
+	uint64_t Now(void)
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+	}
+
+	ThreadBuffer* GetBuffer(void)
+	{
+		if (local_buffer) return local_buffer;
+
+		auto buffer = std::make_unique<ThreadBuffer>();
+		buffer->events = std::make_unique<Event[]>(ring_size);
+		buffer->write = 0;
+
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		buffer->thread_id = static_cast<uint32_t>(registry.size()) + 1;
+		buffer->name = "thread " + std::to_string(buffer->thread_id);
+
+		local_buffer = buffer.get();
+		registry.push_back(std::move(buffer));
+
+		return local_buffer;
+	}
+
+	void Record(EventType type, const char* name, int64_t value)
+	{
+		if (!Settings::cpu_profiler_enabled<bool>) return;
+
+		auto buffer = GetBuffer();
+
+		const uint64_t index = buffer->write.load(std::memory_order_relaxed);
+
+		auto& event = buffer->events[index & ring_mask];
+		event.name = name;
+		event.value = value;
+		event.time_ns = Now();
+		event.type = type;
+
+		// the event is complete before a dump can see it
+		buffer->write.store(index + 1, std::memory_order_release);
+	}
+
+	// the events still intact after the copy, oldest first
+	std::vector<Event> Snapshot(const ThreadBuffer& buffer)
+	{
+		const uint64_t end = buffer.write.load(std::memory_order_acquire);
+		const uint64_t begin = end > ring_size ? end - ring_size : 0;
+
+		std::vector<Event> events;
+		events.reserve(static_cast<size_t>(end - begin));
+		for (uint64_t i = begin; i < end; ++i)
+		{
+			events.push_back(buffer.events[i & ring_mask]);
+		}
+
+		// the owner may have wrapped over the start while copying,
+		// and the slot at after may be half written right now
+		const uint64_t after = buffer.write.load(std::memory_order_acquire);
+		const uint64_t overwritten = after + 1 > ring_size ? after + 1 - ring_size : 0;
+		if (overwritten > begin)
+		{
+			const auto lost = static_cast<size_t>(std::min(overwritten - begin, end - begin));
+			events.erase(events.begin(), events.begin() + lost);
+		}
+
+		return events;
+	}
+
+	std::string Escape(const char* text)
+	{
+		std::string escaped;
+		for (; *text; ++text)
+		{
+			if (*text == '"' || *text == '\\') escaped += '\\';
+			escaped += *text;
+		}
+		return escaped;
+	}
+
+	void AppendEvent(std::string& json, const Event& event, uint32_t thread_id)
+	{
+		char line[128];
+		const double ts = event.time_ns / 1000.0;
+
+		switch (event.type)
+		{
+		case EventType::BEGIN:
+			snprintf(line, sizeof(line), "\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}", ts, thread_id);
+			json += ",\n{\"name\":\"" + Escape(event.name) + "\"," + line;
+			break;
+		case EventType::END:
+			snprintf(line, sizeof(line), ",\n{\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}", ts, thread_id);
+			json += line;
+			break;
+		case EventType::COUNTER:
+			snprintf(line, sizeof(line), "\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%lld}}", ts, thread_id, static_cast<long long>(event.value));
+			json += ",\n{\"name\":\"" + Escape(event.name) + "\"," + line;
+			break;
+		case EventType::FRAME:
+			snprintf(line, sizeof(line), ",\n{\"name\":\"frame %lld\",\"ph\":\"i\",\"s\":\"g\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}", static_cast<long long>(event.value), ts, thread_id);
+			json += line;
+			break;
+		}
+	}
+}
+
+void CpuProfiler::BeginZone(const char* name)
+{
+	Record(EventType::BEGIN, name, 0);
+}
+
+void CpuProfiler::EndZone(void)
+{
+	Record(EventType::END, nullptr, 0);
+}
+
+void CpuProfiler::Counter(const char* name, int64_t value)
+{
+	Record(EventType::COUNTER, name, value);
+}
+
+void CpuProfiler::FrameMark(void)
+{
+	if (!Settings::cpu_profiler_enabled<bool>) return;
+
+	Record(EventType::FRAME, nullptr, static_cast<int64_t>(frame_index));
+
+	frame_starts[frame_index % frame_starts.size()] = Now();
+	++frame_index;
+
+	auto frames = requested_frames.exchange(0);
+	if (frames)
+	{
+		Dump(BaseSystem::workspace_directory_ + "/cpu_trace_" + std::to_string(frame_index) + ".json", frames);
+	}
+}
+
+uint64_t CpuProfiler::GetFrameIndex(void)
+{
+	return frame_index;
+}
+
+void CpuProfiler::SetThreadName(const std::string& name)
+{
+	if (!Settings::cpu_profiler_enabled<bool>) return;
+
+	auto buffer = GetBuffer();
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	buffer->name = name;
+}
+
+void CpuProfiler::RequestDump(uint32_t frame_count)
+{
+	requested_frames = std::max(frame_count, 1u);
+}
+
+bool CpuProfiler::Dump(const std::string& path, uint32_t frame_count)
+{
+	if (!Settings::cpu_profiler_enabled<bool>) return false;
+
+	// the last marks bound whole frames, the newest one is the frame just begun
+	uint64_t start_ns = 0;
+	const uint64_t complete = frame_index > 0 ? frame_index - 1 : 0;
+	const uint64_t frames = std::min<uint64_t>({ frame_count, complete, frame_starts.size() - 1 });
+	if (frames < frame_index) start_ns = frame_starts[(frame_index - 1 - frames) % frame_starts.size()];
+
+	std::vector<std::pair<uint32_t, std::string>> names;
+	std::vector<std::pair<uint32_t, std::vector<Event>>> threads;
+	{
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		for (auto& buffer : registry)
+		{
+			names.emplace_back(buffer->thread_id, buffer->name);
+			threads.emplace_back(buffer->thread_id, Snapshot(*buffer));
+		}
+	}
+
+	std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"vulkanTest\"}}";
+	for (auto& name : names)
+	{
+		json += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(name.first) + ",\"args\":{\"name\":\"" + Escape(name.second.c_str()) + "\"}}";
+	}
+
+	size_t event_count = 0;
+	for (auto& thread : threads)
+	{
+		// ends of zones begun before the window have no begin
+		uint32_t depth = 0;
+		for (auto& event : thread.second)
+		{
+			if (event.time_ns < start_ns) continue;
+
+			if (event.type == EventType::BEGIN) ++depth;
+			if (event.type == EventType::END)
+			{
+				if (depth == 0) continue;
+				--depth;
+			}
+
+			AppendEvent(json, event, thread.first);
+			++event_count;
+		}
+	}
+	json += "\n]}\n";
+
+	if (!FileUtils::WriteBinaryAtomic(path, json.data(), json.size()))
+	{
+		Log::Error("Cpu trace cannot written.");
+		return false;
+	}
+
+	Log::Info("Cpu trace of %d frames, %d events written.", static_cast<int>(frames), static_cast<int>(event_count));
+
+	return true;
+}
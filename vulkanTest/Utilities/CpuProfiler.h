@@ -0,0 +1,47 @@
+#pragma once
+
+#include<string>
+#include<cstdint>
+
+// Scoped cpu zones recorded into a ring per thread.
+// Recording never locks or allocates, a thread registers its ring once on first use.
+// The main thread marks frames, a dump writes the zones, counters and frame marks
+// of the last frames as Chrome trace event json (chrome://tracing, ui.perfetto.dev).
+namespace CpuProfiler
+{
+	// names must outlive the profiler, string literals or __FUNCTION__
+	void BeginZone(const char* name);
+	void EndZone(void);
+
+	// shows as a counter track
+	void Counter(const char* name, int64_t value);
+
+	// once per frame on the main thread, also runs a requested dump
+	void FrameMark(void);
+	uint64_t GetFrameIndex(void);
+
+	// the name shows on the thread's track, not for the hot path
+	void SetThreadName(const std::string& name);
+
+	// the last frame_count frames at the next frame mark
+	void RequestDump(uint32_t frame_count);
+
+	// immediately, from the main thread
+	bool Dump(const std::string& path, uint32_t frame_count);
+
+	class Zone
+	{
+	public:
+		explicit Zone(const char* name) { BeginZone(name); }
+		~Zone() { EndZone(); }
+
+		Zone(const Zone&) = delete;
+		Zone& operator=(const Zone&) = delete;
+	};
+}
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#define PROFILE_ZONE(name) CpuProfiler::Zone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_ZONE(__FUNCTION__)
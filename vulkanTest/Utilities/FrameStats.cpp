@@ -0,0 +1,266 @@
+#include<cmath>
+#include<atomic>
+#include<chrono>
+#include<vector>
+#include<algorithm>
+
+#include"FrameStats.h"
+#include"Settings.h"
+#include"Log.h"
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	// microseconds, 32 linear bins below 32 us, then 32 bins per power of two
+	const uint32_t sub_bits = 5;
+	const uint32_t sub_count = 1u << sub_bits;
+	const uint32_t max_magnitude = 36;		// ~19 hours, longer frames land in the last bin
+	const uint32_t bin_count = sub_count + (max_magnitude - sub_bits + 1) * sub_count;
+
+	std::atomic<uint64_t> bins[bin_count];
+	std::atomic<uint64_t> frame_count(0);
+	std::atomic<uint64_t> sum_us(0);
+	std::atomic<uint64_t> min_us(UINT64_MAX);
+	std::atomic<uint64_t> max_us(0);
+	std::atomic<uint64_t> stutter_count(0);
+	std::atomic<uint64_t> severe_stutter_count(0);
+	std::atomic<uint64_t> budget_us(0);
+
+	// the latest frames for the windows, the write index only grows
+	const uint64_t ring_size = Settings::frame_stats_window_capacity<uint64_t>;
+	std::atomic<uint64_t> ring[Settings::frame_stats_window_capacity<size_t>];
+	std::atomic<uint64_t> ring_write(0);
+
+	// main thread only
+	bool has_mark = false;
+	Clock::time_point last_mark;
+
+	uint32_t Magnitude(uint64_t value)
+	{
+		uint32_t magnitude = 0;
+		while (value >>= 1) ++magnitude;
+		return magnitude;
+	}
+
+	uint32_t BinIndex(uint64_t us)
+	{
+		if (us < sub_count) return static_cast<uint32_t>(us);
+
+		const uint32_t magnitude = std::min(Magnitude(us), max_magnitude);
+		const uint32_t shift = magnitude - sub_bits;
+		const uint64_t sub = std::min<uint64_t>(us >> shift, 2 * sub_count - 1) - sub_count;
+
+		return sub_count + (magnitude - sub_bits) * sub_count + static_cast<uint32_t>(sub);
+	}
+
+	// middle of the bin
+	double BinValue(uint32_t index)
+	{
+		if (index < sub_count) return index;
+
+		const uint32_t shift = (index - sub_count) / sub_count;
+		const uint64_t sub = (index - sub_count) % sub_count;
+		const uint64_t width = 1ull << shift;
+
+		return static_cast<double>((sub_count + sub) << shift) + (width - 1) * 0.5;
+	}
+
+	void StoreMin(std::atomic<uint64_t>& target, uint64_t value)
+	{
+		uint64_t current = target.load(std::memory_order_relaxed);
+		while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+	}
+
+	void StoreMax(std::atomic<uint64_t>& target, uint64_t value)
+	{
+		uint64_t current = target.load(std::memory_order_relaxed);
+		while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+	}
+
+	// rank of the p-th percentile among count sorted values, 0 based
+	uint64_t Rank(double p, uint64_t count)
+	{
+		const auto rank = static_cast<uint64_t>(std::ceil(p * count));
+		return std::min(std::max<uint64_t>(rank, 1), count) - 1;
+	}
+
+	void LogOne(const char* label, const FrameStats::Summary& summary)
+	{
+		if (summary.frame_count == 0) return;
+
+		Log::Info("%s %llu frames, avg %.3f min %.3f max %.3f ms", label, static_cast<unsigned long long>(summary.frame_count),
+			summary.average_ms, summary.min_ms, summary.max_ms);
+		Log::Info("  p50 %.3f p90 %.3f p99 %.3f p99.9 %.3f ms", summary.p50_ms, summary.p90_ms, summary.p99_ms, summary.p999_ms);
+		Log::Info("  over %.2f ms : %llu, over %.2f ms : %llu", summary.budget_ms, static_cast<unsigned long long>(summary.stutter_count),
+			summary.budget_ms * 2.0, static_cast<unsigned long long>(summary.severe_stutter_count));
+	}
+}
+
+void FrameStats::Initialize(double budget_ms)
+{
+	for (auto& bin : bins) bin = 0;
+	for (auto& slot : ring) slot = 0;
+
+	frame_count = 0;
+	sum_us = 0;
+	min_us = UINT64_MAX;
+	max_us = 0;
+	stutter_count = 0;
+	severe_stutter_count = 0;
+	ring_write = 0;
+	has_mark = false;
+
+	SetBudget(budget_ms);
+}
+
+void FrameStats::SetBudget(double budget_ms)
+{
+	budget_us = static_cast<uint64_t>(std::llround(std::max(budget_ms, 0.0) * 1000.0));
+}
+
+double FrameStats::GetBudget(void)
+{
+	return budget_us / 1000.0;
+}
+
+void FrameStats::FrameMark(void)
+{
+	const auto now = Clock::now();
+
+	if (has_mark) Record(std::chrono::duration<double, std::milli>(now - last_mark).count());
+
+	has_mark = true;
+	last_mark = now;
+}
+
+void FrameStats::Record(double frame_ms)
+{
+	const auto us = static_cast<uint64_t>(std::llround(std::max(frame_ms, 0.0) * 1000.0));
+
+	bins[BinIndex(us)].fetch_add(1, std::memory_order_relaxed);
+	sum_us.fetch_add(us, std::memory_order_relaxed);
+	StoreMin(min_us, us);
+	StoreMax(max_us, us);
+
+	const uint64_t budget = budget_us.load(std::memory_order_relaxed);
+	if (budget && us > budget) stutter_count.fetch_add(1, std::memory_order_relaxed);
+	if (budget && us > budget * 2) severe_stutter_count.fetch_add(1, std::memory_order_relaxed);
+
+	const uint64_t index = ring_write.fetch_add(1, std::memory_order_relaxed);
+	ring[index % ring_size].store(us, std::memory_order_relaxed);
+
+	// last, a reader seeing the count sees the frame's bin
+	frame_count.fetch_add(1, std::memory_order_release);
+}
+
+FrameStats::Summary FrameStats::GetSummary(void)
+{
+	Summary summary = {};
+	summary.budget_ms = GetBudget();
+
+	// bins are read one by one while frames keep coming, the total is what was read
+	std::vector<uint64_t> counts(bin_count);
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < bin_count; ++i)
+	{
+		counts[i] = bins[i].load(std::memory_order_acquire);
+		total += counts[i];
+	}
+	if (total == 0) return summary;
+
+	summary.frame_count = total;
+	summary.average_ms = sum_us.load(std::memory_order_relaxed) / 1000.0 / frame_count.load(std::memory_order_acquire);
+	summary.min_ms = min_us.load(std::memory_order_relaxed) / 1000.0;
+	summary.max_ms = max_us.load(std::memory_order_relaxed) / 1000.0;
+	summary.stutter_count = stutter_count.load(std::memory_order_relaxed);
+	summary.severe_stutter_count = severe_stutter_count.load(std::memory_order_relaxed);
+
+	const double percentiles[] = { 0.5, 0.9, 0.99, 0.999 };
+	double* results[] = { &summary.p50_ms, &summary.p90_ms, &summary.p99_ms, &summary.p999_ms };
+
+	for (size_t p = 0; p < std::size(percentiles); ++p)
+	{
+		const uint64_t rank = Rank(percentiles[p], total);
+
+		uint64_t seen = 0;
+		for (uint32_t i = 0; i < bin_count; ++i)
+		{
+			seen += counts[i];
+			if (seen > rank)
+			{
+				// a bin middle may lie outside what was measured
+				*results[p] = std::min(std::max(BinValue(i) / 1000.0, summary.min_ms), summary.max_ms);
+				break;
+			}
+		}
+	}
+
+	return summary;
+}
+
+FrameStats::Summary FrameStats::GetWindow(uint32_t window)
+{
+	Summary summary = {};
+	summary.budget_ms = GetBudget();
+
+	const uint64_t end = ring_write.load(std::memory_order_acquire);
+	const uint64_t count = std::min<uint64_t>({ window, end, ring_size });
+	if (count == 0) return summary;
+
+	std::vector<uint64_t> samples;
+	samples.reserve(static_cast<size_t>(count));
+	for (uint64_t i = end - count; i < end; ++i)
+	{
+		samples.push_back(ring[i % ring_size].load(std::memory_order_relaxed));
+	}
+
+	const uint64_t budget = budget_us.load(std::memory_order_relaxed);
+
+	uint64_t sum = 0;
+	for (auto us : samples)
+	{
+		sum += us;
+		if (budget && us > budget) ++summary.stutter_count;
+		if (budget && us > budget * 2) ++summary.severe_stutter_count;
+	}
+
+	std::sort(samples.begin(), samples.end());
+
+	summary.frame_count = count;
+	summary.average_ms = sum / 1000.0 / count;
+	summary.min_ms = samples.front() / 1000.0;
+	summary.max_ms = samples.back() / 1000.0;
+	summary.p50_ms = samples[Rank(0.5, count)] / 1000.0;
+	summary.p90_ms = samples[Rank(0.9, count)] / 1000.0;
+	summary.p99_ms = samples[Rank(0.99, count)] / 1000.0;
+	summary.p999_ms = samples[Rank(0.999, count)] / 1000.0;
+
+	return summary;
+}
+
+std::vector<double> FrameStats::GetFrameTimes(uint32_t frame_count)
+{
+	const uint64_t end = ring_write.load(std::memory_order_acquire);
+	const uint64_t count = std::min<uint64_t>({ frame_count, end, ring_size });
+
+	std::vector<double> times;
+	times.reserve(static_cast<size_t>(count));
+	for (uint64_t i = end - count; i < end; ++i)
+	{
+		times.push_back(ring[i % ring_size].load(std::memory_order_relaxed) / 1000.0);
+	}
+	return times;
+}
+
+void FrameStats::LogSummary(void)
+{
+	LogOne("[FRAME STATS] all", GetSummary());
+
+	for (auto window : Settings::frame_stats_windows)
+	{
+		// a window longer than the run says nothing new
+		auto summary = GetWindow(window);
+		if (summary.frame_count == window) LogOne("[FRAME STATS] last", summary);
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include<vector>
+#include<cstdint>
+
+// Frame times on steady_clock.
+// Every frame goes into a log-linear histogram of atomic bins (about 1.5% resolution)
+// for whole-run percentiles, and into a ring of exact times for rolling windows.
+// Frames over the budget count as stutters, over twice the budget as severe ones.
+namespace FrameStats
+{
+	struct Summary
+	{
+		uint64_t	frame_count;
+		double		average_ms;
+		double		min_ms;
+		double		max_ms;
+		double		p50_ms;
+		double		p90_ms;
+		double		p99_ms;
+		double		p999_ms;
+		double		budget_ms;
+		uint64_t	stutter_count;			// over budget_ms
+		uint64_t	severe_stutter_count;	// over twice budget_ms
+	};
+
+	// clears everything recorded so far
+	void Initialize(double budget_ms);
+
+	void SetBudget(double budget_ms);
+	double GetBudget(void);
+
+	// once per frame on the main thread, records the time since the previous mark
+	void FrameMark(void);
+
+	// thread safe, for times measured elsewhere
+	void Record(double frame_ms);
+
+	// every frame since Initialize, percentiles from the histogram
+	Summary GetSummary(void);
+
+	// the last frame_count frames, exact
+	Summary GetWindow(uint32_t frame_count);
+
+	// the last frame_count frames in ms, oldest first, at most frame_stats_window_capacity
+	std::vector<double> GetFrameTimes(uint32_t frame_count);
+
+	void LogSummary(void);
+}
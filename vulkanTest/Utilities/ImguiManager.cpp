@@ -3,7 +3,7 @@
 #include"imgui.h"
 #include"imgui_impl_win32.h"
 #include"imgui_impl_dx11.h"
-#include"..\Renderer\Graphics.h"
+#include"../Renderer/Graphics.h"
 #include"Input.h"
 
 namespace PrizmEngine
@@ -1,4 +1,5 @@
 
+#include<cstring>
 #include<unordered_map>
 
 #include"Input.h"
@@ -8,9 +9,16 @@ namespace Input
 {
 	constexpr int keyscount = 256;	//keyboard and mouse keys num
 
+	struct Position
+	{
+		long x, y;
+	};
+
 	// mouse_state
 	bool  mouse_captured = false;
+#if defined(_WIN32)
 	POINT capture_position;
+#endif
 
 	// input state
 	bool ignore_input = false;
@@ -26,11 +34,11 @@ namespace Input
 	short mouse_scroll = 0;
 
 	// touch
-	POINT touch_position[max_touchcount];
-	POINT prev_touch_position[max_touchcount];
+	Position touch_position[max_touchcount];
+	Position prev_touch_position[max_touchcount];
 	long touch_delta[max_touchcount][2];
-	DWORD touch_state[max_touchcount];
-	DWORD prev_touch_state[max_touchcount];
+	uint32_t touch_state[max_touchcount];
+	uint32_t prev_touch_state[max_touchcount];
 
 	static const std::unordered_map<const char*, KeyCode> key_map_ = []()
 	{
@@ -145,6 +153,7 @@ namespace Input
 		memset(mouse_pos, 0, sizeof(long) * 2);
 	}
 
+#if defined(_WIN32)
 	void CaptureMouse(HWND window_handle, bool do_capture)
 	{
 		mouse_captured = do_capture;
@@ -183,8 +192,9 @@ namespace Input
 			Log::Info("Mouse capture released!");
 		}
 	}
-	bool IsMouseCaptured(void) { return mouse_captured; }
 	POINT MouseCapturePosition(void) { return capture_position; }
+#endif
+	bool IsMouseCaptured(void) { return mouse_captured; }
 
 	void KeyDown(KeyCode key) { keys[key] = true; }
 	void KeyUp(KeyCode key) { keys[key] = false; }
@@ -200,7 +210,7 @@ namespace Input
 		mouse_scroll = scroll;
 	}
 
-	void UpdateTouchPos(long x, long y, int count, DWORD flags)
+	void UpdateTouchPos(long x, long y, int count, uint32_t flags)
 	{
 		touch_position[count].x = x;
 		touch_position[count].y = y;
@@ -231,10 +241,10 @@ namespace Input
 	int  MouseDeltaY(void) { return !ignore_input ? mouse_delta[1] : 0; }
 
 	// touce state
-	bool IsTouchDown(int count) { return touch_state[count] & (TOUCHEVENTF_DOWN | TOUCHEVENTF_MOVE); }
-	bool IsTouchMove(int count) { return touch_state[count] & TOUCHEVENTF_MOVE; }
-	bool IsTouchReleased(int count) { return touch_state[count] & TOUCHEVENTF_UP; }
-	bool IsTouchTriggered(int count) { return touch_state[count] & TOUCHEVENTF_DOWN; }
+	bool IsTouchDown(int count) { return (touch_state[count] & (touch_down | touch_move)) != 0; }
+	bool IsTouchMove(int count) { return (touch_state[count] & touch_move) != 0; }
+	bool IsTouchReleased(int count) { return (touch_state[count] & touch_up) != 0; }
+	bool IsTouchTriggered(int count) { return (touch_state[count] & touch_down) != 0; }
 
 	int  TouchDeltaX(int count)
 	{
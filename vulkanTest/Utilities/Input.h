@@ -1,8 +1,11 @@
 #pragma once
 
 #include<string>
+#include<cstdint>
 
+#if defined(_WIN32)
 #include<Windows.h>
+#endif
 
 /*
 Mouse and touch input has raw input data.
@@ -15,12 +18,19 @@ namespace Input
 {
 	constexpr int max_touchcount = 2;	// multi touch num
 
+	// touch state flags, the TOUCHEVENTF_ values
+	constexpr uint32_t touch_move = 0x0001;
+	constexpr uint32_t touch_down = 0x0002;
+	constexpr uint32_t touch_up = 0x0004;
+
 	void Initialize(void);
 
 	// mouse capture
+#if defined(_WIN32)
 	void CaptureMouse(HWND, bool do_capture);
-	bool IsMouseCaptured(void);
 	POINT MouseCapturePosition(void);
+#endif
+	bool IsMouseCaptured(void);
 
 	// update
 	void KeyDown(KeyCode);
@@ -30,7 +40,7 @@ namespace Input
 	void ButtonUp(KeyCode);
 	void UpdateMousePos(long, long, short);
 
-	void UpdateTouchPos(long, long, int, DWORD);
+	void UpdateTouchPos(long, long, int, uint32_t flags);
 
 	// key state
 	bool IsKeyDown(KeyCode);
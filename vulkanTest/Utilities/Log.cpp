@@ -1,10 +1,13 @@
 
+#include<mutex>
 #include<fstream>
 #include<iostream>
 
+#if defined(_WIN32)
 #include<Windows.h>
 #include<io.h>
 #include<fcntl.h>
+#endif
 
 #include"Log.h"
 #include"Utils.h"
@@ -14,6 +17,17 @@ namespace Log
 {
 	std::ofstream out_file_;
 	LogMode current_mode_;
+	std::mutex mutex_;	// workers log too, lines must not interleave
+
+	// the debugger output window, nothing outside windows
+	void DebugOutput(const std::string& msg)
+	{
+#if defined(_WIN32)
+		OutputDebugStringA(msg.c_str());
+#else
+		(void)msg;
+#endif
+	}
 }
 
 void Log::Initialize(LogMode mode)
@@ -51,20 +65,24 @@ void Log::Finalize(void)
 		out_file_ << msg;
 		out_file_.close();
 	}
-	std::cout << msg;
-	OutputDebugStringA(msg.c_str());
+	std::cout << msg << std::endl;
+	DebugOutput(msg);
 
+#if defined(_WIN32)
 	if (current_mode_ == CONSOLE || current_mode_ == CONSOLE_AND_FILE)
 	{
 		FreeConsole();
 	}
+#endif
 }
 
 void Log::Error(const std::string& s)
 {
 	std::string err = StrUtils::TimeStr::GetCurrentTimeAsStringWithBrackets() + "[ERROR]: " + s + "\n";
 
-	OutputDebugStringA(err.c_str());	// vs
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	DebugOutput(err);					// vs
 
 	if (out_file_.is_open())
 		out_file_ << err;				// file
@@ -76,7 +94,9 @@ void Log::Warning(const std::string& s)
 {
 	std::string warn = StrUtils::TimeStr::GetCurrentTimeAsStringWithBrackets() + "[WARNING]: " + s + "\n";
 
-	OutputDebugStringA(warn.c_str());	// vs
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	DebugOutput(warn);					// vs
 
 	if (out_file_.is_open())
 		out_file_ << warn;				// file
@@ -88,7 +108,9 @@ void Log::Info(const std::string& s)
 {
 	std::string info = StrUtils::TimeStr::GetCurrentTimeAsStringWithBrackets() + "[INFO]: " + s + "\n";
 
-	OutputDebugStringA(info.c_str());	// vs
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	DebugOutput(info);					// vs
 
 	if (out_file_.is_open())
 		out_file_ << info;				// file
@@ -98,9 +120,12 @@ void Log::Info(const std::string& s)
 
 void Log::InitConsole(void)
 {
+	// outside windows stdout already is the terminal or the job's pipe
+#if defined(_WIN32)
 	// src: https://stackoverflow.com/a/46050762/2034041
 
-	AllocConsole();
+	// the console of a script that started us, a new one otherwise
+	if (!AttachConsole(ATTACH_PARENT_PROCESS)) AllocConsole();
 
 	// Get STDOUT handle
 	HANDLE console_output = GetStdHandle(STD_OUTPUT_HANDLE);
@@ -131,45 +156,43 @@ void Log::InitConsole(void)
 	std::cerr.clear();
 	std::wcin.clear();
 	std::cin.clear();
+#endif
 }
 
 void Log::InitFile(void)
 {
-	const std::string log_directory = BaseSystem::workspace_directory_ + "\\Logs";
+	const std::string log_directory = BaseSystem::workspace_directory_ + "/Logs";
 
 	std::string err_msg = "";
 
-	if (CreateDirectoryA(BaseSystem::workspace_directory_.c_str(), nullptr))
+	if (DirectoryUtils::CreateDirectories(log_directory))
 	{
-		if (CreateDirectoryA(log_directory.c_str(), nullptr))
+		std::string file_name = StrUtils::TimeStr::GetCurrentTimeAsString() + "_PrizmEngine_Log.txt";
+
+		out_file_.open(log_directory + "/" + file_name);
+
+		if (out_file_)
 		{
-			std::string file_name = StrUtils::TimeStr::GetCurrentTimeAsString() + "_PrizmEngine_Log.txt";
-
-			out_file_.open(log_directory + "//" + file_name);
-
-			if (out_file_)
-			{
-				std::string msg = StrUtils::TimeStr::GetCurrentTimeAsStringWithBrackets() + "[Log] " + "Log Initialize Done.";
-				out_file_ << msg;
-				std::cout << msg << std::endl;
-			}
-			else
-			{
-				err_msg = "Cannot open log file " + file_name;
-			}
+			std::string msg = StrUtils::TimeStr::GetCurrentTimeAsStringWithBrackets() + "[Log] " + "Log Initialize Done.";
+			out_file_ << msg;
+			std::cout << msg << std::endl;
 		}
 		else
 		{
-			err_msg = "Failed to create directory " + log_directory;
+			err_msg = "Cannot open log file " + file_name;
 		}
 	}
 	else
 	{
-		err_msg = "Failed to create directory " + BaseSystem::workspace_directory_;
+		err_msg = "Failed to create directory " + log_directory;
 	}
 
 	if (!err_msg.empty())
 	{
+#if defined(_WIN32)
 		MessageBoxA(NULL, err_msg.c_str(), "PrizmEngine: Error Initializing Logging", MB_OK);
+#else
+		std::cerr << "PrizmEngine: Error Initializing Logging: " << err_msg << std::endl;
+#endif
 	}
 }
\ No newline at end of file
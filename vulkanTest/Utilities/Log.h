@@ -1,6 +1,7 @@
 #pragma once
 
 #include<string>
+#include<cstdio>
 
 namespace Log
 {
@@ -22,7 +23,7 @@ namespace Log
 	void Error(const std::string& format, Args&&... args)
 	{
 		char msg[128];
-		sprintf_s(msg, format.c_str(), args...);
+		std::snprintf(msg, sizeof(msg), format.c_str(), args...);
 		Error(std::string(msg));
 	}
 
@@ -32,7 +33,7 @@ namespace Log
 	void Warning(const std::string& format, Args&&... args)
 	{
 		char msg[128];
-		sprintf_s(msg, format.c_str(), args...);
+		std::snprintf(msg, sizeof(msg), format.c_str(), args...);
 		Warning(std::string(msg));
 	}
 
@@ -42,7 +43,7 @@ namespace Log
 	void Info(const std::string& format, Args&&... args)
 	{
 		char msg[128];
-		sprintf_s(msg, format.c_str(), args...);
+		std::snprintf(msg, sizeof(msg), format.c_str(), args...);
 		Info(std::string(msg));
 	}
 
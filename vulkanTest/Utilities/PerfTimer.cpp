@@ -4,7 +4,8 @@
 
 namespace PrizmEngine
 {
-	using Time = std::chrono::time_point<std::chrono::system_clock>;
+	// monotonic, wall clock adjustments never show up as frame time
+	using Time = std::chrono::time_point<std::chrono::steady_clock>;
 	using Duration = std::chrono::duration<float>;
 
 	class PerfTimer::Impl
@@ -32,7 +33,7 @@ namespace PrizmEngine
 			return impl_->dt_.count();
 		}
 
-		impl_->curr_time_ = std::chrono::system_clock::now();
+		impl_->curr_time_ = std::chrono::steady_clock::now();
 		impl_->dt_ = impl_->curr_time_ - impl_->prev_time_;
 
 		impl_->prev_time_ = impl_->curr_time_;
@@ -46,7 +47,7 @@ namespace PrizmEngine
 		if (impl_->is_stopped_)
 		{
 			impl_->paused_time_ = impl_->start_time_ - impl_->stop_time_;
-			impl_->prev_time_ = std::chrono::system_clock::now();
+			impl_->prev_time_ = std::chrono::steady_clock::now();
 			impl_->is_stopped_ = false;
 		}
 		Tick();
@@ -57,7 +58,7 @@ namespace PrizmEngine
 		Tick();
 		if (!impl_->is_stopped_)
 		{
-			impl_->stop_time_ = std::chrono::system_clock::now();
+			impl_->stop_time_ = std::chrono::steady_clock::now();
 			impl_->is_stopped_ = true;
 		}
 	}
@@ -79,7 +80,7 @@ namespace PrizmEngine
 
 	void PerfTimer::Reset()
 	{
-		impl_->base_time_ = impl_->prev_time_ = std::chrono::system_clock::now();
+		impl_->base_time_ = impl_->prev_time_ = std::chrono::steady_clock::now();
 		impl_->is_stopped_ = true;
 		impl_->dt_ = Duration::zero();
 	}
@@ -1,6 +1,6 @@
 #pragma once
 
-#include<Windows.h>
+#include<cstdint>
 
 namespace Settings
 {
@@ -13,14 +13,104 @@ namespace Settings
 	template <class T>
 	constexpr T application_name = "Vulkan"; // caption
 
+	template <class T>
+	constexpr T frames_in_flight = 2;	// frames cpu may record ahead of gpu
+
+	template <class T>
+	constexpr T worker_thread_count = 0;	// 0 : hardware threads - 1
+
+	template <class T>
+	constexpr T headless_frame_count = 1000;	// --headless runs this many frames unless --frames is given
+
+	template <class T>
+	constexpr T upload_ring_frame_size = 4 * 1024 * 1024;	// bytes of dynamic data per frame in flight
+
+	template <class T>
+	constexpr T pipeline_cache_flush_seconds = 30;	// background save interval, written only when the content changed
+
+	template <class T>
+	constexpr T bindless_enabled = true;	// needs VK_EXT_descriptor_indexing, else per-frame sets
+
+	template <class T>
+	constexpr T bindless_image_capacity = 16384;
+
+	template <class T>
+	constexpr T bindless_buffer_capacity = 16384;
+
+	template <class T>
+	constexpr T bindless_fallback_capacity = 256;	// per binding, without descriptor indexing
+
+	template <class T>
+	constexpr T gpu_profiler_max_scopes = 64;	// timestamp scopes per frame, the rest are dropped
+
+	template <class T>
+	constexpr T gpu_profiler_history = 120;		// frames per scope for average, min, max and p99
+
+	template <class T>
+	constexpr T pipeline_statistics_enabled = false;	// also --pipeline-stats, costs a query pair per pass
+
+	template <class T>
+	constexpr T pipeline_statistics_max_passes = 32;
+
+	template <class T>
+	constexpr T cpu_profiler_enabled = true;	// zones cost two timestamps, off compiles the recording out
+
+	template <class T>
+	constexpr T cpu_profiler_ring_size = 65536;	// events per thread, power of two, older ones are overwritten
+
+	template <class T>
+	constexpr T cpu_profiler_frame_history = 1024;	// frame marks kept for a dump
+
+	template <class T>
+	constexpr T cpu_profiler_dump_frames = 120;	// F11 or --cpu-trace dumps this many frames
+
+	template <class T>
+	constexpr T frame_budget_ms = 1000.0 / 60.0;	// also --frame-budget=ms, longer frames count as stutters
+
+	template <class T>
+	constexpr T frame_stats_window_capacity = 4096;	// latest frame times kept for the rolling windows
+
+	constexpr uint32_t frame_stats_windows[] = { 60, 600 };	// frames, logged on exit next to the whole run
+
+	template <class T>
+	constexpr T benchmark_scenario = "orbit";	// --benchmark without a name
+
+	template <class T>
+	constexpr T benchmark_warmup_frames = 300;
+
+	template <class T>
+	constexpr T benchmark_measured_frames = 1000;
+
+	template <class T>
+	constexpr T benchmark_regression_percent = 5;	// slower than the baseline by more : regression
+
+	template <class T>
+	constexpr T device_info_dump = false;	// also --device-info, every gpu's queues, extensions and features at startup
+
+	template <class T>
+	constexpr T gpu_override = "";	// also --gpu=index|uuid|name, empty : the highest scored gpu
+
+	template <class T>
+	constexpr T transient_aliasing = true;	// graph intermediates share memory when lifetimes do not overlap
+
+	enum class PresentPolicy
+	{
+		LOW_LATENCY,	// vsync : fifo relaxed, no vsync : immediate > mailbox
+		THROUGHPUT,		// vsync : fifo, no vsync : mailbox > immediate
+	};
+
 	struct Window
 	{
 		int	width;
 		int	height;
 		int	fullscreen;
 		int	vsync;
+		int	swapchain_image_count;	// clamped to the surface capabilities
+		PresentPolicy present_policy;
 	};
 
+	constexpr Window window = { window_width<int>, window_height<int>, 0, 1, 2, PresentPolicy::THROUGHPUT };
+
 	struct Camera
 	{
 		union
@@ -0,0 +1,256 @@
+#include<mutex>
+#include<deque>
+#include<chrono>
+#include<algorithm>
+#include<condition_variable>
+
+#include"TaskGraph.h"
+#include"ThreadPool.h"
+#include"CpuProfiler.h"
+#include"Log.h"
+
+class TaskGraph::Impl
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	enum class State
+	{
+		WAITING,
+		READY,
+		DONE,
+		SKIPPED,
+	};
+
+	struct Node
+	{
+		const char*				name;
+		Task					task;
+		std::vector<TaskId>		dependencies;
+		std::vector<TaskId>		dependents;
+	};
+
+	// shared with the pool jobs, one may start after Run returned and find nothing to do
+	struct RunState
+	{
+		Impl*						impl;
+		ThreadPool*					pool;
+		std::vector<uint32_t>		remaining;
+		std::vector<State>			states;
+		std::deque<TaskId>			ready;
+		uint32_t					finished;
+		bool						failed;
+		Clock::time_point			start;
+		std::mutex					mutex;
+		std::condition_variable		condition;
+	};
+
+	std::vector<Node>		nodes_;
+	std::vector<Timing>		timings_;
+
+	// mutex held
+	void Skip(RunState& state, TaskId id)
+	{
+		std::vector<TaskId> stack(1, id);
+		while (!stack.empty())
+		{
+			const auto current = stack.back();
+			stack.pop_back();
+
+			for (auto dependent : nodes_[current].dependents)
+			{
+				if (state.states[dependent] == State::SKIPPED) continue;
+
+				state.states[dependent] = State::SKIPPED;
+				++state.finished;
+				stack.push_back(dependent);
+			}
+		}
+	}
+
+	static void Schedule(const std::shared_ptr<RunState>& state, size_t job_count)
+	{
+		for (size_t i = 0; i < job_count; ++i)
+		{
+			state->pool->Push([state](uint32_t thread_index) { RunReady(state, thread_index, false); }, ThreadPool::Priority::HIGH);
+		}
+	}
+
+	// takes ready tasks until none is left, the calling thread waits for more instead
+	static void RunReady(const std::shared_ptr<RunState>& shared_state, uint32_t thread_index, bool wait)
+	{
+		auto& state = *shared_state;
+		std::unique_lock<std::mutex> lock(state.mutex);
+		auto impl = state.impl;
+
+		for (;;)
+		{
+			if (wait)
+			{
+				state.condition.wait(lock, [&] { return !state.ready.empty() || state.finished == state.states.size(); });
+			}
+			if (state.ready.empty()) return;
+
+			const auto id = state.ready.front();
+			state.ready.pop_front();
+			lock.unlock();
+
+			auto& timing = impl->timings_[id];
+			const auto begin = Clock::now();
+			bool succeeded;
+			{
+				CpuProfiler::Zone zone(impl->nodes_[id].name);
+				succeeded = impl->nodes_[id].task();
+			}
+			const auto end = Clock::now();
+
+			lock.lock();
+
+			timing.start_ms = std::chrono::duration<double, std::milli>(begin - state.start).count();
+			timing.duration_ms = std::chrono::duration<double, std::milli>(end - begin).count();
+			timing.thread_index = thread_index;
+			timing.ran = true;
+			timing.succeeded = succeeded;
+
+			state.states[id] = State::DONE;
+			++state.finished;
+
+			size_t released = 0;
+			if (succeeded)
+			{
+				for (auto dependent : impl->nodes_[id].dependents)
+				{
+					if (--state.remaining[dependent] == 0 && state.states[dependent] == State::WAITING)
+					{
+						state.states[dependent] = State::READY;
+						state.ready.push_back(dependent);
+						++released;
+					}
+				}
+			}
+			else
+			{
+				Log::Error("Task " + timing.name + " failed.");
+				state.failed = true;
+				impl->Skip(state, id);
+			}
+
+			state.condition.notify_all();
+
+			// this thread takes one, jobs that ran dry have returned
+			if (released > 1)
+			{
+				lock.unlock();
+				Schedule(shared_state, released - 1);
+				lock.lock();
+			}
+		}
+	}
+};
+
+TaskGraph::TaskGraph() : impl_(std::make_unique<Impl>()) {}
+
+TaskGraph::~TaskGraph() = default;
+
+TaskGraph::TaskId TaskGraph::Add(const char* name, Task task, const std::vector<TaskId>& dependencies)
+{
+	const auto id = static_cast<TaskId>(impl_->nodes_.size());
+
+	for (auto dependency : dependencies)
+	{
+		impl_->nodes_[dependency].dependents.push_back(id);
+	}
+
+	impl_->nodes_.push_back({ name, std::move(task), dependencies, {} });
+	impl_->timings_.push_back({ name, 0.0, 0.0, 0, false, false });
+
+	return id;
+}
+
+bool TaskGraph::Run(ThreadPool& pool)
+{
+	const auto count = impl_->nodes_.size();
+	if (count == 0) return true;
+
+	auto state = std::make_shared<Impl::RunState>();
+	state->impl = impl_.get();
+	state->pool = &pool;
+	state->remaining.resize(count);
+	state->states.resize(count, Impl::State::WAITING);
+	state->finished = 0;
+	state->failed = false;
+	state->start = Impl::Clock::now();
+
+	for (size_t i = 0; i < count; ++i)
+	{
+		state->remaining[i] = static_cast<uint32_t>(impl_->nodes_[i].dependencies.size());
+		if (state->remaining[i] == 0)
+		{
+			state->states[i] = Impl::State::READY;
+			state->ready.push_back(static_cast<TaskId>(i));
+		}
+	}
+
+	// a job per ready task, a job keeps taking tasks while any are ready
+	Impl::Schedule(state, std::min<size_t>(state->ready.size(), pool.GetThreadCount()));
+
+	Impl::RunReady(state, pool.GetThreadCount(), true);
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->condition.wait(lock, [&] { return state->finished == count; });
+
+	return !state->failed;
+}
+
+const std::vector<TaskGraph::Timing>& TaskGraph::GetTimings(void) const
+{
+	return impl_->timings_;
+}
+
+void TaskGraph::LogTimings(const std::string& label) const
+{
+	auto& timings = impl_->timings_;
+
+	double wall_ms = 0.0;
+	double total_ms = 0.0;
+
+	// dependencies are always added first, one pass finds the longest chain
+	std::vector<double> chain_ms(timings.size(), 0.0);
+	std::vector<int> chain_previous(timings.size(), -1);
+
+	for (size_t i = 0; i < timings.size(); ++i)
+	{
+		auto& timing = timings[i];
+		if (!timing.ran)
+		{
+			Log::Info("  " + timing.name + " skipped");
+			continue;
+		}
+
+		Log::Info("  %-28s %8.2f ms  at %8.2f ms  thread %u", timing.name.c_str(), timing.duration_ms, timing.start_ms, timing.thread_index);
+
+		wall_ms = std::max(wall_ms, timing.start_ms + timing.duration_ms);
+		total_ms += timing.duration_ms;
+
+		for (auto dependency : impl_->nodes_[i].dependencies)
+		{
+			if (chain_ms[dependency] > chain_ms[i])
+			{
+				chain_ms[i] = chain_ms[dependency];
+				chain_previous[i] = static_cast<int>(dependency);
+			}
+		}
+		chain_ms[i] += timing.duration_ms;
+	}
+
+	const auto last = std::max_element(chain_ms.begin(), chain_ms.end()) - chain_ms.begin();
+
+	std::string chain;
+	for (int i = static_cast<int>(last); i >= 0; i = chain_previous[i])
+	{
+		chain = timings[i].name + (chain.empty() ? "" : " > ") + chain;
+	}
+
+	Log::Info("%s : %.2f ms, %.2f ms of tasks, %.2f ms critical path", label.c_str(), wall_ms, total_ms, chain_ms[last]);
+	Log::Info("  critical path : " + chain);
+}
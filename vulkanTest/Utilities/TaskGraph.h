@@ -0,0 +1,49 @@
+#pragma once
+
+#include<memory>
+#include<string>
+#include<vector>
+#include<functional>
+
+class ThreadPool;
+
+// Named tasks with dependencies, run once on a ThreadPool.
+// A task starts when every dependency succeeded, independent tasks run at the same time.
+// A failed task skips everything that depends on it, the others still finish.
+class TaskGraph
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	using TaskId = uint32_t;
+	using Task = std::function<bool(void)>;
+
+	struct Timing
+	{
+		std::string	name;
+		double		start_ms;		// since Run
+		double		duration_ms;
+		uint32_t	thread_index;	// pool worker, GetThreadCount() : the calling thread
+		bool		ran;
+		bool		succeeded;
+	};
+
+	TaskGraph();
+	~TaskGraph();
+
+	// dependencies must be added first
+	// the name is also a cpu profiler zone, a string literal
+	TaskId Add(const char* name, Task, const std::vector<TaskId>& dependencies = {});
+
+	// the calling thread takes ready tasks too, must not be a pool worker
+	// false when a task failed
+	bool Run(ThreadPool&);
+
+	// in the order added
+	const std::vector<Timing>& GetTimings(void) const;
+
+	// wall time, summed task time and the longest dependency chain
+	void LogTimings(const std::string& label) const;
+};
@@ -0,0 +1,152 @@
+#include<algorithm>
+#include<atomic>
+#include<condition_variable>
+#include<deque>
+#include<mutex>
+#include<thread>
+#include<vector>
+
+#include"ThreadPool.h"
+#include"CpuProfiler.h"
+
+class ThreadPool::Impl
+{
+public:
+	std::vector<std::thread>					threads_;
+	std::deque<std::packaged_task<void(uint32_t)>>	tasks_;
+	std::mutex									mutex_;
+	std::condition_variable						condition_;
+	bool										exit_;
+
+	Impl() : exit_(false) {}
+
+	void WorkerLoop(uint32_t thread_index)
+	{
+		CpuProfiler::SetThreadName("worker " + std::to_string(thread_index));
+
+		while (true)
+		{
+			std::packaged_task<void(uint32_t)> task;
+
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				condition_.wait(lock, [this] { return exit_ || !tasks_.empty(); });
+
+				if (exit_ && tasks_.empty()) return;
+
+				task = std::move(tasks_.front());
+				tasks_.pop_front();
+			}
+
+			task(thread_index);
+		}
+	}
+};
+
+ThreadPool::ThreadPool(uint32_t thread_count) : impl_(std::make_unique<Impl>())
+{
+	if (thread_count == 0)
+	{
+		thread_count = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+
+	for (uint32_t i = 0; i < thread_count; ++i)
+	{
+		impl_->threads_.emplace_back(&Impl::WorkerLoop, impl_.get(), i);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	Exit();
+}
+
+uint32_t ThreadPool::GetThreadCount(void) const
+{
+	return static_cast<uint32_t>(impl_->threads_.size());
+}
+
+std::future<void> ThreadPool::Push(Task task, Priority priority)
+{
+	std::packaged_task<void(uint32_t)> packaged(std::move(task));
+	auto future = packaged.get_future();
+
+	{
+		std::lock_guard<std::mutex> lock(impl_->mutex_);
+		if (priority == Priority::HIGH)
+		{
+			impl_->tasks_.push_front(std::move(packaged));
+		}
+		else
+		{
+			impl_->tasks_.push_back(std::move(packaged));
+		}
+	}
+	impl_->condition_.notify_one();
+
+	return future;
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const IndexedTask& task)
+{
+	if (count == 0) return;
+
+	// outlives the call, helpers stuck behind long tasks start late and find no index left
+	struct State
+	{
+		IndexedTask					task;
+		uint32_t					count;
+		std::atomic<uint32_t>		next_index;
+		std::atomic<uint32_t>		done_count;
+		std::mutex					mutex;
+		std::condition_variable		condition;
+	};
+
+	auto state = std::make_shared<State>();
+	state->task = task;
+	state->count = count;
+	state->next_index = 0;
+	state->done_count = 0;
+
+	auto run = [state](uint32_t thread_index)
+	{
+		for (uint32_t i = state->next_index++; i < state->count; i = state->next_index++)
+		{
+			state->task(i, thread_index);
+
+			if (++state->done_count == state->count)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->condition.notify_all();
+			}
+		}
+	};
+
+	uint32_t helper_count = std::min(count, GetThreadCount() + 1) - 1;
+	for (uint32_t i = 0; i < helper_count; ++i)
+	{
+		Push(run, Priority::HIGH);
+	}
+
+	run(GetThreadCount());
+
+	// indices taken by helpers may still be running
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->condition.wait(lock, [&] { return state->done_count == state->count; });
+}
+
+void ThreadPool::Exit(void)
+{
+	{
+		std::lock_guard<std::mutex> lock(impl_->mutex_);
+		if (impl_->exit_) return;
+		impl_->exit_ = true;
+	}
+	impl_->condition_.notify_all();
+
+	for (auto& thread : impl_->threads_)
+	{
+		if (thread.joinable()) thread.join();
+	}
+	impl_->threads_.clear();
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include<memory>
+#include<future>
+#include<functional>
+
+// Fixed set of worker threads shared by the engine subsystems.
+// Tasks receive the index of the thread running them, so callers can keep per-thread state.
+class ThreadPool
+{
+private:
+	class Impl;
+	std::unique_ptr<Impl> impl_;
+
+public:
+	using Task = std::function<void(uint32_t thread_index)>;
+	using IndexedTask = std::function<void(uint32_t index, uint32_t thread_index)>;
+
+	enum class Priority
+	{
+		NORMAL,		// background work, runs in submission order
+		HIGH,		// jumps the queue, for work a frame waits on
+	};
+
+	ThreadPool(uint32_t thread_count = 0);	// 0 : hardware threads - 1
+	~ThreadPool();
+
+	// worker threads, the calling thread of ParallelFor uses index GetThreadCount()
+	uint32_t GetThreadCount(void) const;
+
+	std::future<void> Push(Task, Priority = Priority::NORMAL);
+
+	// runs task(0..count-1) on the workers and the calling thread, returns when all done.
+	// does not wait for workers busy with long tasks, the calling thread takes their share.
+	// must not be called from a worker, the calling thread index would collide
+	void ParallelFor(uint32_t count, const IndexedTask&);
+
+	void Exit(void);
+};
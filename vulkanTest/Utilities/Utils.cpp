@@ -4,7 +4,17 @@
 #include<sstream>
 #include<ctime>
 #include<iomanip>
+#include<fstream>
+#include<cstring>
+#include<cstdlib>
+#if defined(_WIN32)
 #include "shlobj.h"
+#else
+#include<cerrno>
+#include<fcntl.h>
+#include<unistd.h>
+#include<sys/stat.h>
+#endif
 
 #include"Utils.h"
 
@@ -26,7 +36,11 @@ namespace StrUtils
 	{
 		const std::time_t now = std::time(0);
 		std::tm current_time;	// current time
+#if defined(_WIN32)
 		localtime_s(&current_time, &now);
+#else
+		localtime_r(&now, &current_time);
+#endif
 
 		// YYYY-MM-DD_HH-MM-SS
 		std::stringstream ss;
@@ -47,6 +61,7 @@ namespace StrUtils
 
 namespace DirectoryUtils
 {
+#if defined(_WIN32)
 	std::string GetSpecialFolderPath(FolderType folder)
 	{
 		const KNOWNFOLDERID& folder_id = [&]()
@@ -74,6 +89,166 @@ namespace DirectoryUtils
 
 		return StrUtils::UnicodeToAscii(destination_path);
 	}
+#else
+	// XDG base directories, the environment first
+	std::string GetSpecialFolderPath(FolderType folder)
+	{
+		const auto env = [](const char* name) { auto value = std::getenv(name); return std::string(value ? value : ""); };
+		const auto home = env("HOME");
+
+		switch (folder)
+		{
+		case PROGRAM_FILE:
+			return "/usr/local/share";
+		case APPDATA:
+			return !env("XDG_CONFIG_HOME").empty() ? env("XDG_CONFIG_HOME") : home + "/.config";
+		case LOCAL_APPDATA:
+			return !env("XDG_DATA_HOME").empty() ? env("XDG_DATA_HOME") : home + "/.local/share";
+		case USER_PROFILE:
+			return home;
+		case DOCUMENTS:
+			return home + "/Documents";
+		}
+
+		return home;
+	}
+#endif
+
+	bool CreateDirectories(const std::string& path)
+	{
+		if (path.empty()) return false;
+
+#if defined(_WIN32)
+		auto attributes = GetFileAttributesA(path.c_str());
+		if (attributes != INVALID_FILE_ATTRIBUTES) return (attributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+#else
+		struct stat status;
+		if (stat(path.c_str(), &status) == 0) return S_ISDIR(status.st_mode);
+#endif
+
+		auto separator = path.find_last_of("\\/");
+		if (separator != std::string::npos && separator > 0)
+		{
+			if (!CreateDirectories(path.substr(0, separator))) return false;
+		}
+
+#if defined(_WIN32)
+		return CreateDirectoryA(path.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+		return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+	}
+}
+
+namespace HashUtils
+{
+	uint64_t Hash64(const void* data, size_t size, uint64_t seed)
+	{
+		const uint64_t m = 0xc6a4a7935bd1e995ull;
+		const int r = 47;
+
+		uint64_t h = seed ^ (size * m);
+
+		auto bytes = static_cast<const unsigned char*>(data);
+		const size_t block_count = size / 8;
+
+		for (size_t i = 0; i < block_count; ++i)
+		{
+			uint64_t k;
+			memcpy(&k, bytes + i * 8, 8);
+
+			k *= m;
+			k ^= k >> r;
+			k *= m;
+
+			h ^= k;
+			h *= m;
+		}
+
+		auto tail = bytes + block_count * 8;
+		switch (size & 7)
+		{
+		case 7: h ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+		case 6: h ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+		case 5: h ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+		case 4: h ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+		case 3: h ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+		case 2: h ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+		case 1: h ^= uint64_t(tail[0]);
+			h *= m;
+		}
+
+		h ^= h >> r;
+		h *= m;
+		h ^= h >> r;
+
+		return h;
+	}
+}
+
+namespace FileUtils
+{
+	bool ReadBinary(const std::string& path, std::vector<char>& data)
+	{
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if (!file) return false;
+
+		auto size = static_cast<size_t>(file.tellg());
+		file.seekg(0);
+
+		data.resize(size);
+		file.read(data.data(), size);
+
+		return static_cast<bool>(file);
+	}
+
+	bool WriteBinaryAtomic(const std::string& path, const void* data, size_t size)
+	{
+		const std::string temp_path = path + ".tmp";
+
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(temp_path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return false;
+
+		DWORD written = 0;
+		bool done = WriteFile(file, data, static_cast<DWORD>(size), &written, nullptr) && written == size;
+
+		// on disk before the rename makes it visible
+		done = done && FlushFileBuffers(file);
+		CloseHandle(file);
+
+		if (!done || !MoveFileExA(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH))
+		{
+			DeleteFileA(temp_path.c_str());
+			return false;
+		}
+#else
+		int file = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if (file < 0) return false;
+
+		auto bytes = static_cast<const char*>(data);
+		size_t written = 0;
+		while (written < size)
+		{
+			auto result = write(file, bytes + written, size - written);
+			if (result < 0 && errno == EINTR) continue;
+			if (result <= 0) break;
+			written += static_cast<size_t>(result);
+		}
+
+		// on disk before the rename makes it visible
+		bool done = written == size && fsync(file) == 0;
+		done = close(file) == 0 && done;
+
+		if (!done || rename(temp_path.c_str(), path.c_str()) != 0)
+		{
+			unlink(temp_path.c_str());
+			return false;
+		}
+#endif
+
+		return true;
+	}
 }
 
 namespace Utils
@@ -1,6 +1,8 @@
 #pragma once
 
 #include<string>
+#include<vector>
+#include<cstdint>
 #include<random>
 
 inline constexpr long succeeded(bool hr) { return static_cast<int>(hr) >= 0; }
@@ -31,6 +33,23 @@ namespace DirectoryUtils
 	};
 
 	std::string GetSpecialFolderPath(FolderType);
+
+	// creates the directory and missing parents
+	bool CreateDirectories(const std::string& path);
+}
+
+namespace HashUtils
+{
+	// MurmurHash64A
+	uint64_t Hash64(const void* data, size_t size, uint64_t seed = 0);
+}
+
+namespace FileUtils
+{
+	bool ReadBinary(const std::string& path, std::vector<char>& data);
+
+	// writes a temporary file and moves it over the target, readers never see a partial file
+	bool WriteBinaryAtomic(const std::string& path, const void* data, size_t size);
 }
 
 namespace Utils